@@ -38,3 +38,7 @@ endif
 ifeq ($(LOSCFG_USER_INIT_DEBUG), y)
 APP_SUBDIRS += init
 endif
+
+ifeq ($(LOSCFG_USER_VM_TEST), y)
+APP_SUBDIRS += vmtest
+endif
@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * vmtest: user space checks and benchmarks for the memory management paths.
+ *   vmtest string                         libc string routines, every alignment and length
+ *   vmtest usercopy                       kernel user copy through a pipe, including a fault
+ *   vmtest events <file>                  read/cow/shared fault counts seen by vm_events_get
+ *   vmtest readahead <file>               sequential and random read throughput, cache hit rate
+ *   vmtest spawn [parent MB] [loops]      fork and vfork latency from a large parent
+ *   vmtest fault [threads] [MB] [file]    concurrent page faults on anonymous or file memory
+ * Benchmarks print numbers only, checks print PASS or FAIL and set the exit code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "vmtest.h"
+
+/* same numbers and order as los_vm_event.h, the order is user visible and only appended to */
+#define NR_VM_EVENTS_GET        600
+enum {
+    EVENT_FAULT_READ = 0,
+    EVENT_FAULT_COW,
+    EVENT_FAULT_SHARED,
+    EVENT_CACHE_HIT,
+    EVENT_CACHE_MISS,
+    EVENT_RECLAIM_SCAN,
+    EVENT_RECLAIM_STEAL,
+    EVENT_PAGE_ALLOC,
+    EVENT_PAGE_FREE,
+    EVENT_NR_ITEMS
+};
+
+#define EVENTS_FAULT_PAGES      16
+#define READ_CHUNK              VMTEST_PAGE_SIZE
+#define SPAWN_PARENT_MB         100
+#define SPAWN_LOOPS             100
+#define FAULT_THREADS           4
+#define FAULT_THREADS_MAX       16
+#define FAULT_MB                16
+#define US_PER_SEC              1000000ULL
+#define NS_PER_US               1000ULL
+
+typedef struct {
+    volatile unsigned char *base;
+    size_t len;
+    int write;
+} FaultSlice;
+
+static unsigned long long NowUs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * US_PER_SEC + (unsigned long long)ts.tv_nsec / NS_PER_US;
+}
+
+static unsigned int MbPerSec(unsigned long long bytes, unsigned long long us)
+{
+    return (us == 0) ? 0 : (unsigned int)((bytes * US_PER_SEC / VMTEST_MB) / us);
+}
+
+static int EventsGet(unsigned int *events)
+{
+    (void)memset(events, 0, EVENT_NR_ITEMS * sizeof(unsigned int));
+    return (syscall(NR_VM_EVENTS_GET, events, EVENT_NR_ITEMS) < 0) ? -errno : 0;
+}
+
+static unsigned int EventDelta(const unsigned int *before, const unsigned int *after, int item)
+{
+    return after[item] - before[item];
+}
+
+/* touch one byte per page; the mapping is fresh, so every page takes exactly one fault */
+static void TouchPages(volatile unsigned char *base, size_t len, int write)
+{
+    volatile unsigned char sink;
+    size_t off;
+
+    for (off = 0; off < len; off += VMTEST_PAGE_SIZE) {
+        if (write) {
+            base[off] = (unsigned char)off;
+        } else {
+            sink = base[off];
+        }
+    }
+    (void)sink;
+}
+
+static int MapAndTouch(int fd, int flags, int write, unsigned int *delta, int item)
+{
+    unsigned int before[EVENT_NR_ITEMS];
+    unsigned int after[EVENT_NR_ITEMS];
+    size_t len = EVENTS_FAULT_PAGES * VMTEST_PAGE_SIZE;
+    unsigned char *map = NULL;
+
+    map = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("  mmap errno %d\n", errno);
+        return VMTEST_FAIL;
+    }
+    if (EventsGet(before) != 0) {
+        (void)munmap(map, len);
+        return VMTEST_FAIL;
+    }
+    TouchPages(map, len, write);
+    (void)EventsGet(after);
+    *delta = EventDelta(before, after, item);
+    (void)munmap(map, len);
+    return VMTEST_OK;
+}
+
+/*
+ * Known fault pattern against the counters. Counters are system wide, other tasks can only add,
+ * so read faults need at least one (neighbours are mapped by fault around), write faults one per page.
+ */
+static int TestEvents(const char *path)
+{
+    unsigned int events[EVENT_NR_ITEMS];
+    unsigned int readFaults = 0;
+    unsigned int cowFaults = 0;
+    unsigned int sharedFaults = 0;
+    struct stat st;
+    int fd;
+    int ret;
+
+    if (EventsGet(events) != 0) {
+        printf("events: FAIL, vm_events_get errno %d\n", errno);
+        return VMTEST_FAIL;
+    }
+    fd = open(path, O_RDWR);
+    if ((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size < EVENTS_FAULT_PAGES * VMTEST_PAGE_SIZE)) {
+        printf("events: FAIL, need a writable file of at least %d pages\n", EVENTS_FAULT_PAGES);
+        if (fd >= 0) {
+            (void)close(fd);
+        }
+        return VMTEST_FAIL;
+    }
+
+    ret = MapAndTouch(fd, MAP_PRIVATE, 0, &readFaults, EVENT_FAULT_READ);
+    ret |= MapAndTouch(fd, MAP_PRIVATE, 1, &cowFaults, EVENT_FAULT_COW);
+    ret |= MapAndTouch(fd, MAP_SHARED, 1, &sharedFaults, EVENT_FAULT_SHARED);
+    (void)close(fd);
+
+    printf("events: read %u cow %u shared %u for %d pages each\n", readFaults, cowFaults, sharedFaults,
+           EVENTS_FAULT_PAGES);
+    if ((ret != VMTEST_OK) || (readFaults == 0) || (cowFaults < EVENTS_FAULT_PAGES) ||
+        (sharedFaults < EVENTS_FAULT_PAGES)) {
+        printf("events: FAIL\n");
+        return VMTEST_FAIL;
+    }
+    printf("events: PASS\n");
+    return VMTEST_OK;
+}
+
+static void ReadPass(const char *name, int fd, off_t size, int random)
+{
+    static unsigned char buf[READ_CHUNK];
+    unsigned int before[EVENT_NR_ITEMS];
+    unsigned int after[EVENT_NR_ITEMS];
+    unsigned long long start;
+    unsigned long long bytes = 0;
+    off_t chunks = size / READ_CHUNK;
+    off_t i;
+    off_t off;
+    ssize_t n;
+
+    (void)EventsGet(before);
+    start = NowUs();
+    for (i = 0; i < chunks; i++) {
+        off = random ? ((off_t)rand() % chunks) * READ_CHUNK : i * READ_CHUNK;
+        n = pread(fd, buf, READ_CHUNK, off);
+        if (n <= 0) {
+            break;
+        }
+        bytes += (unsigned long long)n;
+    }
+    start = NowUs() - start;
+    (void)EventsGet(after);
+
+    printf("readahead: %-10s %8llu KB %6u MB/s  cache hit %u miss %u\n", name, bytes / 1024, /* 1024: KB */
+           MbPerSec(bytes, start), EventDelta(before, after, EVENT_CACHE_HIT),
+           EventDelta(before, after, EVENT_CACHE_MISS));
+}
+
+/* the first pass is cold only for a file not read since boot, or larger than the page cache */
+static int BenchReadahead(const char *path)
+{
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0)) {
+        printf("readahead: cannot open %s, errno %d\n", path, errno);
+        if (fd >= 0) {
+            (void)close(fd);
+        }
+        return VMTEST_FAIL;
+    }
+    ReadPass("sequential", fd, st.st_size, 0);
+    ReadPass("cached", fd, st.st_size, 0);
+    ReadPass("random", fd, st.st_size, 1);
+    (void)close(fd);
+    return VMTEST_OK;
+}
+
+static unsigned long long SpawnLoop(int useVfork, int loops)
+{
+    unsigned long long start = NowUs();
+    pid_t pid;
+    int i;
+
+    for (i = 0; i < loops; i++) {
+        pid = useVfork ? vfork() : fork();
+        if (pid == 0) {
+            _exit(0);
+        }
+        if (pid < 0) {
+            printf("spawn: %s errno %d\n", useVfork ? "vfork" : "fork", errno);
+            return 0;
+        }
+        (void)waitpid(pid, NULL, 0);
+    }
+    return (NowUs() - start) / (unsigned long long)loops;
+}
+
+/* fork copies the page tables of the whole parent, vfork borrows them */
+static int BenchSpawn(int parentMb, int loops)
+{
+    size_t len = (size_t)parentMb * VMTEST_MB;
+    unsigned char *mem = NULL;
+
+    if ((parentMb <= 0) || (loops <= 0)) {
+        printf("spawn: parent MB and loops must be positive\n");
+        return VMTEST_FAIL;
+    }
+    mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        printf("spawn: cannot map %d MB, errno %d\n", parentMb, errno);
+        return VMTEST_FAIL;
+    }
+    TouchPages(mem, len, 1);
+    printf("spawn: parent %d MB, fork %llu us, vfork %llu us per spawn\n", parentMb,
+           SpawnLoop(0, loops), SpawnLoop(1, loops));
+    (void)munmap(mem, len);
+    return VMTEST_OK;
+}
+
+static void *FaultThread(void *arg)
+{
+    FaultSlice *slice = (FaultSlice *)arg;
+
+    TouchPages(slice->base, slice->len, slice->write);
+    return NULL;
+}
+
+/* every thread faults in its own slice of one shared mapping */
+static int BenchFault(int threads, int mb, const char *path)
+{
+    pthread_t tid[FAULT_THREADS_MAX];
+    FaultSlice slice[FAULT_THREADS_MAX];
+    size_t len = (size_t)mb * VMTEST_MB;
+    size_t per;
+    unsigned char *map = NULL;
+    unsigned long long start;
+    int fd = -1;
+    int i;
+
+    if ((threads <= 0) || (threads > FAULT_THREADS_MAX) || (mb <= 0)) {
+        printf("fault: 1 to %d threads\n", FAULT_THREADS_MAX);
+        return VMTEST_FAIL;
+    }
+    if (path != NULL) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            printf("fault: cannot open %s, errno %d\n", path, errno);
+            return VMTEST_FAIL;
+        }
+    }
+    map = mmap(NULL, len, PROT_READ | PROT_WRITE, (fd < 0) ? (MAP_PRIVATE | MAP_ANONYMOUS) : MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("fault: mmap errno %d\n", errno);
+        if (fd >= 0) {
+            (void)close(fd);
+        }
+        return VMTEST_FAIL;
+    }
+
+    per = (len / (size_t)threads) & ~((size_t)VMTEST_PAGE_SIZE - 1);
+    start = NowUs();
+    for (i = 0; i < threads; i++) {
+        slice[i].base = map + per * (size_t)i;
+        slice[i].len = per;
+        slice[i].write = (fd < 0);
+        if (pthread_create(&tid[i], NULL, FaultThread, &slice[i]) != 0) {
+            threads = i;
+            break;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        (void)pthread_join(tid[i], NULL);
+    }
+    start = NowUs() - start;
+
+    printf("fault: %s %d threads, %zu pages in %llu us, %llu pages/s\n", (fd < 0) ? "anon" : path, threads,
+           per / VMTEST_PAGE_SIZE * (size_t)threads, start,
+           (start == 0) ? 0 : (unsigned long long)(per / VMTEST_PAGE_SIZE * (size_t)threads) * US_PER_SEC / start);
+    (void)munmap(map, len);
+    if (fd >= 0) {
+        (void)close(fd);
+    }
+    return VMTEST_OK;
+}
+
+static int ArgInt(int argc, char * const *argv, int index, int def)
+{
+    return (argc > index) ? atoi(argv[index]) : def;
+}
+
+static void Usage(void)
+{
+    printf("usage: vmtest string | usercopy | events <file> | readahead <file> |\n"
+           "              spawn [parent MB] [loops] | fault [threads] [MB] [file]\n");
+}
+
+int main(int argc, char * const *argv)
+{
+    const char *cmd = (argc > 1) ? argv[1] : "";
+
+    if (strcmp(cmd, "string") == 0) {
+        return VmTestString();
+    } else if (strcmp(cmd, "usercopy") == 0) {
+        return VmTestUserCopy();
+    } else if ((strcmp(cmd, "events") == 0) && (argc > 2)) { /* 2: file argument */
+        return TestEvents(argv[2]);
+    } else if ((strcmp(cmd, "readahead") == 0) && (argc > 2)) { /* 2: file argument */
+        return BenchReadahead(argv[2]);
+    } else if (strcmp(cmd, "spawn") == 0) {
+        return BenchSpawn(ArgInt(argc, argv, 2, SPAWN_PARENT_MB), ArgInt(argc, argv, 3, SPAWN_LOOPS)); /* 2, 3: args */
+    } else if (strcmp(cmd, "fault") == 0) {
+        return BenchFault(ArgInt(argc, argv, 2, FAULT_THREADS), ArgInt(argc, argv, 3, FAULT_MB), /* 2, 3: args */
+                          (argc > 4) ? argv[4] : NULL); /* 4: file argument */
+    }
+    Usage();
+    return VMTEST_FAIL;
+}
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Checks the libc string routines and the kernel user copy against byte loop references.
+ * Only standard C and POSIX is used, so the same file also builds on the host ("make host")
+ * to check the harness itself; on the board it exercises whatever memcpy, memset, memcmp,
+ * strlen and _arm_user_copy the image was built with.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "vmtest.h"
+
+#define STRING_ALIGN_MAX        16
+#define STRING_SMALL_LEN        160     /* every length below this */
+#define STRING_GUARD            64
+#define STRING_GUARD_BYTE       0xa5
+#define STRING_BUF_LEN          (8192 + STRING_ALIGN_MAX + (STRING_GUARD * 2))
+#define USER_COPY_ALIGN_MAX     8
+#define USER_COPY_SMALL_LEN     72
+#define USER_COPY_BUF_LEN       (512 + USER_COPY_ALIGN_MAX + (STRING_GUARD * 2))
+
+static const size_t g_stringLargeLens[] = {
+    255, 256, 257, 511, 512, 513, 1023, 1024, 1025, 4095, 4096, 4097, 8191, 8192
+};
+static const size_t g_userCopyLens[] = {
+    100, 127, 128, 129, 255, 256, 257, 511, 512
+};
+
+static unsigned char g_src[STRING_BUF_LEN];
+static unsigned char g_dst[STRING_BUF_LEN];
+static unsigned int g_seed = 0x2545f491;
+static int g_errors;
+
+static unsigned char RandByte(void)
+{
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 17;
+    g_seed ^= g_seed << 5;
+    return (unsigned char)g_seed;
+}
+
+static void FillRandom(unsigned char *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = RandByte();
+    }
+}
+
+static void Report(const char *what, size_t srcAlign, size_t dstAlign, size_t len)
+{
+    if (g_errors < 10) { /* 10: enough to see the pattern */
+        printf("  %s failed: src align %zu dst align %zu len %zu\n", what, srcAlign, dstAlign, len);
+    }
+    g_errors++;
+}
+
+/* the bytes in front of and behind [start, start + len) must still hold the guard */
+static int GuardIntact(const unsigned char *buf, size_t bufLen, size_t start, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < start; i++) {
+        if (buf[i] != STRING_GUARD_BYTE) {
+            return 0;
+        }
+    }
+    for (i = start + len; i < bufLen; i++) {
+        if (buf[i] != STRING_GUARD_BYTE) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void CheckMemcpy(size_t srcAlign, size_t dstAlign, size_t len)
+{
+    unsigned char *src = g_src + STRING_GUARD + srcAlign;
+    size_t start = STRING_GUARD + dstAlign;
+    void *ret = NULL;
+
+    (void)memset(g_dst, STRING_GUARD_BYTE, sizeof(g_dst));
+    ret = memcpy(g_dst + start, src, len);
+    if ((ret != g_dst + start) || (memcmp(g_dst + start, src, len) != 0) ||
+        !GuardIntact(g_dst, sizeof(g_dst), start, len)) {
+        Report("memcpy", srcAlign, dstAlign, len);
+    }
+}
+
+static void CheckMemset(size_t dstAlign, size_t len)
+{
+    static const int values[] = { 0, 0x5a, 0xff, 0x1ff }; /* 0x1ff: only the low byte counts */
+    size_t start = STRING_GUARD + dstAlign;
+    size_t v;
+    size_t i;
+    void *ret = NULL;
+
+    for (v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+        (void)memset(g_dst, STRING_GUARD_BYTE, sizeof(g_dst));
+        ret = memset(g_dst + start, values[v], len);
+        for (i = 0; i < len; i++) {
+            if (g_dst[start + i] != (unsigned char)values[v]) {
+                break;
+            }
+        }
+        if ((ret != g_dst + start) || (i != len) || !GuardIntact(g_dst, sizeof(g_dst), start, len)) {
+            Report("memset", 0, dstAlign, len);
+        }
+    }
+}
+
+static int Sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+/* equal buffers, then one differing byte at the front, middle and back, both ways round */
+static void CheckMemcmp(size_t srcAlign, size_t dstAlign, size_t len)
+{
+    unsigned char *a = g_src + STRING_GUARD + srcAlign;
+    unsigned char *b = g_dst + STRING_GUARD + dstAlign;
+    size_t pos[3]; /* 3: front, middle, back */
+    size_t p;
+
+    (void)memcpy(b, a, len);
+    if (memcmp(a, b, len) != 0) {
+        Report("memcmp equal", srcAlign, dstAlign, len);
+    }
+    if (len == 0) {
+        return;
+    }
+
+    pos[0] = 0;
+    pos[1] = len / 2; /* 2: middle */
+    pos[2] = len - 1;
+    for (p = 0; p < sizeof(pos) / sizeof(pos[0]); p++) {
+        unsigned char saveA = a[pos[p]];
+        unsigned char saveB = b[pos[p]];
+
+        a[pos[p]] = 0x80; /* compared as unsigned char, 0x80 > 0x7f */
+        b[pos[p]] = 0x7f;
+        if ((Sign(memcmp(a, b, len)) != 1) || (Sign(memcmp(b, a, len)) != -1)) {
+            Report("memcmp order", srcAlign, dstAlign, len);
+        }
+        a[pos[p]] = saveA;
+        b[pos[p]] = saveB;
+    }
+}
+
+static void CheckStrlen(size_t align, size_t len)
+{
+    char *s = (char *)g_dst + STRING_GUARD + align;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        s[i] = (char)(RandByte() | 0x80); /* high bit set, catches signed byte tests */
+    }
+    s[len] = '\0';
+    (void)memset(s + len + 1, 0xff, STRING_ALIGN_MAX);
+    if (strlen(s) != len) {
+        Report("strlen", 0, align, len);
+    }
+}
+
+static void CheckOne(size_t srcAlign, size_t dstAlign, size_t len)
+{
+    CheckMemcpy(srcAlign, dstAlign, len);
+    CheckMemcmp(srcAlign, dstAlign, len);
+    if (srcAlign == 0) {
+        CheckMemset(dstAlign, len);
+        CheckStrlen(dstAlign, len);
+    }
+}
+
+/*
+ * Word at a time routines must not read past the end of the buffer into the next page.
+ * The buffers end right at a PROT_NONE page, an over-read faults the test.
+ */
+static void CheckPageEnd(void)
+{
+    unsigned char *map = NULL;
+    unsigned char *end = NULL;
+    unsigned char tmp[STRING_ALIGN_MAX * 2];
+    size_t len;
+
+    map = mmap(NULL, VMTEST_PAGE_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        printf("  page end check skipped, mmap errno %d\n", errno);
+        return;
+    }
+    if (mprotect(map + VMTEST_PAGE_SIZE, VMTEST_PAGE_SIZE, PROT_NONE) != 0) {
+        printf("  page end check skipped, mprotect errno %d\n", errno);
+        (void)munmap(map, VMTEST_PAGE_SIZE * 2);
+        return;
+    }
+
+    end = map + VMTEST_PAGE_SIZE;
+    (void)memset(map, 'x', VMTEST_PAGE_SIZE);
+    for (len = 1; len < sizeof(tmp); len++) {
+        end[-1] = '\0';
+        if (strlen((const char *)(end - len)) != len - 1) {
+            Report("strlen page end", 0, 0, len);
+        }
+        end[-1] = 'x';
+        (void)memcpy(tmp, end - len, len);
+        if (memcmp(tmp, end - len, len) != 0) {
+            Report("memcpy page end", 0, 0, len);
+        }
+    }
+    (void)munmap(map, VMTEST_PAGE_SIZE * 2);
+}
+
+int VmTestString(void)
+{
+    size_t srcAlign;
+    size_t dstAlign;
+    size_t len;
+    size_t i;
+
+    g_errors = 0;
+    FillRandom(g_src, sizeof(g_src));
+    for (srcAlign = 0; srcAlign < STRING_ALIGN_MAX; srcAlign++) {
+        for (dstAlign = 0; dstAlign < STRING_ALIGN_MAX; dstAlign++) {
+            for (len = 0; len < STRING_SMALL_LEN; len++) {
+                CheckOne(srcAlign, dstAlign, len);
+            }
+            for (i = 0; i < sizeof(g_stringLargeLens) / sizeof(g_stringLargeLens[0]); i++) {
+                CheckOne(srcAlign, dstAlign, g_stringLargeLens[i]);
+            }
+        }
+    }
+    CheckPageEnd();
+
+    printf("string: %s, %d errors\n", (g_errors == 0) ? "PASS" : "FAIL", g_errors);
+    return (g_errors == 0) ? VMTEST_OK : VMTEST_FAIL;
+}
+
+/* write() copies from user and read() copies back to user, both at the given alignments */
+static void CheckPipeCopy(const int fds[2], size_t srcAlign, size_t dstAlign, size_t len)
+{
+    unsigned char *src = g_src + STRING_GUARD + srcAlign;
+    size_t start = STRING_GUARD + dstAlign;
+    size_t done = 0;
+    ssize_t ret;
+
+    (void)memset(g_dst, STRING_GUARD_BYTE, USER_COPY_BUF_LEN);
+    if (write(fds[1], src, len) != (ssize_t)len) {
+        Report("copy from user", srcAlign, dstAlign, len);
+        return;
+    }
+    while (done < len) {
+        ret = read(fds[0], g_dst + start + done, len - done);
+        if (ret <= 0) {
+            Report("copy to user", srcAlign, dstAlign, len);
+            return;
+        }
+        done += (size_t)ret;
+    }
+    if ((memcmp(g_dst + start, src, len) != 0) || !GuardIntact(g_dst, USER_COPY_BUF_LEN, start, len)) {
+        Report("user copy data", srcAlign, dstAlign, len);
+    }
+}
+
+/* a user buffer that runs into a PROT_NONE page must fail the syscall, not the kernel */
+static void CheckPipeFault(const int fds[2])
+{
+    unsigned char *map = NULL;
+    unsigned char buf[VMTEST_PAGE_SIZE / 4]; /* 4: a quarter page is enough to drain */
+    ssize_t ret;
+
+    map = mmap(NULL, VMTEST_PAGE_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        printf("  user copy fault check skipped, mmap errno %d\n", errno);
+        return;
+    }
+    if (mprotect(map + VMTEST_PAGE_SIZE, VMTEST_PAGE_SIZE, PROT_NONE) != 0) {
+        printf("  user copy fault check skipped, mprotect errno %d\n", errno);
+        (void)munmap(map, VMTEST_PAGE_SIZE * 2);
+        return;
+    }
+
+    (void)memset(map, 'y', VMTEST_PAGE_SIZE);
+    if (write(fds[1], map + VMTEST_PAGE_SIZE - 64, 64) != 64) { /* 64: ends right at the page end */
+        Report("copy from user page end", 0, 0, 64);
+    }
+    (void)read(fds[0], buf, sizeof(buf));
+    ret = write(fds[1], map + VMTEST_PAGE_SIZE - 64, 128); /* 64 readable, 64 not */
+    if (ret == 128) {
+        Report("copy from user fault", 0, 0, 128);
+    }
+    if (ret > 0) {
+        (void)read(fds[0], buf, sizeof(buf));
+    }
+    (void)munmap(map, VMTEST_PAGE_SIZE * 2);
+}
+
+int VmTestUserCopy(void)
+{
+    int fds[2]; /* 2: read and write end */
+    size_t srcAlign;
+    size_t dstAlign;
+    size_t len;
+    size_t i;
+
+    g_errors = 0;
+    if (pipe(fds) != 0) {
+        printf("usercopy: SKIP, pipe errno %d\n", errno);
+        return VMTEST_OK;
+    }
+    FillRandom(g_src, sizeof(g_src));
+    for (srcAlign = 0; srcAlign < USER_COPY_ALIGN_MAX; srcAlign++) {
+        for (dstAlign = 0; dstAlign < USER_COPY_ALIGN_MAX; dstAlign++) {
+            for (len = 1; len < USER_COPY_SMALL_LEN; len++) {
+                CheckPipeCopy(fds, srcAlign, dstAlign, len);
+            }
+            for (i = 0; i < sizeof(g_userCopyLens) / sizeof(g_userCopyLens[0]); i++) {
+                CheckPipeCopy(fds, srcAlign, dstAlign, g_userCopyLens[i]);
+            }
+        }
+    }
+    CheckPipeFault(fds);
+    (void)close(fds[0]);
+    (void)close(fds[1]);
+
+    printf("usercopy: %s, %d errors\n", (g_errors == 0) ? "PASS" : "FAIL", g_errors);
+    return (g_errors == 0) ? VMTEST_OK : VMTEST_FAIL;
+}
+
+#ifdef VMTEST_HOST
+int main(void)
+{
+    int ret = VmTestString();
+
+    ret |= VmTestUserCopy();
+    return ret;
+}
+#endif
@@ -31,7 +31,7 @@
 
 #include "los_typedef.h"
 #pragma once
-//汇编代码实现 见于..\third_party\FreeBSD\lib\libc\arm\string\hw_user_copy.S
+//汇编代码实现 见于 arch/arm/arm/src/hw_user_copy.S,32字节 ldm/stm 成块拷贝,开启 NEON 时长拷贝走 vld1/vst1
 /****************************************
 用户空间 <---> 内核空间的拷贝实现函数,由上层封装从哪到哪的拷贝
 根据参数的不同来实现相互的拷贝
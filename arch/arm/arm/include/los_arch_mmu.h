@@ -74,9 +74,14 @@ typedef struct ArchMmu {//内存管理单元
 BOOL OsArchMmuInit(LosArchMmu *archMmu, VADDR_T *virtTtb);
 STATUS_T LOS_ArchMmuQuery(const LosArchMmu *archMmu, VADDR_T vaddr, PADDR_T *paddr, UINT32 *flags);
 STATUS_T LOS_ArchMmuUnmap(LosArchMmu *archMmu, VADDR_T vaddr, size_t count);
+STATUS_T LOS_ArchMmuUnmapNoFlush(LosArchMmu *archMmu, VADDR_T vaddr, size_t count);
+VOID LOS_ArchMmuTlbFlush(const LosArchMmu *archMmu);
 STATUS_T LOS_ArchMmuMap(LosArchMmu *archMmu, VADDR_T vaddr, PADDR_T paddr, size_t count, UINT32 flags);
 STATUS_T LOS_ArchMmuChangeProt(LosArchMmu *archMmu, VADDR_T vaddr, size_t count, UINT32 flags);
 STATUS_T LOS_ArchMmuMove(LosArchMmu *archMmu, VADDR_T oldVaddr, VADDR_T newVaddr, size_t count, UINT32 flags);
+STATUS_T LOS_ArchMmuCloneRange(LosArchMmu *srcMmu, LosArchMmu *dstMmu, VADDR_T vaddr, size_t count);
+STATUS_T LOS_ArchMmuSwapOut(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 entry);
+STATUS_T LOS_ArchMmuSwapEntryGet(const LosArchMmu *archMmu, VADDR_T vaddr, UINT32 *entry);
 VOID LOS_ArchMmuContextSwitch(LosArchMmu *archMmu);
 STATUS_T LOS_ArchMmuDestroy(LosArchMmu *archMmu);
 VOID OsArchMmuInitPerCPU(VOID);
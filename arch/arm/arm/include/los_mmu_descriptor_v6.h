@@ -169,6 +169,28 @@ extern "C" {
 #define MMU_DESCRIPTOR_L2_NON_GLOBAL                            (1 << 11)
 #define MMU_DESCRIPTOR_L2_SMALL_PAGE_ADDR(x)                    ((x) & MMU_DESCRIPTOR_L2_SMALL_FRAME)
 
+/* L2 large page, 64K, one descriptor replicated in 16 consecutive entries */
+#define MMU_DESCRIPTOR_L2_LARGE_SIZE                            0x10000 //64K
+#define MMU_DESCRIPTOR_L2_LARGE_MASK                            (MMU_DESCRIPTOR_L2_LARGE_SIZE - 1)
+#define MMU_DESCRIPTOR_L2_LARGE_FRAME                           (~MMU_DESCRIPTOR_L2_LARGE_MASK)
+#define MMU_DESCRIPTOR_L2_LARGE_SHIFT                           16
+#define MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE                     \
+    (MMU_DESCRIPTOR_L2_LARGE_SIZE >> MMU_DESCRIPTOR_L2_SMALL_SHIFT)
+#define MMU_DESCRIPTOR_IS_L2_LARGE_SIZE_ALIGNED(x)              IS_ALIGNED(x, MMU_DESCRIPTOR_L2_LARGE_SIZE)
+#define MMU_DESCRIPTOR_L2_LARGE_PAGE_ADDR(x)                    ((x) & MMU_DESCRIPTOR_L2_LARGE_FRAME)
+#define MMU_DESCRIPTOR_L2_LARGE_TEX_SHIFT                       12 //大页的TEX位于[14:12]
+#define MMU_DESCRIPTOR_L2_LARGE_TEX_MASK                        (MMU_DESCRIPTOR_TEX_MASK << MMU_DESCRIPTOR_L2_LARGE_TEX_SHIFT)
+#define MMU_DESCRIPTOR_L2_LARGE_XN                              (1 << 15)
+/* bits that small and large page descriptors share: B C AP S nG */
+#define MMU_DESCRIPTOR_L2_PAGE_COMMON_MASK                      \
+    (MMU_DESCRIPTOR_WRITE_BACK_NO_ALLOCATE | MMU_DESCRIPTOR_L2_AP_MASK | \
+    MMU_DESCRIPTOR_L2_SHAREABLE | MMU_DESCRIPTOR_L2_NON_GLOBAL)
+
+/* swapped out page: a fault (type 00) L2 entry, the hardware ignores bits [31:2] which hold the swap entry */
+#define MMU_DESCRIPTOR_L2_SWAP_SHIFT                            2
+#define MMU_DESCRIPTOR_L2_SWAP_PTE(entry)                       ((PTE_T)(entry) << MMU_DESCRIPTOR_L2_SWAP_SHIFT)
+#define MMU_DESCRIPTOR_L2_SWAP_ENTRY(pte2)                      ((UINT32)(pte2) >> MMU_DESCRIPTOR_L2_SWAP_SHIFT)
+
 #define MMU_DESCRIPTOR_TTBCR_PD0                                (1 << 4)
 #define MMU_DESCRIPTOR_TTBR_WRITE_BACK_ALLOCATE                 1
 #define MMU_DESCRIPTOR_TTBR_RGN(x)                              (((x) & 0x3) << 3)
@@ -135,6 +135,20 @@ STATIC INLINE UINT32 OsSavePte2Continuous(PTE_T *pte2BasePtr, UINT32 index, PTE_
     return saveCounts;
 }
 
+//大页描述符须在16个连续的L2表项中重复填写,index须按16对齐
+STATIC INLINE UINT32 OsSavePte2Large(PTE_T *pte2BasePtr, UINT32 index, PTE_T pte2)
+{
+    UINT32 i;
+
+    DMB;
+    for (i = 0; i < MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE; i++) {
+        pte2BasePtr[index + i] = pte2;
+    }
+    DSB;
+
+    return MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE;
+}
+
 STATIC INLINE VOID OsClearPte2Continuous(PTE_T *pte2Ptr, UINT32 count)
 {
     UINT32 index = 0;
@@ -166,6 +180,11 @@ STATIC INLINE BOOL OsIsPte2Invalid(PTE_T pte2)
 {
     return (pte2 & MMU_DESCRIPTOR_L2_TYPE_MASK) == MMU_DESCRIPTOR_L2_TYPE_INVALID;
 }
+//无效但不为0的L2表项,记录的是页被换出到压缩交换区的位置
+STATIC INLINE BOOL OsIsPte2Swap(PTE_T pte2)
+{
+    return OsIsPte2Invalid(pte2) && (pte2 != 0);
+}
 
 #ifdef __cplusplus
 #if __cplusplus
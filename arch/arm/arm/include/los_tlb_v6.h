@@ -77,6 +77,63 @@ STATIC INLINE VOID OsArmInvalidateTlbMvaRangeNoBarrier(VADDR_T start, UINT32 cou
     }
 }
 
+/* ranges longer than this are dropped by asid instead of page by page */
+#define TLB_INVALIDATE_RANGE_PAGES_MAX  64
+
+//按 mva + asid 失效一页,global表项只要mva匹配同样会被失效
+STATIC INLINE VOID OsArmInvalidateTlbMvaAsidNoBarrier(VADDR_T va, UINT32 asid)
+{
+#ifdef LOSCFG_KERNEL_SMP
+    OsArmWriteTlbimvais((va & 0xfffff000) | (asid & 0xff));
+#else
+    OsArmWriteTlbimva((va & 0xfffff000) | (asid & 0xff));
+#endif
+}
+//失效该asid的全部non-global表项,不影响其他进程和内核的global表项
+STATIC INLINE VOID OsArmInvalidateTlbAsidNoBarrier(UINT32 asid)
+{
+#ifdef LOSCFG_KERNEL_SMP
+    OsArmWriteTlbiasidis(asid & 0xff);
+#else
+    OsArmWriteTlbiasid(asid & 0xff);
+#endif
+}
+
+STATIC INLINE VOID OsArmInvalidateTlbAllNoBarrier(VOID)
+{
+#ifdef LOSCFG_KERNEL_SMP
+    OsArmWriteTlbiallis(0);
+#else
+    OsArmWriteTlbiall(0);
+#endif
+}
+
+/*
+ * invalidate [start, start + count pages) of one address space. user mappings are
+ * non-global, so a long range costs a single asid operation; kernel mappings are
+ * global and fall back to invalidating everything. on SMP the inner shareable
+ * forms broadcast in hardware, the caller issues one barrier after the batch.
+ */
+STATIC INLINE VOID OsArmInvalidateTlbRangeAsidNoBarrier(VADDR_T start, UINT32 count, UINT32 asid, BOOL user)
+{
+    UINT32 index = 0;
+
+    if (count > TLB_INVALIDATE_RANGE_PAGES_MAX) {
+        if (user) {
+            OsArmInvalidateTlbAsidNoBarrier(asid);
+        } else {
+            OsArmInvalidateTlbAllNoBarrier();
+        }
+        return;
+    }
+
+    while (count > 0) {
+        OsArmInvalidateTlbMvaAsidNoBarrier(start + (index << MMU_DESCRIPTOR_L2_SMALL_SHIFT), asid);
+        index++;
+        count--;
+    }
+}
+
 STATIC INLINE VOID OsCleanTLB(VOID)
 {
     UINT32 val = 0;
@@ -44,6 +44,9 @@
 #include "los_vm_map.h"
 #include "los_vm_boot.h"
 #include "los_mmu_descriptor_v6.h"
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+#include "los_vm_zram.h"
+#endif
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -69,6 +72,44 @@ STATIC INLINE PTE_T *OsGetPte2BasePtr(PTE_T pte1)
     PADDR_T pa = MMU_DESCRIPTOR_L1_PAGE_TABLE_ADDR(pte1);
     return LOS_PaddrToKVaddr(pa);
 }
+//小页描述符转大页描述符:TEX由[8:6]移到[14:12],XN由bit0移到bit15,物理地址按64K截断
+STATIC INLINE PTE_T OsCvtPte2SmallToLarge(PTE_T pte2)
+{
+    PTE_T large = MMU_DESCRIPTOR_L2_LARGE_PAGE_ADDR(pte2) | (pte2 & MMU_DESCRIPTOR_L2_PAGE_COMMON_MASK) |
+        MMU_DESCRIPTOR_L2_TYPE_LARGE_PAGE;
+
+    large |= ((pte2 >> MMU_DESCRIPTOR_L2_TEX_SHIFT) & MMU_DESCRIPTOR_TEX_MASK) << MMU_DESCRIPTOR_L2_LARGE_TEX_SHIFT;
+    if (OsIsPte2SmallPageXN(pte2)) {
+        large |= MMU_DESCRIPTOR_L2_LARGE_XN;
+    }
+    return large;
+}
+//大页描述符转为其中第 index 个4K小页的描述符
+STATIC INLINE PTE_T OsCvtPte2LargeToSmall(PTE_T pte2, UINT32 index)
+{
+    PTE_T small = MMU_DESCRIPTOR_L2_LARGE_PAGE_ADDR(pte2) +
+        ((index % MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE) << MMU_DESCRIPTOR_L2_SMALL_SHIFT);
+
+    small |= (pte2 & MMU_DESCRIPTOR_L2_PAGE_COMMON_MASK);
+    small |= MMU_DESCRIPTOR_L2_TEX((pte2 & MMU_DESCRIPTOR_L2_LARGE_TEX_MASK) >> MMU_DESCRIPTOR_L2_LARGE_TEX_SHIFT);
+    small |= (pte2 & MMU_DESCRIPTOR_L2_LARGE_XN) ? MMU_DESCRIPTOR_L2_TYPE_SMALL_PAGE_XN :
+        MMU_DESCRIPTOR_L2_TYPE_SMALL_PAGE;
+    return small;
+}
+/* split the large page holding index into 16 small pages, same frames and attributes.
+ * the old large TLB entry stays valid until one of its pages is invalidated by mva */
+STATIC VOID OsDemoteLargePage(PTE_T *pte2BasePtr, UINT32 index)
+{
+    UINT32 i;
+    UINT32 base = ROUNDDOWN(index, MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE);
+    PTE_T pte2 = pte2BasePtr[base];
+
+    DMB;
+    for (i = 0; i < MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE; i++) {
+        pte2BasePtr[base + i] = OsCvtPte2LargeToSmall(pte2, i);
+    }
+    DSB;
+}
 //解除L1表的映射关系
 STATIC INLINE UINT32 OsUnmapL1Invalid(vaddr_t *vaddr, UINT32 *count)
 {
@@ -304,10 +345,25 @@ STATIC VOID OsCvtSecAttsToFlags(PTE_T l1Entry, UINT32 *flags)
     }
 }
 
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+//解除映射时,换出页表项所引用的压缩交换区槽位随之释放
+STATIC VOID OsSwapPte2Release(const PTE_T *pte2Ptr, UINT32 count)
+{
+    UINT32 index;
+
+    for (index = 0; index < count; index++) {
+        if (OsIsPte2Swap(pte2Ptr[index])) {
+            OsVmZramEntryPut(MMU_DESCRIPTOR_L2_SWAP_ENTRY(pte2Ptr[index]));
+        }
+    }
+}
+#endif
+
 STATIC UINT32 OsUnmapL2PTE(const LosArchMmu *archMmu, vaddr_t vaddr, UINT32 *count)
 {
     UINT32 unmapCount;
     UINT32 pte2Index;
+    UINT32 pte2End;
     PTE_T *pte2BasePtr = NULL;
 
     pte2BasePtr = OsGetPte2BasePtr(OsGetPte1((PTE_T *)archMmu->virtTtb, vaddr));
@@ -318,11 +374,21 @@ STATIC UINT32 OsUnmapL2PTE(const LosArchMmu *archMmu, vaddr_t vaddr, UINT32 *cou
     pte2Index = OsGetPte2Index(vaddr);
     unmapCount = MIN2(MMU_DESCRIPTOR_L2_NUMBERS_PER_L1 - pte2Index, *count);
 
-    /* unmap page run */
-    OsClearPte2Continuous(&pte2BasePtr[pte2Index], unmapCount);
+    /* large pages only partly covered by the run are split first */
+    if (OsIsPte2LargePage(pte2BasePtr[pte2Index]) &&
+        ((pte2Index % MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE) || (unmapCount < MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE))) {
+        OsDemoteLargePage(pte2BasePtr, pte2Index);
+    }
+    pte2End = pte2Index + unmapCount;
+    if (OsIsPte2LargePage(pte2BasePtr[pte2End - 1]) && (pte2End % MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE)) {
+        OsDemoteLargePage(pte2BasePtr, pte2End - 1);
+    }
 
-    /* invalidate tlb */
-    OsArmInvalidateTlbMvaRangeNoBarrier(vaddr, unmapCount);
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    OsSwapPte2Release(&pte2BasePtr[pte2Index], unmapCount);
+#endif
+    /* unmap page run, tlb is invalidated once for the whole range by the caller */
+    OsClearPte2Continuous(&pte2BasePtr[pte2Index], unmapCount);
 
     *count -= unmapCount;
     return unmapCount;
@@ -331,7 +397,6 @@ STATIC UINT32 OsUnmapL2PTE(const LosArchMmu *archMmu, vaddr_t vaddr, UINT32 *cou
 STATIC UINT32 OsUnmapSection(LosArchMmu *archMmu, vaddr_t *vaddr, UINT32 *count)
 {
     OsClearPte1(OsGetPte1Ptr((PTE_T *)archMmu->virtTtb, *vaddr));
-    OsArmInvalidateTlbMvaNoBarrier(*vaddr);
 
     *vaddr += MMU_DESCRIPTOR_L1_SMALL_SIZE;
     *count -= MMU_DESCRIPTOR_L2_NUMBERS_PER_L1;
@@ -395,8 +460,14 @@ STATUS_T LOS_ArchMmuQuery(const LosArchMmu *archMmu, VADDR_T vaddr, PADDR_T *pad
             if (flags != NULL) {
                 OsCvtPte2AttsToFlags(l1Entry, l2Entry, flags);//获取虚拟内存的flag信息
             }
-        } else if (OsIsPte2LargePage(l2Entry)) {//鸿蒙目前暂不支持64K大页，未来手机版应该会支持。
-            LOS_Panic("%s %d, large page unimplemented\n", __FUNCTION__, __LINE__);
+        } else if (OsIsPte2LargePage(l2Entry)) {//64K大页: 物理地址 = 大页基地址(L2页表项的高16位) + 虚拟地址低16位
+            if (paddr != NULL) {
+                *paddr = MMU_DESCRIPTOR_L2_LARGE_PAGE_ADDR(l2Entry) + (vaddr & MMU_DESCRIPTOR_L2_LARGE_MASK);
+            }
+
+            if (flags != NULL) {
+                OsCvtPte2AttsToFlags(l1Entry, OsCvtPte2LargeToSmall(l2Entry, 0), flags);
+            }
         } else {
             return LOS_ERRNO_VM_NOT_FOUND;
         }
@@ -404,8 +475,16 @@ STATUS_T LOS_ArchMmuQuery(const LosArchMmu *archMmu, VADDR_T vaddr, PADDR_T *pad
 
     return LOS_OK;
 }
-//解除映射关系
-STATUS_T LOS_ArchMmuUnmap(LosArchMmu *archMmu, VADDR_T vaddr, size_t count)
+
+//失效 archMmu 中 [vaddr, vaddr + count页) 的TLB,用户空间带asid,过长的范围整体失效
+STATIC INLINE VOID OsInvalidateTlbRangeNoBarrier(const LosArchMmu *archMmu, VADDR_T vaddr, UINT32 count)
+{
+    OsArmInvalidateTlbRangeAsidNoBarrier(vaddr, count, archMmu->asid, LOS_IsUserAddress(vaddr));
+}
+
+STATIC STATUS_T OsDemoteSection(LosArchMmu *archMmu, VADDR_T vaddr);
+//清除 [vaddr, vaddr + count页) 的页表项,不失效TLB,由调用者对整段统一失效
+STATIC INT32 OsUnmapRange(LosArchMmu *archMmu, VADDR_T vaddr, size_t count)
 {
     PTE_T l1Entry;
     INT32 unmapped = 0;
@@ -418,8 +497,11 @@ STATUS_T LOS_ArchMmuUnmap(LosArchMmu *archMmu, VADDR_T vaddr, size_t count)
         } else if (OsIsPte1Section(l1Entry)) {// section页表项: l1Entry低二位是否为 10
             if (MMU_DESCRIPTOR_IS_L1_SIZE_ALIGNED(vaddr) && count >= MMU_DESCRIPTOR_L2_NUMBERS_PER_L1) {//对齐1M
                 unmapCount = OsUnmapSection(archMmu, &vaddr, &count);//解除section格式项映射关系
-            } else {
-                LOS_Panic("%s %d, unimplemented\n", __FUNCTION__, __LINE__);
+            } else {//只解除section的一部分,先拆成L2表再按页表项处理
+                if (OsDemoteSection(archMmu, vaddr) != LOS_OK) {
+                    LOS_Panic("%s %d, failed to allocate pagetable\n", __FUNCTION__, __LINE__);
+                }
+                continue;
             }
         } else if (OsIsPte1PageTable(l1Entry)) {// section页表项: l1Entry低二位是否为 10
             unmapCount = OsUnmapL2PTE(archMmu, vaddr, &count);//解除L2 映射关系
@@ -431,9 +513,35 @@ STATUS_T LOS_ArchMmuUnmap(LosArchMmu *archMmu, VADDR_T vaddr, size_t count)
         }
         unmapped += unmapCount;
     }
+    return unmapped;
+}
+//解除映射关系
+STATUS_T LOS_ArchMmuUnmap(LosArchMmu *archMmu, VADDR_T vaddr, size_t count)
+{
+    INT32 unmapped = OsUnmapRange(archMmu, vaddr, count);
+
+    OsInvalidateTlbRangeNoBarrier(archMmu, vaddr, count);//整段只失效一次,超过阈值按asid失效
     OsArmInvalidateTlbBarrier();//TLB失效，不可用
     return unmapped;
 }
+//只清页表项不失效TLB,调用者保证这段地址在 LOS_ArchMmuTlbFlush 之前不会被访问或重新映射
+STATUS_T LOS_ArchMmuUnmapNoFlush(LosArchMmu *archMmu, VADDR_T vaddr, size_t count)
+{
+    INT32 unmapped = OsUnmapRange(archMmu, vaddr, count);
+
+    DSB;//释放的L2表已由 OsTryUnmapL1PTE 失效,等它完成后L2表所在的页才能被复用
+    return unmapped;
+}
+//失效整个空间的TLB:用户空间按asid失效,内核空间共用L1表且表项是global的,只能全部失效
+VOID LOS_ArchMmuTlbFlush(const LosArchMmu *archMmu)
+{
+    if (archMmu->virtTtb == OsGFirstTableGet()) {
+        OsArmInvalidateTlbAllNoBarrier();
+    } else {
+        OsArmInvalidateTlbAsidNoBarrier(archMmu->asid);
+    }
+    OsArmInvalidateTlbBarrier();
+}
 //section页表格式项映射
 STATIC UINT32 OsMapSection(const LosArchMmu *archMmu, UINT32 flags, VADDR_T *vaddr,
                            PADDR_T *paddr, UINT32 *count)
@@ -553,11 +661,48 @@ STATIC UINT32 OsCvtPte2FlagsToAttrs(uint32_t flags)//状态的转换(映射),从
     return mmuFlags;
 }
 
+/**************************************************************************************************
+ 把 vaddr 所在的1M section 拆成一张L2表,物理地址和权限不变.
+ 先把256个表项按16个64K大页填好,再把L1项换成page table格式,其他CPU不会看到空洞.
+**************************************************************************************************/
+STATIC STATUS_T OsDemoteSection(LosArchMmu *archMmu, VADDR_T vaddr)
+{
+    UINT32 flags;
+    UINT32 index;
+    PTE_T pte1;
+    PTE_T pte2;
+    paddr_t pte2Base = 0;
+    PTE_T *pte2BasePtr = NULL;
+    PTE_T *pte1Ptr = OsGetPte1Ptr(archMmu->virtTtb, vaddr);
+
+    if (OsGetL2Table(archMmu, OsGetPte1Index(vaddr), &pte2Base) != LOS_OK) {
+        return LOS_ERRNO_VM_NO_MEMORY;
+    }
+
+    OsCvtSecAttsToFlags(*pte1Ptr, &flags);
+    pte2 = OsCvtPte2SmallToLarge(MMU_DESCRIPTOR_L1_SECTION_ADDR(*pte1Ptr) | OsCvtPte2FlagsToAttrs(flags));
+    pte2BasePtr = LOS_PaddrToKVaddr(pte2Base);
+    for (index = 0; index < MMU_DESCRIPTOR_L2_NUMBERS_PER_L1; index += MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE) {
+        (VOID)OsSavePte2Large(pte2BasePtr, index, pte2 + (index << MMU_DESCRIPTOR_L2_SMALL_SHIFT));
+    }
+
+    pte1 = pte2Base | MMU_DESCRIPTOR_L1_TYPE_PAGE_TABLE;
+    if (flags & VM_MAP_REGION_FLAG_NS) {
+        pte1 |= MMU_DESCRIPTOR_L1_PAGETABLE_NON_SECURE;
+    }
+    pte1 &= MMU_DESCRIPTOR_L1_SMALL_DOMAIN_MASK;
+    pte1 |= MMU_DESCRIPTOR_L1_SMALL_DOMAIN_CLIENT;
+    OsSavePte1(pte1Ptr, pte1);
+    OsArmInvalidateTlbMvaAsidNoBarrier(ROUNDDOWN(vaddr, MMU_DESCRIPTOR_L1_SMALL_SIZE), archMmu->asid);
+    return LOS_OK;
+}
+
 STATIC UINT32 OsMapL2PageContinous(PTE_T pte1, UINT32 flags, VADDR_T *vaddr, PADDR_T *paddr, UINT32 *count)
 {
     PTE_T *pte2BasePtr = NULL;
     UINT32 archFlags;
     UINT32 saveCounts;
+    UINT32 index;
 
     pte2BasePtr = OsGetPte2BasePtr(pte1);
     if (pte2BasePtr == NULL) {
@@ -566,7 +711,15 @@ STATIC UINT32 OsMapL2PageContinous(PTE_T pte1, UINT32 flags, VADDR_T *vaddr, PAD
 
     /* compute the arch flags for L2 4K pages */
     archFlags = OsCvtPte2FlagsToAttrs(flags);
-    saveCounts = OsSavePte2Continuous(pte2BasePtr, OsGetPte2Index(*vaddr), *paddr | archFlags, *count);
+    index = OsGetPte2Index(*vaddr);
+    if (((*vaddr ^ *paddr) & MMU_DESCRIPTOR_L2_LARGE_MASK) != 0) {//虚实地址在64K内的偏移不同,用不上大页
+        saveCounts = OsSavePte2Continuous(pte2BasePtr, index, *paddr | archFlags, *count);
+    } else if (MMU_DESCRIPTOR_IS_L2_LARGE_SIZE_ALIGNED(*vaddr) && (*count >= MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE)) {
+        saveCounts = OsSavePte2Large(pte2BasePtr, index, OsCvtPte2SmallToLarge(*paddr | archFlags));
+    } else {//小页只写到下一个64K边界,后面的部分还有机会用大页
+        saveCounts = OsSavePte2Continuous(pte2BasePtr, index, *paddr | archFlags,
+            MIN2(*count, MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE - (index % MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE)));
+    }
     *paddr += (saveCounts << MMU_DESCRIPTOR_L2_SMALL_SHIFT);
     *vaddr += (saveCounts << MMU_DESCRIPTOR_L2_SMALL_SHIFT);
     *count -= saveCounts;
@@ -613,7 +766,10 @@ status_t LOS_ArchMmuMap(LosArchMmu *archMmu, VADDR_T vaddr, PADDR_T paddr, size_
 STATUS_T LOS_ArchMmuChangeProt(LosArchMmu *archMmu, VADDR_T vaddr, size_t count, UINT32 flags)
 {
     STATUS_T status;
+    STATUS_T ret = LOS_OK;
     PADDR_T paddr = 0;
+    VADDR_T start = vaddr;
+    UINT32 changed = 0;
 
     if ((archMmu == NULL) || (vaddr == 0) || (count == 0)) {
         VM_ERR("invalid args: archMmu %p, vaddr %p, count %d", archMmu, vaddr, count);
@@ -628,28 +784,61 @@ STATUS_T LOS_ArchMmuChangeProt(LosArchMmu *archMmu, VADDR_T vaddr, size_t count,
             continue;
         }
 
-        status = LOS_ArchMmuUnmap(archMmu, vaddr, 1);//2. 取消原有映射
-        if (status < 0) {
-            VM_ERR("invalid args:aspace %p, vaddr %p, count %d",
-                   __FUNCTION__, __LINE__, archMmu, vaddr, count);
-            return LOS_NOK;
-        }
+        (VOID)OsUnmapRange(archMmu, vaddr, 1);//2. 取消原有映射,TLB留到最后整段失效
+        changed = ((vaddr - start) >> MMU_DESCRIPTOR_L2_SMALL_SHIFT) + 1;
 
         status = LOS_ArchMmuMap(archMmu, vaddr, paddr, 1, flags);//3. 重新映射 虚实地址
         if (status < 0) {
             VM_ERR("invalid args:aspace %p, vaddr %p, count %d",
                    archMmu, vaddr, count);
-            return LOS_NOK;
+            ret = LOS_NOK;
+            break;
         }
         vaddr += MMU_DESCRIPTOR_L2_SMALL_SIZE;
     }
-    return LOS_OK;
+
+    if (changed != 0) {//改过的页一次批量失效,不再每页一次屏障
+        OsInvalidateTlbRangeNoBarrier(archMmu, start, changed);
+        OsArmInvalidateTlbBarrier();
+    }
+    return ret;
+}
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+//搬移映射时,换出页的表项原样搬到新地址,槽位的引用随表项一起转移
+STATIC VOID OsSwapPte2Move(LosArchMmu *archMmu, VADDR_T oldVaddr, VADDR_T newVaddr, UINT32 flags)
+{
+    PTE_T l1Entry = OsGetPte1(archMmu->virtTtb, oldVaddr);
+    PTE_T *oldPte2Ptr = NULL;
+    PTE_T pte2;
+
+    if (!OsIsPte1PageTable(l1Entry)) {
+        return;
+    }
+    oldPte2Ptr = OsGetPte2Ptr(OsGetPte2BasePtr(l1Entry), oldVaddr);
+    pte2 = *oldPte2Ptr;
+    if (!OsIsPte2Swap(pte2)) {
+        return;
+    }
+    OsSavePte2(oldPte2Ptr, 0);
+
+    l1Entry = OsGetPte1(archMmu->virtTtb, newVaddr);
+    if (OsIsPte1Invalid(l1Entry)) {
+        OsMapL1PTE(archMmu, &l1Entry, newVaddr, flags);
+    } else if (!OsIsPte1PageTable(l1Entry)) {
+        LOS_Panic("%s %d, unimplemented tt_entry %x\n", __FUNCTION__, __LINE__, l1Entry);
+    }
+    OsSavePte2(OsGetPte2Ptr(OsGetPte2BasePtr(l1Entry), newVaddr), pte2);
 }
+#endif
 
 STATUS_T LOS_ArchMmuMove(LosArchMmu *archMmu, VADDR_T oldVaddr, VADDR_T newVaddr, size_t count, UINT32 flags)
 {
     STATUS_T status;
+    STATUS_T ret = LOS_OK;
     PADDR_T paddr = 0;
+    VADDR_T oldStart = oldVaddr;
+    UINT32 moved = 0;
 
     if ((archMmu == NULL) || (oldVaddr == 0) || (newVaddr == 0) || (count == 0)) {
         VM_ERR("invalid args: archMmu %p, oldVaddr %p, newVddr %p, count %d",
@@ -661,28 +850,241 @@ STATUS_T LOS_ArchMmuMove(LosArchMmu *archMmu, VADDR_T oldVaddr, VADDR_T newVaddr
         count--;
         status = LOS_ArchMmuQuery(archMmu, oldVaddr, &paddr, NULL);
         if (status != LOS_OK) {
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+            OsSwapPte2Move(archMmu, oldVaddr, newVaddr, flags);
+#endif
             oldVaddr += MMU_DESCRIPTOR_L2_SMALL_SIZE;
             newVaddr += MMU_DESCRIPTOR_L2_SMALL_SIZE;
             continue;
         }
         // we need to clear the mapping here and remain the phy page.
-        status = LOS_ArchMmuUnmap(archMmu, oldVaddr, 1);
-        if (status < 0) {
-            VM_ERR("invalid args: archMmu %p, vaddr %p, count %d",
-                   archMmu, oldVaddr, count);
-            return LOS_NOK;
-        }
+        (VOID)OsUnmapRange(archMmu, oldVaddr, 1);
+        moved = ((oldVaddr - oldStart) >> MMU_DESCRIPTOR_L2_SMALL_SHIFT) + 1;
 
         status = LOS_ArchMmuMap(archMmu, newVaddr, paddr, 1, flags);
         if (status < 0) {
             VM_ERR("invalid args:archMmu %p, old_vaddr %p, new_addr %p, count %d",
                    archMmu, oldVaddr, newVaddr, count);
-            return LOS_NOK;
+            ret = LOS_NOK;
+            break;
         }
         oldVaddr += MMU_DESCRIPTOR_L2_SMALL_SIZE;
         newVaddr += MMU_DESCRIPTOR_L2_SMALL_SIZE;
     }
 
+    if (moved != 0) {//旧地址段一次批量失效
+        OsInvalidateTlbRangeNoBarrier(archMmu, oldStart, moved);
+        OsArmInvalidateTlbBarrier();
+    }
+    return ret;
+}
+
+//fork时复制一个L1 section项,可写的section两边都改为只读
+STATIC VOID OsCloneSection(LosArchMmu *srcMmu, LosArchMmu *dstMmu, PTE_T l1Entry, VADDR_T vaddr, BOOL *wp)
+{
+    UINT32 flags;
+    UINT32 index;
+    LosVmPage *page = NULL;
+    PADDR_T paddr = MMU_DESCRIPTOR_L1_SECTION_ADDR(l1Entry);
+
+    OsCvtSecAttsToFlags(l1Entry, &flags);
+    if (flags & VM_MAP_REGION_FLAG_PERM_WRITE) {
+        flags &= ~VM_MAP_REGION_FLAG_PERM_WRITE;
+        l1Entry = OsTruncPte1(paddr) | OsCvtSecFlagsToAttrs(flags) | MMU_DESCRIPTOR_L1_TYPE_SECTION;
+        OsSavePte1(OsGetPte1Ptr(srcMmu->virtTtb, vaddr), l1Entry);
+        OsArmInvalidateTlbMvaAsidNoBarrier(vaddr, srcMmu->asid);
+        *wp = TRUE;
+    }
+    OsSavePte1(OsGetPte1Ptr(dstMmu->virtTtb, vaddr), l1Entry);
+
+    for (index = 0; index < MMU_DESCRIPTOR_L2_NUMBERS_PER_L1; index++) {
+        page = LOS_VmPageGet(paddr + (index << MMU_DESCRIPTOR_L2_SMALL_SHIFT));
+        if (page != NULL) {
+            LOS_AtomicInc(&page->refCounts);
+        }
+    }
+}
+//fork时复制一个L2表中 [vaddr, vaddr + count) 的页表项,目标空间缺L2表时先分配
+STATIC STATUS_T OsCloneL2PTE(LosArchMmu *srcMmu, LosArchMmu *dstMmu, PTE_T srcPte1, VADDR_T vaddr,
+                             UINT32 count, BOOL *wp)
+{
+    UINT32 flags;
+    UINT32 index;
+    UINT32 end;
+    UINT32 pages;
+    UINT32 i;
+    PTE_T pte2;
+    PADDR_T paddr;
+    paddr_t pte2Base = 0;
+    LosVmPage *page = NULL;
+    PTE_T *srcPte2BasePtr = OsGetPte2BasePtr(srcPte1);
+    PTE_T *dstPte2BasePtr = NULL;
+    PTE_T dstPte1 = OsGetPte1(dstMmu->virtTtb, vaddr);
+    UINT32 first = MMU_DESCRIPTOR_L2_NUMBERS_PER_L1;
+    UINT32 last = 0;
+
+    if (OsIsPte1Invalid(dstPte1)) {
+        if (OsGetL2Table(dstMmu, OsGetPte1Index(vaddr), &pte2Base) != LOS_OK) {
+            return LOS_ERRNO_VM_NO_MEMORY;
+        }
+        dstPte1 = pte2Base | MMU_DESCRIPTOR_L1_TYPE_PAGE_TABLE | (srcPte1 & MMU_DESCRIPTOR_L1_PAGETABLE_NON_SECURE);
+        dstPte1 &= MMU_DESCRIPTOR_L1_SMALL_DOMAIN_MASK;
+        dstPte1 |= MMU_DESCRIPTOR_L1_SMALL_DOMAIN_CLIENT;
+        OsSavePte1(OsGetPte1Ptr(dstMmu->virtTtb, vaddr), dstPte1);
+    } else if (!OsIsPte1PageTable(dstPte1)) {
+        return LOS_ERRNO_VM_MAP_FAILED;
+    }
+    dstPte2BasePtr = OsGetPte2BasePtr(dstPte1);
+
+    DMB;
+    index = OsGetPte2Index(vaddr);
+    end = index + count;
+    while (index < end) {
+        pte2 = srcPte2BasePtr[index];
+        if (OsIsPte2Invalid(pte2)) {
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+            if (OsIsPte2Swap(pte2)) {//换出的页父子共用同一个槽位,谁先访问谁换回一份私有的
+                OsVmZramEntryDup(MMU_DESCRIPTOR_L2_SWAP_ENTRY(pte2));
+                dstPte2BasePtr[index] = pte2;
+            }
+#endif
+            index++;
+            continue;
+        } else if (OsIsPte2LargePage(pte2)) {
+            if ((index % MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE) || ((end - index) < MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE)) {
+                OsDemoteLargePage(srcPte2BasePtr, index);//大页只被复制一部分,先拆成小页
+                continue;
+            }
+            paddr = MMU_DESCRIPTOR_L2_LARGE_PAGE_ADDR(pte2);
+            pages = MMU_DESCRIPTOR_L2_NUMBERS_PER_LARGE;
+            OsCvtPte2AttsToFlags(srcPte1, OsCvtPte2LargeToSmall(pte2, 0), &flags);
+            if (flags & VM_MAP_REGION_FLAG_PERM_WRITE) {//整个大页一起改为只读,16项保持一致
+                pte2 = OsCvtPte2SmallToLarge(paddr | OsCvtPte2FlagsToAttrs(flags & ~VM_MAP_REGION_FLAG_PERM_WRITE));
+                (VOID)OsSavePte2Large(srcPte2BasePtr, index, pte2);
+                first = MIN2(first, index);
+                last = index + pages - 1;
+            }
+            (VOID)OsSavePte2Large(dstPte2BasePtr, index, pte2);
+        } else {
+            paddr = MMU_DESCRIPTOR_L2_SMALL_PAGE_ADDR(pte2);
+            pages = 1;
+            OsCvtPte2AttsToFlags(srcPte1, pte2, &flags);
+            if (flags & VM_MAP_REGION_FLAG_PERM_WRITE) {//写时拷贝,父进程的页也要改为只读
+                pte2 = paddr | OsCvtPte2FlagsToAttrs(flags & ~VM_MAP_REGION_FLAG_PERM_WRITE);
+                srcPte2BasePtr[index] = pte2;
+                first = MIN2(first, index);
+                last = index;
+            }
+            dstPte2BasePtr[index] = pte2;
+        }
+
+        for (i = 0; i < pages; i++) {
+            page = LOS_VmPageGet(paddr + (i << MMU_DESCRIPTOR_L2_SMALL_SHIFT));
+            if (page != NULL) {
+                LOS_AtomicInc(&page->refCounts);
+            }
+        }
+        index += pages;
+    }
+    DSB;
+
+    if (first <= last) {//只失效父进程中被改成只读的那一段
+        OsInvalidateTlbRangeNoBarrier(srcMmu, ROUNDDOWN(vaddr, MMU_DESCRIPTOR_L1_SMALL_SIZE) +
+                                      (first << MMU_DESCRIPTOR_L2_SMALL_SHIFT), last - first + 1);
+        *wp = TRUE;
+    }
+    return LOS_OK;
+}
+/**************************************************************************************************
+ fork专用:把 srcMmu 中 [vaddr, vaddr + count页) 的映射直接复制到 dstMmu.
+ 直接遍历L1/L2表,不再逐页 Query/Unmap/Map;可写页在父子两边都改为只读以便写时拷贝,
+ 每个被映射的物理页引用计数加1,父进程只对真正改动过的页表项做一次范围TLB失效.
+**************************************************************************************************/
+STATUS_T LOS_ArchMmuCloneRange(LosArchMmu *srcMmu, LosArchMmu *dstMmu, VADDR_T vaddr, size_t count)
+{
+    PTE_T l1Entry;
+    UINT32 chunk;
+    STATUS_T status;
+    BOOL wp = FALSE;
+
+    if ((srcMmu == NULL) || (dstMmu == NULL) || !MMU_DESCRIPTOR_IS_L2_SIZE_ALIGNED(vaddr)) {
+        return LOS_ERRNO_VM_INVALID_ARGS;
+    }
+
+    while (count > 0) {
+        chunk = MIN2((MMU_DESCRIPTOR_L1_SMALL_SIZE - (vaddr % MMU_DESCRIPTOR_L1_SMALL_SIZE)) >>
+            MMU_DESCRIPTOR_L2_SMALL_SHIFT, count);
+        l1Entry = OsGetPte1(srcMmu->virtTtb, vaddr);
+        if (OsIsPte1PageTable(l1Entry)) {
+            status = OsCloneL2PTE(srcMmu, dstMmu, l1Entry, vaddr, chunk, &wp);
+            if (status != LOS_OK) {
+                if (wp) {
+                    OsArmInvalidateTlbBarrier();
+                }
+                return status;
+            }
+        } else if (OsIsPte1Section(l1Entry)) {
+            if (chunk != MMU_DESCRIPTOR_L2_NUMBERS_PER_L1) {//只复制section的一部分,先拆成L2表再复制
+                status = OsDemoteSection(srcMmu, vaddr);
+                if (status != LOS_OK) {
+                    OsArmInvalidateTlbBarrier();
+                    return status;
+                }
+                continue;
+            }
+            OsCloneSection(srcMmu, dstMmu, l1Entry, vaddr, &wp);
+        }
+        vaddr += chunk << MMU_DESCRIPTOR_L2_SMALL_SHIFT;
+        count -= chunk;
+    }
+
+    if (wp) {
+        OsArmInvalidateTlbBarrier();
+    }
+    return LOS_OK;
+}
+
+/**************************************************************************************************
+ 换出:把 vaddr 处的4K小页映射换成记录了 entry 的无效表项并失效TLB,此后访问会缺页.
+ section和64K大页不换出.调用者持有所属空间的 regionMux,物理页由调用者处理.
+**************************************************************************************************/
+STATUS_T LOS_ArchMmuSwapOut(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 entry)
+{
+    PTE_T l1Entry = OsGetPte1(archMmu->virtTtb, vaddr);
+    PTE_T *pte2Ptr = NULL;
+
+    if ((entry == 0) || !OsIsPte1PageTable(l1Entry)) {
+        return LOS_ERRNO_VM_INVALID_ARGS;
+    }
+
+    pte2Ptr = OsGetPte2Ptr(OsGetPte2BasePtr(l1Entry), vaddr);
+    if (!OsIsPte2SmallPage(*pte2Ptr) && !OsIsPte2SmallPageXN(*pte2Ptr)) {
+        return LOS_ERRNO_VM_NOT_FOUND;
+    }
+
+    OsSavePte2(pte2Ptr, MMU_DESCRIPTOR_L2_SWAP_PTE(entry));
+    OsArmInvalidateTlbMvaAsidNoBarrier(vaddr, archMmu->asid);
+    OsArmInvalidateTlbBarrier();
+    return LOS_OK;
+}
+//查询 vaddr 是否已被换出,是则带回换出位置
+STATUS_T LOS_ArchMmuSwapEntryGet(const LosArchMmu *archMmu, VADDR_T vaddr, UINT32 *entry)
+{
+    PTE_T l1Entry = OsGetPte1(archMmu->virtTtb, vaddr);
+    PTE_T pte2;
+
+    if (!OsIsPte1PageTable(l1Entry)) {
+        return LOS_ERRNO_VM_NOT_FOUND;
+    }
+
+    pte2 = OsGetPte2(OsGetPte2BasePtr(l1Entry), vaddr);
+    if (!OsIsPte2Swap(pte2)) {
+        return LOS_ERRNO_VM_NOT_FOUND;
+    }
+
+    if (entry != NULL) {
+        *entry = MMU_DESCRIPTOR_L2_SWAP_ENTRY(pte2);
+    }
     return LOS_OK;
 }
 
@@ -721,7 +1123,8 @@ STATUS_T LOS_ArchMmuDestroy(LosArchMmu *archMmu)
         LOS_PhysPageFree(page);
     }
 
-    OsArmWriteTlbiasid(archMmu->asid);
+    OsArmInvalidateTlbAsidNoBarrier(archMmu->asid);//SMP下要广播到所有核,否则asid复用后可能命中旧表项
+    OsArmInvalidateTlbBarrier();
     OsFreeAsid(archMmu->asid);
     (VOID)LOS_MuxDestroy(&archMmu->mtx);
     return LOS_OK;
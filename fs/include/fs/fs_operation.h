@@ -115,6 +115,17 @@ extern void rename_mapping(const char *src, const char *dst);
 
 extern void dec_mapping(struct page_mapping *mapping);
 
+/****************************************************************************
+ * Name: get_file_mapping
+ *
+ * Description:
+ *   Take a reference on the current mapping of the file, so that it is not
+ *   freed when the file is closed and removed. Drop it with dec_mapping.
+ *
+ ****************************************************************************/
+
+extern struct page_mapping *get_file_mapping(struct file *filep);
+
 /**
  * @ingroup  fs
  * @brief Initializes the vfs filesystem
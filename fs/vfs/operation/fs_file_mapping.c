@@ -79,6 +79,24 @@ struct file //文件系统最重要的两个结构体之一,另一个是inode
 
 static struct file_map g_file_mapping = {0};//用于挂载所有文件的file_map
 
+/* file_map is hashed by full path, an open only compares the paths in one bucket */
+#define FILE_MAP_HASH_BITS  7
+#define FILE_MAP_HASH_SIZE  (1 << FILE_MAP_HASH_BITS)
+static LOS_DL_LIST g_file_mapping_hash[FILE_MAP_HASH_SIZE];//file_map.head 挂在对应的桶上,由 g_file_mapping.lock 保护
+
+//FNV-1a 字符串哈希,找到路径所在的桶
+static LOS_DL_LIST *file_map_bucket(const char *fullpath)
+{
+    unsigned int hash = 2166136261U; /* FNV-1a offset basis */
+
+    while (*fullpath != '\0') {
+        hash ^= (unsigned char)*fullpath++;
+        hash *= 16777619U; /* FNV-1a prime */
+    }
+
+    return &g_file_mapping_hash[hash & (FILE_MAP_HASH_SIZE - 1)];
+}
+
 /**************************************************************************************************
  初始化文件映射模块，
  file_map: 每个需映射到内存的文件必须创建一个 file_map，都挂到全局g_file_mapping链表上
@@ -88,8 +106,12 @@ static struct file_map g_file_mapping = {0};//用于挂载所有文件的file_ma
 uint init_file_mapping()
 {
     uint ret;
+    int i;
 
     LOS_ListInit(&g_file_mapping.head);//初始化全局文件映射节点，所有文件的映射都将g_file_mapping.head挂在链表上
+    for (i = 0; i < FILE_MAP_HASH_SIZE; i++) {
+        LOS_ListInit(&g_file_mapping_hash[i]);
+    }
 
     ret = LOS_MuxInit(&g_file_mapping.lock, NULL);//初始化文件映射互斥锁
     if (ret != LOS_OK) {
@@ -103,7 +125,7 @@ static struct page_mapping *find_mapping_nolock(const char *fullpath)
 {
     struct file_map *fmap = NULL;
 
-    LOS_DL_LIST_FOR_EACH_ENTRY(fmap, &g_file_mapping.head, struct file_map, head) {//遍历文件映射链表
+    LOS_DL_LIST_FOR_EACH_ENTRY(fmap, file_map_bucket(fullpath), struct file_map, head) {//只比较同一个桶里的路径
         if (!strcmp(fmap->owner, fullpath)) {//用整个文件路径来标识文件的唯一性
             return &fmap->mapping;
         }
@@ -129,6 +151,8 @@ void add_mapping(struct file *filep, const char *fullpath)
         return;
     }
 
+    OsFileReadaheadReset(filep);//新的打开者从默认预读状态开始
+
     (VOID)LOS_MuxLock(&g_file_mapping.lock, LOS_WAIT_FOREVER);//操作临界区，先拿锁
 
     path_len = strlen(fullpath) + 1;
@@ -175,7 +199,18 @@ void add_mapping(struct file *filep, const char *fullpath)
         PRINT_ERR("%s %d, Create mutex for mapping.mux_lock failed, status: %d\n", __FUNCTION__, __LINE__, retval);
     }
     (VOID)LOS_MuxLock(&g_file_mapping.lock, LOS_WAIT_FOREVER);//拿锁操作g_file_mapping
-    LOS_ListTailInsert(&g_file_mapping.head, &fmap->head);//将文件映射结点挂入全局链表
+    mapping = find_mapping_nolock(fullpath);//释放锁期间别人可能已为同一文件建好了映射,共用它,否则同一文件会有两份缓存
+    if (mapping) {
+        LOS_AtomicInc(&mapping->ref);
+        filep->f_mapping = mapping;
+        mapping->host = filep;
+        (VOID)LOS_MuxUnlock(&g_file_mapping.lock);
+        (VOID)LOS_MuxDestroy(&fmap->mapping.mux_lock);
+        LOS_MemFree(m_aucSysMem0, fmap->owner);
+        LOS_MemFree(m_aucSysMem0, fmap);
+        return;
+    }
+    LOS_ListTailInsert(file_map_bucket(fullpath), &fmap->head);//将文件映射结点挂入路径所在的桶
     (VOID)LOS_MuxUnlock(&g_file_mapping.lock);//释放锁
 
     filep->f_mapping = &fmap->mapping;//<file,file_map>之间互绑
@@ -203,16 +238,44 @@ struct page_mapping *find_mapping(const char *fullpath)
 
     return mapping;
 }
-//引用递减，删除或关闭文件时 由 files_close_internal调用
+//释放已被删除且不再有引用的文件映射,调用者持有 g_file_mapping.lock
+static void release_mapping_nolock(struct page_mapping *mapping)
+{
+    struct file_map *fmap = LOS_DL_LIST_ENTRY(mapping, struct file_map, mapping);
+
+    OsFileCacheRemove(mapping);//删除后钉住期间又读进来的页
+    (VOID)LOS_MuxDestroy(&mapping->mux_lock);
+    LOS_MemFree(m_aucSysMem0, fmap->owner);
+    LOS_MemFree(m_aucSysMem0, fmap);
+}
+//钉住文件当前的映射,锁外预读期间不会被删除释放,用 dec_mapping 放开
+struct page_mapping *get_file_mapping(struct file *filep)
+{
+    struct page_mapping *mapping = NULL;
+
+    (VOID)LOS_MuxLock(&g_file_mapping.lock, LOS_WAIT_FOREVER);
+    mapping = filep->f_mapping;//和 remove_mapping_nolock 清除 f_mapping 互斥
+    if (mapping != NULL) {
+        LOS_AtomicInc(&mapping->ref);
+    }
+    (VOID)LOS_MuxUnlock(&g_file_mapping.lock);
+
+    return mapping;
+}
+//引用递减，删除或关闭文件时 由 files_close_internal调用;已删除的映射在最后一个引用放开时释放
 void dec_mapping(struct page_mapping *mapping)
 {
+    struct file_map *fmap = NULL;
+
     if (mapping == NULL) {
         return;
     }
 
     (VOID)LOS_MuxLock(&g_file_mapping.lock, LOS_WAIT_FOREVER);
-    if (LOS_AtomicRead(&mapping->ref) > 0) {
-        LOS_AtomicDec(&mapping->ref);//ref 递减
+    fmap = LOS_DL_LIST_ENTRY(mapping, struct file_map, mapping);
+    if ((LOS_AtomicRead(&mapping->ref) > 0) && (LOS_AtomicDecRet(&mapping->ref) == 0) &&//ref 递减
+        LOS_ListEmpty(&fmap->head)) {//已从桶中摘下,说明文件已被删除
+        release_mapping_nolock(mapping);
     }
     (VOID)LOS_MuxUnlock(&g_file_mapping.lock);
 }
@@ -239,6 +302,7 @@ void clear_file_mapping_nolock(const struct page_mapping *mapping)
 int remove_mapping_nolock(const char *fullpath, const struct file *ex_filp)
 {
     int fd;
+    INT32 opened = 0;
     struct file *filp = NULL;
     struct file_map *fmap = NULL;
     struct page_mapping *mapping = NULL;
@@ -283,13 +347,24 @@ int remove_mapping_nolock(const char *fullpath, const struct file *ex_filp)
         goto out;
     }
 
-    (VOID)LOS_MuxDestroy(&mapping->mux_lock);
-    clear_file_mapping_nolock(mapping);//清除进程对page_mapping的映射
-    OsFileCacheRemove(mapping);//从页高速缓存中删除文件页
     fmap = LOS_DL_LIST_ENTRY(mapping,
     struct file_map, mapping);//通过page_mapping找到fmap
-    LOS_ListDelete(&fmap->head);//从g_file_mapping链表上摘掉自己
-    LOS_MemFree(m_aucSysMem0, fmap);
+    LOS_ListDelInit(&fmap->head);//立刻从g_file_mapping链表上摘掉自己,同一路径新建的文件不会再找到它
+
+    for (fd = 3; fd < CONFIG_NFILE_DESCRIPTORS; fd++) {//被清掉映射的打开文件关闭时不会再 dec_mapping,它们的引用在这里放掉
+        if (tg_filelist.fl_files[fd].f_mapping == mapping) {
+            opened++;
+        }
+    }
+    clear_file_mapping_nolock(mapping);//清除进程对page_mapping的映射
+    OsFileCacheRemove(mapping);//从页高速缓存中删除文件页
+    mapping->host = NULL;//表项以后可能被别的文件重用,不能再经由它回写
+
+    /* pinned by a readahead or writeback outside the lock: the last dec_mapping frees it */
+    if (LOS_AtomicSub(&mapping->ref, opened) <= 0) {
+        LOS_AtomicSet(&mapping->ref, 0);
+        release_mapping_nolock(mapping);
+    }
 
 out:
     (VOID)LOS_MuxUnlock(&g_file_mapping.lock);
@@ -360,6 +435,8 @@ void rename_mapping(const char *src_path, const char *dst_path)
 
     (VOID)LOS_MemFree(m_aucSysMem0, fmap->owner);
     fmap->owner = tmp;
+    LOS_ListDelete(&fmap->head);//路径变了,换到新路径所在的桶
+    LOS_ListTailInsert(file_map_bucket(dst_path), &fmap->head);
 
 out:
     (VOID)LOS_MuxUnlock(&g_file_mapping.lock);
@@ -382,6 +382,8 @@ LITE_OS_SEC_TEXT VOID OsProcessResourcesToFree(LosProcessCB *processCB)
     OsSwtmrRecycle(processCB->processID);//软件定时器回收
     processCB->timerID = (timer_t)(UINTPTR)MAX_INVALID_TIMER_VID;
 
+    OsVforkDone(processCB);//vfork子进程退出,放父进程继续运行
+
 #ifdef LOSCFG_SECURITY_VID
     if (processCB->timerIdMap.bitMap != NULL) {
         VidMapDestroy(processCB);
@@ -584,7 +586,7 @@ LITE_OS_SEC_TEXT VOID OsProcessCBRecyleToFree(VOID)
         SCHEDULER_LOCK(intSave);
         processCB->processStatus &= ~OS_PROCESS_FLAG_EXIT;//给进程撕掉退出标签,(可能进程并没有这个标签)
         if (OsProcessIsUserMode(processCB)) {//进程是否是用户态进程
-            space = processCB->vmSpace;//只有用户态的进程才需要释放虚拟内存空间
+            space = processCB->vmSpace;//只有用户态的进程才需要释放虚拟内存空间,与其他进程共用时只放下引用
         }
         processCB->vmSpace = NULL;
         /* OS_PROCESS_FLAG_GROUP_LEADER: The lead process group cannot be recycled without destroying the PCB.
@@ -600,7 +602,7 @@ LITE_OS_SEC_TEXT VOID OsProcessCBRecyleToFree(VOID)
         }
         SCHEDULER_UNLOCK(intSave);
 
-        (VOID)LOS_VmSpaceFree(space);//释放用户态进程的虚拟内存空间,因为内核只有一个虚拟空间,因此不需要释放虚拟空间.
+        (VOID)OsVmSpacePut(space);//释放用户态进程的虚拟内存空间,因为内核只有一个虚拟空间,因此不需要释放虚拟空间.
 
         SCHEDULER_LOCK(intSave);
     }
@@ -707,6 +709,7 @@ STATIC UINT32 OsInitPCB(LosProcessCB *processCB, UINT32 mode, UINT16 priority, U
     processCB->policy = policy;							//调度算法 LOS_SCHED_RR
     processCB->umask = OS_PROCESS_DEFAULT_UMASK;		//掩码
     processCB->timerID = (timer_t)(UINTPTR)MAX_INVALID_TIMER_VID;
+    processCB->vforkSemID = OS_INVALID_VALUE;			//未借用父进程空间
 
     LOS_ListInit(&processCB->threadSiblingList);//初始化孩子任务/线程链表，上面挂的都是由此fork的孩子线程 见于 OsTaskCBInit LOS_ListTailInsert(&(processCB->threadSiblingList), &(taskCB->threadList));
     LOS_ListInit(&processCB->childrenList);		//初始化孩子进程链表，上面挂的都是由此fork的孩子进程 见于 OsCopyParent LOS_ListTailInsert(&parentProcessCB->childrenList, &childProcessCB->siblingList);
@@ -729,7 +732,7 @@ STATIC UINT32 OsInitPCB(LosProcessCB *processCB, UINT32 mode, UINT16 priority, U
             (VOID)LOS_MemFree(m_aucSysMem0, space);
             return LOS_ENOMEM;
         }
-        (VOID)memset_s(ttb, PAGE_SIZE, 0, PAGE_SIZE);//内存清0
+        OsPhysPageZero(ttb);//内存清0
         retVal = OsUserVmSpaceInit(space, ttb);//初始化虚拟空间和进程mmu
         vmPage = OsVmVaddrToPage(ttb);//通过虚拟地址拿到page
         if ((retVal == FALSE) || (vmPage == NULL)) {//异常处理
@@ -1540,7 +1543,7 @@ LITE_OS_SEC_TEXT UINT32 OsExecRecycleAndInit(LosProcessCB *processCB, const CHAR
     processCB->processStatus &= ~OS_PROCESS_FLAG_EXIT;	//去掉进程退出标签
     processCB->processStatus |= OS_PROCESS_FLAG_ALREADY_EXEC;//加上进程运行 elf标签
 
-    LOS_VmSpaceFree(oldSpace);//ELF已经接管了进程,进程的原有虚拟空间要被释放掉
+    (VOID)OsVmSpacePut(oldSpace);//ELF已经接管了进程,进程的原有虚拟空间要被释放掉,与其他进程共用时只放下引用
     return LOS_OK;
 }
 //进程层面的开始执行, entry为入口函数 ,其中 创建好task,task上下文 等待调度真正执行, sp:栈指针 mapBase:栈底 mapSize:栈大小
@@ -1782,16 +1785,30 @@ STATIC UINT32 OsCopyMM(UINT32 flags, LosProcessCB *childProcessCB, LosProcessCB
 {
     status_t status;
     UINT32 intSave;
+    LosVmSpace *space = NULL;
+    LosTaskCB *childTaskCB = NULL;
 
     if (!OsProcessIsUserMode(childProcessCB)) {//不是用户模式，直接返回，什么意思？内核虚拟空间只有一个，无需COPY ！！！
         return LOS_OK;
     }
 
-    if (flags & CLONE_VM) {//贴有虚拟内存的标签
+    /* CLONE_VM: the child runs in the parent's space and holds a reference on it, so the space
+     * outlives whichever of the two exits first. neither the page tables nor the regions are copied.
+     * CLONE_VFORK additionally holds the parent on vforkSemID until the child execs or exits.
+     */
+    if (flags & CLONE_VM) {
+        if ((flags & CLONE_VFORK) && (LOS_BinarySemCreate(0, &childProcessCB->vforkSemID) != LOS_OK)) {
+            return LOS_ENOMEM;
+        }
+        OsVmSpaceGet(runProcessCB->vmSpace);
         SCHEDULER_LOCK(intSave);
-        childProcessCB->vmSpace->archMmu.virtTtb = runProcessCB->vmSpace->archMmu.virtTtb;//TTB虚拟地址基地址,即L1表存放位置,virtTtb是个指针,进程的虚拟空间是指定的范围的
-        childProcessCB->vmSpace->archMmu.physTtb = runProcessCB->vmSpace->archMmu.physTtb;//TTB物理地址基地址,physTtb是个值,取决于运行时映射到物理内存的具体哪个位置.
+        space = childProcessCB->vmSpace;//OsInitPCB 分配的空壳空间,用不上了
+        childProcessCB->vmSpace = runProcessCB->vmSpace;
+        childTaskCB = OS_TCB_FROM_TID(childProcessCB->threadGroupID);
+        childTaskCB->userMapBase = 0;//用户栈属于父进程,子进程退出时不能解除映射
+        childTaskCB->userMapSize = 0;
         SCHEDULER_UNLOCK(intSave);
+        (VOID)LOS_VmSpaceFree(space);
         return LOS_OK;
     }
 
@@ -1896,9 +1913,43 @@ STATIC INT32 OsCopyProcessResources(UINT32 flags, LosProcessCB *child, LosProces
     return LOS_OK;
 }
 
+/* The vfork parent waits for the child to exec or exit. The pend is sliced so that a SIGKILL or the
+ * exit of its own process lets the parent go, a child that never execs can not wedge it.
+ * The semaphore is deleted by the parent only: when it gives up, it takes vforkSemID back from the
+ * child under the scheduler lock, the same swap OsVforkDone does, so the child never posts a deleted
+ * (and maybe reused) semaphore. If the child won the swap its post is on the way, wait for it.
+ */
+STATIC VOID OsVforkWait(LosProcessCB *run, LosProcessCB *child, UINT32 semID)
+{
+    UINT32 intSave;
+    BOOL posted = FALSE;
+    LosTaskCB *runTask = OsCurrTaskGet();
+
+    while (!posted) {
+        posted = (LOS_SemPend(semID, OS_VFORK_WAIT_TICKS) != LOS_ERRNO_SEM_TIMEOUT);
+        if ((run->processStatus & OS_PROCESS_FLAG_EXIT) || OsSigIsMember(&run->sigShare, SIGKILL) ||
+            OsSigIsMember(&runTask->sig.sigFlag, SIGKILL)) {
+            break;
+        }
+    }
+
+    if (!posted) {
+        SCHEDULER_LOCK(intSave);
+        posted = (child->vforkSemID != semID);//子进程已取走,post 马上就到
+        if (!posted) {
+            child->vforkSemID = OS_INVALID_VALUE;
+        }
+        SCHEDULER_UNLOCK(intSave);
+        if (posted) {
+            (VOID)LOS_SemPend(semID, LOS_WAIT_FOREVER);
+        }
+    }
+    (VOID)LOS_SemDelete(semID);
+}
+
 STATIC INT32 OsCopyProcess(UINT32 flags, const CHAR *name, UINTPTR sp, UINT32 size)
 {
-    UINT32 intSave, ret, processID;
+    UINT32 intSave, ret, processID, semID;
     LosProcessCB *run = OsCurrProcessGet();//获取当前进程
 
     LosProcessCB *child = OsGetFreePCB();//从进程池中申请一个进程控制块，鸿蒙进程池默认64
@@ -1917,6 +1968,7 @@ STATIC INT32 OsCopyProcess(UINT32 flags, const CHAR *name, UINTPTR sp, UINT32 si
         goto ERROR_TASK;
     }
 
+    semID = child->vforkSemID;//子进程一旦被调度就可能退出,先取出来
     ret = OsChildSetProcessGroupAndSched(child, run);//设置进程组和加入进程调度就绪队列
     if (ret != LOS_OK) {
         goto ERROR_TASK;
@@ -1927,16 +1979,43 @@ STATIC INT32 OsCopyProcess(UINT32 flags, const CHAR *name, UINTPTR sp, UINT32 si
         LOS_Schedule();// 申请调度
     }
 
+    if (semID != OS_INVALID_VALUE) {//vfork: 等子进程 exec 或退出后归还虚拟空间
+        OsVforkWait(run, child, semID);
+    }
+
     return processID;
 
 ERROR_TASK:
     SCHEDULER_LOCK(intSave);
     (VOID)OsTaskDeleteUnsafe(OS_TCB_FROM_TID(child->threadGroupID), OS_PRO_EXIT_OK, intSave);
 ERROR_INIT:
+    semID = child->vforkSemID;
     OsDeInitPCB(child);
+    if (semID != OS_INVALID_VALUE) {
+        (VOID)LOS_SemDelete(semID);
+    }
     return -ret;
 }
 
+/* The vfork child lets its parent run again, called on exec and exit. The space itself is
+ * dropped through OsVmSpacePut like any other, the child holds its own reference.
+ */
+LITE_OS_SEC_TEXT VOID OsVforkDone(LosProcessCB *processCB)
+{
+    UINT32 intSave;
+    UINT32 semID;
+
+    SCHEDULER_LOCK(intSave);
+    semID = processCB->vforkSemID;
+    processCB->vforkSemID = OS_INVALID_VALUE;
+    SCHEDULER_UNLOCK(intSave);
+    if (semID == OS_INVALID_VALUE) {
+        return;
+    }
+
+    (VOID)LOS_SemPost(semID);//唤醒阻塞在 OsCopyProcess 中的父进程,父进程放弃等待前会先收回 vforkSemID,信号量此时一定还在
+}
+
 LITE_OS_SEC_TEXT INT32 OsClone(UINT32 flags, UINTPTR sp, UINT32 size)
 {
     UINT32 cloneFlag = CLONE_PARENT | CLONE_THREAD | CLONE_VFORK | CLONE_VM;
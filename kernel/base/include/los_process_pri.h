@@ -112,6 +112,7 @@ typedef struct ProcessCB {
     ProcIpcInfo         ipcInfo;       /**< memory pool for lite ipc */ //用于进程间通讯的虚拟设备文件系统,设备装载点为 /dev/lite_ipc
 #endif
     LosVmSpace          *vmSpace;       /**< VMM space for processes */ //虚拟空间,描述进程虚拟内存的数据结构，linux称为内存描述符
+    UINT32              vforkSemID;    /**< Parent pends on it while the vfork child borrows its vmSpace */ //vfork子进程借用父进程空间期间,父进程阻塞于此
 #ifdef LOSCFG_FS_VFS
     struct files_struct *files;        /**< Files held by the process */ //进程所持有的所有文件，注者称之为进程的文件管理器
 #endif	//每个进程都有属于自己的文件管理器,记录对文件的操作. 注意:一个文件可以被多个进程操作
@@ -463,6 +464,12 @@ STATIC INLINE User *OsCurrUserGet(VOID)//获取当前进程的所属用户
 #define OS_PROCESS_INFO_ALL 1
 #define OS_PROCESS_DEFAULT_UMASK 0022
 
+/**
+ * @ingroup los_process
+ * Ticks a vfork parent pends before it checks whether it was killed.
+ */
+#define OS_VFORK_WAIT_TICKS (LOSCFG_BASE_CORE_TICK_PER_SECOND / 10)
+
 extern UINTPTR __user_init_entry;	// 第一个用户态进程入口地址 查看 LITE_USER_SEC_ENTRY
 extern UINTPTR __user_init_bss;		// 查看 LITE_USER_SEC_BSS
 extern UINTPTR __user_init_end;		//
@@ -475,6 +482,7 @@ extern UINT32 OsUserInitProcess(VOID);
 extern VOID OsTaskSchedQueueDequeue(LosTaskCB *taskCB, UINT16 status);
 extern VOID OsTaskSchedQueueEnqueue(LosTaskCB *taskCB, UINT16 status);
 extern INT32 OsClone(UINT32 flags, UINTPTR sp, UINT32 size);
+extern VOID OsVforkDone(LosProcessCB *processCB);
 extern VOID OsWaitSignalToWakeProcess(LosProcessCB *processCB);
 extern UINT32 OsExecRecycleAndInit(LosProcessCB *processCB, const CHAR *name,
                                    LosVmSpace *oldAspace, UINTPTR oldFiles);
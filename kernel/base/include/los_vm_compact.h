@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @defgroup los_vm_compact vm physical memory compaction
+ * @ingroup kernel
+ */
+
+#ifndef __LOS_VM_COMPACT_H__
+#define __LOS_VM_COMPACT_H__
+
+#include "los_typedef.h"
+#include "los_vm_phys.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+/**************************************************************************************************
+ 物理内存整理:连续分配失败而空闲页总数其实够用时,挑一个对齐的块,把块里的页缓存页和进程私有匿名页
+ 搬到块外的新页上,改好所有映射,块就整个空出来了.碎片指数(0~1000)区分两种失败:
+ 接近0是空闲页本身不够,该回收而不是整理;越接近1000越是碎片造成的,整理才有用.
+**************************************************************************************************/
+#define VM_FRAG_INDEX_MAX           1000
+#define VM_FRAG_INDEX_SUITABLE      (-1000) /* a free block of the requested order exists */
+#define VM_COMPACT_FRAG_THRESHOLD   500     /* at or below it the failure is lack of memory */
+#define VM_COMPACT_BLOCKS_MAX       4       /* candidate blocks emptied per compaction */
+#define VM_COMPACT_DEFER_SHIFT_MAX  6       /* failed compactions skip up to 64 later attempts */
+
+INT32 OsVmPhysFragIndex(LosVmPhysSeg *seg, UINT32 order);
+BOOL OsVmPhysCompact(UINT32 order);
+VOID OsVmCompactDump(const LosVmPhysSeg *seg);
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#endif /* __LOS_VM_COMPACT_H__ */
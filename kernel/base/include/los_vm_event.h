@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @defgroup los_vm_event vm event counters
+ * @ingroup kernel
+ */
+
+#ifndef __LOS_VM_EVENT_H__
+#define __LOS_VM_EVENT_H__
+
+#include "los_typedef.h"
+#include "los_hwi.h"
+#include "los_hw_cpu.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+/**************************************************************************************************
+ 内存事件计数:每个CPU一份,只在本核上关中断累加,不用锁也不会在核间来回抢缓存行,可以一直开着.
+ 读的时候把各核的数加起来,是个近似的快照.顺序是用户态可见的接口,只能在末尾追加.
+**************************************************************************************************/
+enum VmEventItem {
+    VM_EVENT_FAULT_READ = 0,    /* OsDoReadFault */
+    VM_EVENT_FAULT_COW,         /* OsDoCowFault */
+    VM_EVENT_FAULT_SHARED,      /* OsDoSharedFault */
+    VM_EVENT_CACHE_HIT,         /* page cache lookups of read() and file faults */
+    VM_EVENT_CACHE_MISS,
+    VM_EVENT_RECLAIM_SCAN,      /* file pages examined by reclaim */
+    VM_EVENT_RECLAIM_STEAL,     /* file pages reclaimed */
+    VM_EVENT_PAGE_ALLOC,        /* pages taken from the buddy allocator */
+    VM_EVENT_PAGE_FREE,         /* pages given back to the buddy allocator */
+    VM_EVENT_NR_ITEMS
+};
+
+/* 用户态取快照的系统调用号,固定在 LiteOS 自定义调用区间,不随 libc 增加自定义调用而变 */
+#define __NR_vm_events_get      600
+
+#define VM_EVENT_CPU_ALIGN      64  /* keep each cpu on its own cache line */
+
+typedef struct {
+    UINT32 events[VM_EVENT_NR_ITEMS];
+} LOSBLD_ATTRIB_ALIGN(VM_EVENT_CPU_ALIGN) LosVmEventCpu;
+
+extern LosVmEventCpu g_vmEvents[LOSCFG_KERNEL_CORE_NUM];
+
+STATIC INLINE VOID OsVmEventAdd(enum VmEventItem item, UINT32 count)
+{
+    UINT32 intSave = LOS_IntLock();//关中断后不会被打断,也不会被调度到别的核
+
+    g_vmEvents[ArchCurrCpuid()].events[item] += count;
+    LOS_IntRestore(intSave);
+}
+
+STATIC INLINE VOID OsVmEventInc(enum VmEventItem item)
+{
+    OsVmEventAdd(item, 1);
+}
+
+VOID OsVmEventSnapshot(UINT32 *events, UINT32 count);
+VOID OsVmEventDump(VOID);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#endif /* __LOS_VM_EVENT_H__ */
@@ -39,6 +39,7 @@
 
 #include "los_typedef.h"
 #include "los_exc.h"
+#include "los_vm_map.h"
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -57,6 +58,7 @@ typedef struct {
 #define     VM_MAP_PF_FLAG_NOT_PRESENT      (1U << 3)
 //缺页中断处理函数
 STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame);
+STATUS_T OsVmPopulate(LosVmSpace *space, VADDR_T vaddr, size_t size);
 #ifdef __cplusplus
 #if __cplusplus
 }
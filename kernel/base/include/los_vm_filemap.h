@@ -87,7 +87,7 @@ struct file_map { //为在内核层面文件在内存的身份证,每个需映
 //文件页结构体
 typedef struct FilePage {
     LOS_DL_LIST             node;		//节点,节点挂到page_mapping.page_list上,链表以 pgoff 从小到大方式排序.
-    LOS_DL_LIST             lru;		//lru节点, 结合 LosVmPhysSeg: LOS_DL_LIST lruList[VM_NR_LRU_LISTS] 理解
+    LOS_DL_LIST             lru;		//lru节点, 挂在 LosVmPhysSeg: genList[VM_LRU_GEN(genSeq)] 上
     LOS_DL_LIST             i_mmap;     /* list of mappings */ //链表记录文件页被哪些进程映射 MapInfo.node挂上来
     UINT32                  n_maps;       /* num of mapping */ //记录被进程映射的次数
     struct VmPhysSeg        *physSeg;      /* physical memory that file page belongs to */ //物理段:物理页框 = 1:N
@@ -97,6 +97,8 @@ typedef struct FilePage {
     UINT32                  flags;		//标签
     UINT16                  dirtyOff;	//脏页的页内偏移地址
     UINT16                  dirtyEnd;	//脏页的结束位置
+    UINT32                  dirtyTick;  //由干净变脏时的tick,回写任务据此判断脏页是否过期
+    UINT32                  genSeq;     //所在LRU代的序号,结合 LosVmPhysSeg: genList[VM_LRU_GEN(genSeq)] 理解
 } LosFilePage;
 //虚拟地址和文件页的映射信息
 typedef struct MapInfo {//在一个进程使用文件页之前,需要提前做好文件页在此内存空间的映射关系,如此通过虚拟内存就可以对文件页读写操作.
@@ -105,6 +107,11 @@ typedef struct MapInfo {//在一个进程使用文件页之前,需要提前做
     LosFilePage             *page;	//文件页中只记录物理地址,是不会变的.但它是需要被多个进程访问,和映射的.
     LosArchMmu              *archMmu;//mmu完成vaddr和page->vmPage->physAddr物理地址的映射
 } LosMapInfo;
+//锁外预读时钉住的文件,见 OsFileMappingPin
+typedef struct FilePin {
+    struct page_mapping     *mapping;   //钉住的映射,为 NULL 时没有可读的
+    struct file             file;       //持 regionMux 时保存的文件快照,锁外读设备只用它
+} LosFilePin;
 //Flags由 bitmap 管理
 enum OsPageFlags {
     FILE_PAGE_FREE,			//空闲页	
@@ -114,12 +121,34 @@ enum OsPageFlags {
     FILE_PAGE_LRU,			//LRU置换页
     FILE_PAGE_ACTIVE,		//活动页
     FILE_PAGE_SHARED,		//共享页
+    FILE_PAGE_MERGED,		//相同页合并后留下的只读页
 };
 
 #define PGOFF_MAX                       2000
 #define MAX_SHRINK_PAGECACHE_TRY        2
 #define VM_FILEMAP_MAX_SCAN             (SYS_MEM_SIZE_DEFAULT >> PAGE_SHIFT)
 #define VM_FILEMAP_MIN_SCAN             32
+#define VM_FILEMAP_SCAN_RATIO           4   /* pages examined per page asked to reclaim */
+
+/* readahead window grows 16KB -> 512KB while the access stays sequential */
+#define VM_FILEMAP_RA_MIN_PAGES         4
+#define VM_FILEMAP_RA_MAX_PAGES         128
+#define VM_FILEMAP_RA_CHUNK_PAGES       16  /* pages per device read */
+
+/* background writeback, ratios are percent of all physical pages */
+#define VM_WRITEBACK_INTERVAL_MS        1000    /* period of the writeback task */
+#define VM_WRITEBACK_EXPIRE_MS          5000    /* dirty pages older than this are written back */
+#define VM_WRITEBACK_BG_RATIO           10      /* above this the task writes regardless of age */
+#define VM_WRITEBACK_DIRTY_RATIO        20      /* above this writers are throttled */
+#define VM_WRITEBACK_BATCH_PAGES        256     /* pages collected per pass */
+#define VM_WRITEBACK_THROTTLE_MS        100     /* longest a writer is held back */
+#define VM_WRITEBACK_EVENT_WAKE         0x01
+
+enum OsReadaheadMode {
+    FILE_RA_NORMAL,         //自适应,检测到顺序访问才预读
+    FILE_RA_SEQUENTIAL,     //顺序访问,直接使用最大窗口
+    FILE_RA_RANDOM,         //随机访问,关闭预读
+};
 //给页面贴上被锁的标签
 STATIC INLINE VOID OsSetPageLocked(LosVmPage *page)
 {
@@ -200,6 +229,16 @@ STATIC INLINE BOOL OsIsPageMapped(LosFilePage *page)
 {
     return (page->n_maps != 0);//由映射的次数来判断
 }
+//记下映射文件页的线性区标签,mlock 的锁定标签一直保留到页不再被任何进程映射
+STATIC INLINE VOID OsFilePageFlagsSet(LosFilePage *page, UINT32 regionFlags)
+{
+    page->flags = regionFlags | (page->flags & VM_MAP_REGION_FLAG_LOCKED);
+}
+//文件页是否被 mlock 锁定,锁定的页不参与回收
+STATIC INLINE BOOL OsIsPageMlocked(LosFilePage *page)
+{
+    return OsIsPageMapped(page) && (page->flags & VM_MAP_REGION_FLAG_LOCKED);
+}
 
 /* The follow three functions is used to SHM module */
 STATIC INLINE VOID OsSetPageShared(LosVmPage *page)//给页面贴上共享页标签
@@ -216,6 +255,21 @@ STATIC INLINE BOOL OsIsPageShared(LosVmPage *page)
 {
     return BIT_GET(page->flags, FILE_PAGE_SHARED);
 }
+//相同页合并留下的页,写时必须拷贝,不能恢复可写
+STATIC INLINE VOID OsSetPageMerged(LosVmPage *page)
+{
+    LOS_BitmapSet(&page->flags, FILE_PAGE_MERGED);
+}
+
+STATIC INLINE VOID OsCleanPageMerged(LosVmPage *page)
+{
+    LOS_BitmapClr(&page->flags, FILE_PAGE_MERGED);
+}
+
+STATIC INLINE BOOL OsIsPageMerged(LosVmPage *page)
+{
+    return BIT_GET(page->flags, FILE_PAGE_MERGED);
+}
 
 INT32 OsVfsFileMmap(struct file *filep, LosVmMapRegion *region);
 LosFilePage *OsPageCacheAlloc(struct page_mapping *mapping, VM_OFFSET_T pgoff);
@@ -227,7 +281,7 @@ VOID OsFileCacheFlush(struct page_mapping *mapping);
 VOID OsFileCacheRemove(struct page_mapping *mapping);
 VOID OsUnmapPageLocked(LosFilePage *page, LosMapInfo *info);
 VOID OsUnmapAllLocked(LosFilePage *page);
-VOID OsLruCacheAdd(LosFilePage *fpage, enum OsLruList lruType);
+VOID OsLruCacheAdd(LosFilePage *fpage);
 VOID OsLruCacheDel(LosFilePage *fpage);
 LosFilePage *OsDumpDirtyPage(LosFilePage *oldPage);
 VOID OsDoFlushDirtyPage(LosFilePage *fpage);
@@ -237,6 +291,18 @@ VOID OsPageRefDecNoLock(LosFilePage *page);
 VOID OsPageRefIncLocked(LosFilePage *page);
 int OsTryShrinkMemory(size_t nPage);
 VOID OsMarkPageDirty(LosFilePage *fpage, LosVmMapRegion *region, int off, int len);
+VOID OsFileReadaheadInit(LosFileReadahead *ra, UINT32 mode);
+VOID OsFileReadaheadModeSet(struct file *filp, UINT32 mode);
+VOID OsFileReadaheadReset(struct file *filp);
+VOID OsPageCacheReadahead(struct file *filp, VM_OFFSET_T start, UINT32 nPages);
+VOID OsFileMappingPin(struct file *filp, LosFilePin *pin);
+VOID OsPageCacheReadaheadPinned(LosFilePin *pin, VM_OFFSET_T start, UINT32 nPages);
+UINT32 OsFileFaultReadaheadWindow(LosVmMapRegion *region, VM_OFFSET_T pgoff, VM_OFFSET_T *start);
+VOID OsFilePagesUnlock(LosVmMapRegion *region);
+VOID OsWritebackDirtyInc(VOID);
+VOID OsWritebackDirtyDec(VOID);
+VOID OsWritebackThrottle(VOID);
+UINT32 OsWritebackTaskInit(VOID);
 
 typedef struct ProcessCB LosProcessCB;
 VOID OsVmmFileRegionFree(struct file *filep, LosProcessCB *processCB);
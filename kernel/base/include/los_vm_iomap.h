@@ -34,6 +34,8 @@
 
 #include "los_typedef.h"
 #include "los_vm_zone.h"
+#include "los_list.h"
+#include "los_spinlock.h"
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -49,10 +51,35 @@ enum DmaMemType {
 #define IS_PERIPH_ADDR(addr)    ((addr >= PERIPH_PMM_BASE) && (addr <= PERIPH_PMM_BASE + PERIPH_PMM_SIZE))
 #define IS_MEMORY_ADDR(addr)    ((addr >= DDR_MEM_ADDR) && (addr <= DDR_MEM_ADDR + DDR_MEM_SIZE))
 
+#define DMA_POOL_MIN_ALIGN      64  /* cache line, chunks never share a line with their neighbours */
+#define DMA_POOL_BLOCK_PAGES    4   /* contiguous pages carved into chunks at a time */
+
+/*
+ * fixed size dma buffers carved from contiguous pages. a pool never gives its
+ * pages back before LOS_DmaPoolDestroy, so alloc and free are a list pop and
+ * push under the pool lock and may be called from interrupt context.
+ */
+typedef struct DmaPool {
+    const CHAR          *name;
+    size_t              size;       /* chunk size, multiple of align */
+    size_t              align;
+    enum DmaMemType     type;
+    UINT32              blockPages;
+    SPIN_LOCK_S         lock;
+    VOID                *freeList;  /* free chunks, linked through their first word */
+    LOS_DL_LIST         blocks;     /* block headers live at the start of each block */
+    UINT32              nrChunks;
+    UINT32              nrFree;
+} LosDmaPool;
+
 /* thread safety */
 VOID *LOS_DmaMemAlloc(DMA_ADDR_T *dmaAddr, size_t size, size_t align, enum DmaMemType type);
 VOID LOS_DmaMemFree(VOID *vaddr);
 DMA_ADDR_T LOS_DmaVaddrToPaddr(VOID *vaddr);
+LosDmaPool *LOS_DmaPoolCreate(const CHAR *name, size_t size, size_t align, enum DmaMemType type);
+STATUS_T LOS_DmaPoolDestroy(LosDmaPool *pool);
+VOID *LOS_DmaPoolAlloc(LosDmaPool *pool, DMA_ADDR_T *dmaAddr);
+VOID LOS_DmaPoolFree(LosDmaPool *pool, VOID *vaddr);
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -94,6 +94,13 @@ typedef struct VmFault {
     VADDR_T         vaddr;              /* Faulting virtual address */ //产生缺页的虚拟地址
     VADDR_T         *pageKVaddr;        /* KVaddr of pagefault's vm page's paddr */ //page cache中的虚拟地址
 } LosVmPgFault;
+//文件预读窗口,顺序访问时窗口从 VM_FILEMAP_RA_MIN_PAGES 倍增至 VM_FILEMAP_RA_MAX_PAGES
+typedef struct VmFileReadahead {
+    VM_OFFSET_T     start;              /* first page offset of the current window */	//当前窗口起始页
+    UINT32          size;               /* pages of the current window */	//当前窗口页数
+    UINT32          mode;               /* FILE_RA_NORMAL, FILE_RA_SEQUENTIAL, FILE_RA_RANDOM */	//预读模式,由 fadvise/madvise 设置
+    VM_OFFSET_T     prevPgoff;          /* page offset of the last access */	//上一次访问的页
+} LosFileReadahead;
 //虚拟内存文件操作函数指针,上层开发可理解为 class 里的方法，注意是对线性区的操作
 struct VmFileOps {// 文件操作 见于g_commVmOps
     void (*open)(struct VmMapRegion *region); //打开
@@ -107,6 +114,9 @@ struct VmMapRegion {//线性区描述符,内核通过线性区管理虚拟地址
     LosVmSpace          *space;			//所属虚拟空间,虚拟空间由多个线性区组成
     LOS_DL_LIST         node;           /**< region dl list */				//链表节点,通过它将本线性区挂在VmSpace.regions上
     LosVmMapRange       range;          /**< region address range */		//记录线性区的范围
+    VADDR_T             subtreeStart;   /**< lowest base in the rbtree subtree */	//红黑树增强:子树中最低的起始地址
+    VADDR_T             subtreeLast;    /**< highest end address in the rbtree subtree */	//子树中最高的结束地址
+    size_t              subtreeMaxGap;  /**< largest hole between regions of the subtree */	//子树内线性区之间最大的空洞
     VM_OFFSET_T         pgOff;          /**< region page offset to file */	//以文件开始处的偏移量, 必须是分页大小的整数倍, 通常为0, 表示从文件头开始映射。
     UINT32              regionFlags;   /**< region flags: cow, user_wired *///线性区标签
     UINT32              shmid;          /**< shmid about shared region */	//shmid为共享线性区id
@@ -118,6 +128,7 @@ struct VmMapRegion {//线性区描述符,内核通过线性区管理虚拟地址
             unsigned int fileMagic;//具有特殊文件格式的文件,魔法数字.例如 stack top 的魔法数字为 0xCCCCCCCC
             struct file *file;		//文件指针
             const LosVmFileOps *vmFOps;//文件处理各操作接口
+            LosFileReadahead readahead;//缺页预读窗口
         } rf;
         struct VmRegionAnon {//匿名映射可理解为就是物理内存
             LOS_DL_LIST  node;          /**< region LosVmPage list */ 	//线性区虚拟页链表
@@ -129,11 +140,13 @@ struct VmMapRegion {//线性区描述符,内核通过线性区管理虚拟地址
     } unTypeData;
 };
 
+#define VM_REGION_CACHE_SIZE    4   //每个空间缓存最近找到的线性区个数,缺页大多落在同几个线性区
 typedef struct VmSpace {
     LOS_DL_LIST         node;           /**< vm space dl list */	//节点,通过它挂到全局虚拟空间 g_vmSpaceList 链表上
     LOS_DL_LIST         regions;        /**< region dl list */		//双循环链表方式管理本空间各个线性区
     LosRbTree           regionRbTree;   /**< region red-black tree root */	//采用红黑树方式管理本空间各个线性区
     LosMux              regionMux;      /**< region list mutex lock */	//虚拟空间的互斥锁
+    Atomic              refCount;       /**< processes running in the space */	//引用计数,CLONE_VM/vfork 子进程与父进程共用空间时各持一份
     VADDR_T             base;           /**< vm space base addr */		//虚拟空间的基地址,常用于判断地址是否在内核还是用户空间
     UINT32              size;           /**< vm space size */			//虚拟空间大小
     VADDR_T             heapBase;       /**< vm space heap base address */	//用户进程专用，堆区基地址，表堆区范围起点
@@ -142,6 +155,20 @@ typedef struct VmSpace {
     VADDR_T             mapBase;        /**< vm space mapping area base */	//虚拟空间映射区基地址,L1，L2表存放在这个区
     UINT32              mapSize;        /**< vm space mapping area size */	//虚拟空间映射区大小，映射区是个很大的区。
     LosArchMmu          archMmu;        /**< vm mapping physical memory */	//MMU记录<虚拟地址,物理地址>的映射情况
+    LosVmMapRegion      *regionCache[VM_REGION_CACHE_SIZE]; /**< regions recently found, under regionMux */	//最近找到的线性区,只在持有 regionMux 时读写,增删线性区时清空
+    UINT32              regionCacheNext;    /**< next cache slot to replace */	//下一个被替换的槽位
+    UINT32              regionCacheHits;    /**< region lookups served by the cache */	//命中次数,vmm 命令中查看
+    UINT32              regionCacheMisses;  /**< region lookups that walked the rbtree */	//未命中次数
+    UINT32              defRegionFlags;     /**< flags added to new mmap regions */	//mlockall(MCL_FUTURE) 后新映射的线性区默认带上锁定标签
+#ifdef LOSCFG_KERNEL_VM_KSM
+    VADDR_T             ksmCursor;      /**< next address scanned for page merging */	//相同页合并扫描的下一个地址
+#endif
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    VADDR_T             swapCursor;     /**< next address scanned for swap out */	//换出扫描的下一个地址,一轮扫完回到0
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    struct VmCharge     *charge;        /**< resident page accounting and limit, user space only */	//计费组,只有用户空间有
+#endif
 #ifdef LOSCFG_DRIVERS_TZDRIVER
     VADDR_T             codeStart;      /**< user process code area start */
     VADDR_T             codeEnd;        /**< user process code area end */
@@ -178,6 +205,9 @@ typedef struct VmSpace {
 #define     VM_MAP_REGION_FLAG_MMAP                 (1<<15)		//映射区,虚拟空间内有专门用来存储<虚拟地址-物理地址>映射的区域
 #define     VM_MAP_REGION_FLAG_SHM                  (1<<16) 	//共享内存区,和代码区同级概念,意思是整个线性区被贴上共享标签
 #define     VM_MAP_REGION_FLAG_INVALID              (1<<17) /* indicates that flags are not specified */
+#define     VM_MAP_REGION_FLAG_LOCKED               (1<<18)		//mlock 锁定区,映射的文件页不会被回收
+#define     VM_MAP_REGION_FLAG_MERGEABLE            (1<<19)		//madvise(MADV_MERGEABLE) 标记,内容相同的匿名页可以合并
+#define     VM_MAP_REGION_FLAG_PURGE                (1<<20)		//vmalloc 区已解除映射,地址等待惰性清理统一失效TLB后归还
 
 STATIC INLINE UINT32 OsCvtProtFlagsToRegionFlags(unsigned long prot, unsigned long flags)
 {
@@ -189,6 +219,7 @@ STATIC INLINE UINT32 OsCvtProtFlagsToRegionFlags(unsigned long prot, unsigned lo
     regionFlags |= (prot & PROT_EXEC) ? VM_MAP_REGION_FLAG_PERM_EXECUTE : 0;	//映射区可被执行
     regionFlags |= (flags & MAP_SHARED) ? VM_MAP_REGION_FLAG_SHARED : 0;		//映射区可被共享
     regionFlags |= (flags & MAP_PRIVATE) ? VM_MAP_REGION_FLAG_PRIVATE : 0;		//映射区私有
+    regionFlags |= (flags & MAP_LOCKED) ? VM_MAP_REGION_FLAG_LOCKED : 0;		//映射区锁定
 
     return regionFlags;
 }
@@ -208,6 +239,15 @@ STATIC INLINE VADDR_T LOS_RegionEndAddr(LosVmMapRegion *region)
 {
     return (region->range.base + region->range.size - 1);
 }
+//增删线性区后清空查找缓存,缓存中可能留着已经释放的线性区
+STATIC INLINE VOID OsRegionCacheFlush(LosVmSpace *space)
+{
+    UINT32 index;
+
+    for (index = 0; index < VM_REGION_CACHE_SIZE; index++) {
+        space->regionCache[index] = NULL;
+    }
+}
 //线性区大小
 STATIC INLINE size_t LOS_RegionSize(VADDR_T start, VADDR_T end)
 {
@@ -291,6 +331,7 @@ STATUS_T LOS_VmSpaceReserve(LosVmSpace *space, size_t size, VADDR_T vaddr);
 LosVmSpace *LOS_GetKVmSpace(VOID);
 INT32 OsUserHeapFree(LosVmSpace *vmSpace, VADDR_T addr, size_t len);
 VADDR_T OsAllocRange(LosVmSpace *vmSpace, size_t len);
+VADDR_T OsAllocRangeAlign(LosVmSpace *vmSpace, size_t len, size_t align);
 VADDR_T OsAllocSpecificRange(LosVmSpace *vmSpace, VADDR_T vaddr, size_t len);
 LosVmMapRegion *OsCreateRegion(VADDR_T vaddr, size_t len, UINT32 regionFlags, unsigned long offset);
 BOOL OsInsertRegion(LosRbTree *regionRbTree, LosVmMapRegion *region);
@@ -305,7 +346,10 @@ STATUS_T OsVmRegionAdjust(LosVmSpace *space, VADDR_T vaddr, size_t size);
 LosVmMapRegion *OsVmRegionDup(LosVmSpace *space, LosVmMapRegion *oldRegion, VADDR_T vaddr, size_t size);
 STATUS_T OsIsRegionCanExpand(LosVmSpace *space, LosVmMapRegion *region, size_t size);
 STATUS_T LOS_RegionFree(LosVmSpace *space, LosVmMapRegion *region);
+STATUS_T OsRegionPagesRelease(LosVmSpace *space, LosVmMapRegion *region, VADDR_T vaddr, size_t size);
 STATUS_T LOS_VmSpaceFree(LosVmSpace *space);
+VOID OsVmSpaceGet(LosVmSpace *space);
+STATUS_T OsVmSpacePut(LosVmSpace *space);
 STATUS_T LOS_VaddrToPaddrMmap(LosVmSpace *space, VADDR_T vaddr, PADDR_T paddr, size_t len, UINT32 flags);
 BOOL OsUserVmSpaceInit(LosVmSpace *vmSpace, VADDR_T *virtTtb);
 STATUS_T LOS_VmSpaceClone(LosVmSpace *oldVmSpace, LosVmSpace *newVmSpace);
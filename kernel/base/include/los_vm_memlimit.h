@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @defgroup los_vm_memlimit vm per process memory limit
+ * @ingroup kernel
+ */
+
+#ifndef __LOS_VM_MEMLIMIT_H__
+#define __LOS_VM_MEMLIMIT_H__
+
+#include "los_typedef.h"
+#include "los_atomic.h"
+#include "los_vm_map.h"
+#include "los_vm_page.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+/**************************************************************************************************
+ 进程驻留内存上限(类似 memcg):每个用户空间带一个计费组,记下它名下的物理页数.
+ 缺页分配的匿名页,写时拷贝页,换回的页以及它读入的页高速缓存都记在分配它的进程名下,
+ 页框最后一次释放时从计费组里扣除,所以 munmap,换出,页缓存删除和进程退出都会自动退费.
+ 超过上限时先在本进程名下回收(文件页,开启压缩交换时还有匿名页),仍不够则本次缺页失败,
+ 只有这个进程自己被杀,不会把页缓存回收和 OOM 转嫁给板子上的其他进程.
+**************************************************************************************************/
+#define VM_MEMLIMIT_RECLAIM_BATCH   8   /* pages reclaimed beyond the excess, so the next faults pass */
+#define VM_MEMLIMIT_SCAN_MAX        512 /* lru pages looked at per segment when reclaiming for one group */
+#define VM_MEMLIMIT_NORECLAIM_SLACK 32  /* pages a charge that cannot reclaim may go over the limit */
+
+typedef struct VmCharge {
+    Atomic              usage;          /**< resident pages charged to the group */	//计费页数
+    UINT32              limit;          /**< limit in pages, 0 means unlimited */	//上限页数,0表示不限
+    Atomic              refCount;       /**< held by the owning space and by each charged page */	//空间和每个计费页各持一个引用
+    UINT32              maxUsage;       /**< usage high watermark */	//用量峰值
+    UINT32              reclaimed;      /**< pages reclaimed because of the limit */	//因超限在本组内回收的页数
+    UINT32              failCnt;        /**< charges refused over the limit */	//超限且回收不足导致分配失败的次数
+} LosVmCharge;
+
+LosVmCharge *OsVmChargeCreate(UINT32 limit);
+VOID OsVmChargePut(LosVmCharge *charge);
+STATUS_T OsVmPageCharge(LosVmSpace *space, LosVmPage *page, BOOL mayReclaim);
+VOID OsVmPageUncharge(LosVmPage *page);
+VOID OsVmChargeLimitInherit(LosVmSpace *dst, const LosVmSpace *src);
+size_t OsTryShrinkChargeMemory(LosVmSpace *space, size_t nPage);
+STATUS_T LOS_VmSpaceMemLimitSet(LosVmSpace *space, UINT32 limit);
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#endif /* __LOS_VM_MEMLIMIT_H__ */
@@ -56,6 +56,9 @@ typedef struct VmPage {	//物理页框描述符
     UINT8               order;       /**< vm page in which order list */	//被安置在伙伴算法的几号序列(              2^0,2^1,2^2,...,2^order)
     UINT8               segID;       /**< the segment id of vm page */	//所属段ID
     UINT16              nPages;      /**< the vm page is used for kernel heap */	//分配页数,标识从本页开始连续的几页将一块被分配
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    struct VmCharge     *charge;     /**< memory limit group the page is charged to */	//页记在哪个计费组名下,未计费为NULL
+#endif
 } LosVmPage;//注意:关于nPages和order的关系说明,当请求分配为5页时,order是等于3的,因为只有2^3才能满足5页的请求
 
 extern LosVmPage *g_vmPageArray;//物理页框(page frame)池,在g_vmPageArray中:不可能存在两个物理地址一样的物理页框,
@@ -74,6 +74,10 @@ enum OsLruList {//Lru全称是Least Recently Used，即最近最久未使用的
     VM_NR_LRU_LISTS
 };
 
+/* file pages are aged in generations, minSeq is the oldest and maxSeq the youngest */
+#define VM_LRU_NR_GENS          4
+#define VM_LRU_GEN(seq)         ((seq) % VM_LRU_NR_GENS)
+
 typedef struct VmPhysSeg {//物理段描述符
     PADDR_T start;            /* The start of physical memory area */	//物理内存段的开始地址
     size_t size;              /* The size of physical memory area */	//物理内存段的大小
@@ -83,6 +87,19 @@ typedef struct VmPhysSeg {//物理段描述符
     SPIN_LOCK_S lruLock;		//用于置换的自旋锁,用于操作lruList
     size_t lruSize[VM_NR_LRU_LISTS];		//5个双循环链表大小，如此方便得到size
     LOS_DL_LIST lruList[VM_NR_LRU_LISTS];	//页面置换算法,5个双循环链表头，它们分别描述五中不同类型的链表
+    UINT32 minSeq;		//文件页最老一代的序号,回收从这一代开始
+    UINT32 maxSeq;		//文件页最年轻一代的序号,新加入和刚被访问过的页挂在这一代
+    size_t genSize[VM_LRU_NR_GENS];		//每一代的文件页数
+    LOS_DL_LIST genList[VM_LRU_NR_GENS];	//文件页按代挂链,下标为 VM_LRU_GEN(seq)
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+    INT32 fragIndex;			//最近一次连续分配失败时的碎片指数,见 OsVmPhysFragIndex
+    UINT32 compactCursor;		//整理扫描停下的页号,下次接着往后挑块
+    UINT32 compactDefer;		//整理失败后还要跳过的次数
+    UINT32 compactDeferShift;	//连续失败次数,跳过次数按 1 << shift 增长
+    UINT32 compactRuns;			//整理次数
+    UINT32 compactSuccess;		//整理出大块的次数
+    UINT32 compactMigrated;		//搬走的页数
+#endif
 } LosVmPhysSeg;
 
 struct VmPhysArea {//物理区描述,仅用于方案商配置范围使用
@@ -102,8 +119,14 @@ VOID OsVmPhysInit(VOID);
 VOID OsVmPhysAreaSizeAdjust(size_t size);
 UINT32 OsVmPhysPageNumGet(VOID);
 LosVmPage *OsVmVaddrToPage(VOID *ptr);
+VOID OsPhysPageZero(VOID *kvaddr);
+VOID OsPhysPageCopy(VOID *dst, const VOID *src);
 VOID OsPhysSharePageCopy(PADDR_T oldPaddr, PADDR_T *newPaddr, LosVmPage *newPage);
 VOID OsVmPhysPagesFreeContiguous(LosVmPage *page, size_t nPages);
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+size_t OsVmPhysRangeIsolate(LosVmPage *page, size_t nPages, LOS_DL_LIST *list);
+VOID OsVmPhysRangePutback(LOS_DL_LIST *list);
+#endif
 LosVmPage *OsVmPhysToPage(paddr_t pa, UINT8 segID);
 
 LosVmPage *LOS_PhysPageAlloc(VOID);
@@ -60,6 +60,10 @@ VADDR_T LOS_MMap(VADDR_T vaddr, size_t len, unsigned prot, unsigned long flags,
 STATUS_T LOS_UnMMap(VADDR_T addr, size_t size);
 VOID *LOS_DoBrk(VOID *addr);
 int LOS_DoMprotect(VADDR_T vaddr, size_t len, unsigned long prot);
+int LOS_DoMadvise(VADDR_T vaddr, size_t len, int advice);
+int LOS_DoMlock(VADDR_T vaddr, size_t len, BOOL lock);
+int LOS_DoMlockAll(int flags);
+int LOS_DoMunlockAll(VOID);
 VADDR_T LOS_DoMremap(VADDR_T oldAddress, size_t oldSize, size_t newSize, int flags, VADDR_T newAddr);
 VOID LOS_DumpMemRegion(VADDR_T vaddr);
 INT32 ShmInit(VOID);
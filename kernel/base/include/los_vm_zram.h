@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @defgroup los_vm_zram vm zram definition
+ * @ingroup kernel
+ */
+
+#ifndef __LOS_VM_ZRAM_H__
+#define __LOS_VM_ZRAM_H__
+
+#include "los_vm_map.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+/**************************************************************************************************
+ 压缩交换区:内存紧张时把不常用的匿名页压缩后留在内核堆里,腾出物理页;
+ 页表项里留下槽位号,再访问时缺页换回.没有外部交换设备,压不下去的页就不换出.
+**************************************************************************************************/
+#define VM_ZRAM_SWAP_BATCH          32  /* pages swapped out per shrink request */
+#define VM_ZRAM_SCAN_PAGES_MAX      512 /* pages looked at per shrink request */
+
+UINT32 OsVmZramInit(VOID);
+VOID OsVmZramEntryPut(UINT32 entry);
+VOID OsVmZramEntryDup(UINT32 entry);
+STATUS_T OsVmZramSwapOut(LosVmSpace *space, LosVmMapRegion *region, VADDR_T vaddr);
+STATUS_T OsVmZramSwapIn(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 regionFlags);
+size_t OsTrySwapAnonMemory(size_t nPage);
+VOID OsVmZramDump(VOID);
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#endif /* __LOS_VM_ZRAM_H__ */
@@ -42,6 +42,13 @@
 #include "los_oom.h"
 #include "los_vm_dump.h"
 #include "los_process_pri.h"
+#include "los_vm_event.h"
+#ifdef LOSCFG_KERNEL_VM_KSM
+#include "los_vm_ksm.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -49,6 +56,7 @@ extern "C" {
 #endif /* __cplusplus */
 #endif /* __cplusplus */
 
+#define ARGC_3             3
 #define ARGC_2             2
 #define ARGC_1             1
 #define ARGC_0             0
@@ -86,8 +94,78 @@ LITE_OS_SEC_TEXT_MINOR VOID OsPrintUsage(VOID)
     PRINTK("-a,            print all vm address space information\n"
            "-k,            print the kernel vm address space information\n"
            "pid(0~63),     print process[pid] vm address space information\n"
+           "-e,            print vm event counters\n"
+#ifdef LOSCFG_KERNEL_VM_KSM
+           "-m,            print same page merging statistics\n"
+           "-m pages ms,   merge scan up to [pages] pages every [ms] milliseconds, 0 pages stops scanning\n"
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+           "-l pid pages,  limit process[pid] to [pages] resident pages, 0 removes the limit\n"
+#endif
            "-h | --help,   print vmm command usage\n");
 }
+#ifdef LOSCFG_KERNEL_VM_KSM
+//vmm -m pages ms 调整相同页合并的扫描速度
+LITE_OS_SEC_TEXT_MINOR VOID OsDoKsmScanRateSet(const CHAR *pages, const CHAR *ms)
+{
+    UINT32 pagesToScan;
+    UINT32 sleepMs;
+    CHAR *endPtr = NULL;
+
+    pagesToScan = strtoul(pages, &endPtr, 0);
+    if ((endPtr == NULL) || (*endPtr != 0)) {
+        PRINTK("[ksm] pages to scan %s invalid.\n", pages);
+        return;
+    }
+    sleepMs = strtoul(ms, &endPtr, 0);
+    if ((endPtr == NULL) || (*endPtr != 0)) {
+        PRINTK("[ksm] sleep %s(ms) invalid.\n", ms);
+        return;
+    }
+    OsVmKsmScanRateSet(pagesToScan, sleepMs);
+}
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+//vmm -l pid pages 设置进程驻留页数上限
+LITE_OS_SEC_TEXT_MINOR VOID OsDoMemLimitSet(const CHAR *pidStr, const CHAR *pages)
+{
+    LosProcessCB *processCB = NULL;
+    LosVmSpace *space = NULL;
+    pid_t pid = OsPid(pidStr);
+    UINT32 limit;
+    UINT32 intSave;
+    STATUS_T ret;
+    CHAR *endPtr = NULL;
+
+    if ((pid < 0) || OsProcessIDUserCheckInvalid(pid)) {
+        PRINTK("\tThe process [%s] not valid\n", pidStr);
+        return;
+    }
+    limit = strtoul(pages, &endPtr, 0);
+    if ((endPtr == NULL) || (*endPtr != 0)) {
+        PRINTK("[memlimit] pages %s invalid.\n", pages);
+        return;
+    }
+
+    SCHEDULER_LOCK(intSave);//进程退出时在调度锁下摘掉空间,锁外才放下引用,这里拿住空间再设置
+    processCB = OS_PCB_FROM_PID(pid);
+    if (!OsProcessIsUnused(processCB) && (processCB->vmSpace != NULL)) {
+        space = processCB->vmSpace;
+        OsVmSpaceGet(space);
+    }
+    SCHEDULER_UNLOCK(intSave);
+    if (space == NULL) {
+        PRINTK("\tThe process [%d] not active\n", pid);
+        return;
+    }
+
+    ret = LOS_VmSpaceMemLimitSet(space, limit);//设置时可能回收页高速缓存,不能持有调度锁
+    if (ret != LOS_OK) {
+        PRINTK("[memlimit] set limit of process [%d] failed, ret = %#x\n", pid, ret);
+    }
+    (VOID)OsVmSpacePut(space);
+}
+#endif
 
 LITE_OS_SEC_TEXT_MINOR VOID OsDoDumpVm(pid_t pid)
 {
@@ -116,6 +194,12 @@ LITE_OS_SEC_TEXT_MINOR UINT32 OsShellCmdDumpVm(INT32 argc, const CHAR *argv[])
             OsDumpAllAspace();
         } else if (strcmp(argv[0], "-k") == 0) {//# vmm -k 查看内核进程使用虚拟内存的情况
             OsDumpKernelAspace();
+        } else if (strcmp(argv[0], "-e") == 0) {//# vmm -e 查看缺页,页高速缓存,回收,页分配等事件计数
+            OsVmEventDump();
+#ifdef LOSCFG_KERNEL_VM_KSM
+        } else if (strcmp(argv[0], "-m") == 0) {//# vmm -m 查看相同页合并的情况
+            OsVmKsmDump();
+#endif
         } else if (pid >= 0) { //# vmm 3 查看3号进程使用虚拟内存的情况
             OsDoDumpVm(pid);
         } else if (strcmp(argv[0], "-h") == 0 || strcmp(argv[0], "--help") == 0) { //# vmm -h 或者  vmm --help
@@ -124,6 +208,14 @@ LITE_OS_SEC_TEXT_MINOR UINT32 OsShellCmdDumpVm(INT32 argc, const CHAR *argv[])
             PRINTK("%s: invalid option: %s\n", VMM_CMD, argv[0]);	//格式错误，输出规范格式
             OsPrintUsage();
         }
+#ifdef LOSCFG_KERNEL_VM_KSM
+    } else if ((argc == ARGC_3) && (strcmp(argv[0], "-m") == 0)) {//# vmm -m 100 200 每200ms扫描100页
+        OsDoKsmScanRateSet(argv[1], argv[2]);
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    } else if ((argc == ARGC_3) && (strcmp(argv[0], "-l") == 0)) {//# vmm -l 7 256 7号进程最多驻留256页
+        OsDoMemLimitSet(argv[1], argv[2]);
+#endif
     } else {	//多于一个参数 例如 # vmm 3 9
         OsPrintUsage();
     }
@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**************************************************************************************************
+ 物理内存整理(compaction)
+ 伙伴算法只能把相邻的空闲块合并,长时间运行后空闲页总数够,却凑不出64K,1M这样的连续块.
+ 连续分配失败时,在物理段里按对齐挑块,块内没有内核自己占着的页(引用数为0又不在页缓存里)才挑:
+ 1.块内的空闲块先从伙伴链表摘下,迁移分配的新页就不会落回块里;
+ 2.页缓存页:解除所有进程的映射,拷贝到新页,换掉 LosFilePage 的页框,再访问时缺页映射到新页;
+ 3.匿名页没有反向映射,和换出一样轮流遍历用户空间的私有匿名线性区,在 regionMux 下拆映射,拷贝,映射新页;
+ 4.搬空的旧页和摘下的空闲块一起还给伙伴算法,合并出整块后调用者再分配一次.
+ 空闲页本来就不够(碎片指数低)时不整理;整理失败后按 1,2,4..64 次推迟,避免每次分配失败都白扫一遍.
+**************************************************************************************************/
+#include "los_vm_compact.h"
+#include "los_vm_filemap.h"
+#include "los_vm_map.h"
+#include "los_vm_page.h"
+#include "los_vm_phys.h"
+#include "los_vm_event.h"
+#include "los_hw.h"
+#include "los_hw_cpu.h"
+#include "los_sched_pri.h"
+#include "los_printf.h"
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+
+typedef struct {
+    LosVmPage   *base;      /* first page of the block being emptied */
+    size_t      nPages;
+    size_t      nUsed;      /* pages of the block still in use */
+    UINT32      migrated;
+    LOS_DL_LIST freeList;   /* isolated free blocks and migrated-out pages */
+} LosVmCompactCtrl;
+
+/**************************************************************************************************
+ 碎片指数,算法同 Linux 的 fragmentation index,放大1000倍:
+ 有 order 级以上空闲块时返回 VM_FRAG_INDEX_SUITABLE,没有空闲页返回0,
+ 否则为 1000 - (1000 + 空闲页数 * 1000 / 需要的页数) / 空闲块数,空闲块越多越碎越接近1000
+**************************************************************************************************/
+INT32 OsVmPhysFragIndex(LosVmPhysSeg *seg, UINT32 order)
+{
+    UINT32 intSave;
+    UINT32 index;
+    UINT32 requested = VM_ORDER_TO_PAGES(order);
+    UINT32 freeBlocks = 0;
+    UINT32 freePages = 0;
+
+    LOS_SpinLockSave(&seg->freeListLock, &intSave);
+    for (index = 0; index < VM_LIST_ORDER_MAX; index++) {
+        if ((index >= order) && (seg->freeList[index].listCnt > 0)) {
+            LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+            return VM_FRAG_INDEX_SUITABLE;
+        }
+        freeBlocks += seg->freeList[index].listCnt;
+        freePages += seg->freeList[index].listCnt << index;
+    }
+    LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+
+    if (freeBlocks == 0) {
+        return 0;
+    }
+    return VM_FRAG_INDEX_MAX - (INT32)((VM_FRAG_INDEX_MAX + freePages * VM_FRAG_INDEX_MAX / requested) / freeBlocks);
+}
+//整理要拿互斥锁和页缓存的锁,持有自旋锁(关着中断),在中断里或锁了任务调度时都不整理
+STATIC INLINE BOOL OsVmCompactAllowed(VOID)
+{
+    return !OsIntLocked() && LOS_CHECK_SCHEDULE;
+}
+
+STATIC INLINE BOOL OsVmCompactInBlock(const LosVmCompactCtrl *ctrl, const LosVmPage *page)
+{
+    return (page >= ctrl->base) && (page < ctrl->base + ctrl->nPages);
+}
+//旧页已经没有引用,先挂到 freeList 上,整块搬完再一起还给伙伴算法
+STATIC VOID OsVmCompactOldPagePut(LosVmCompactCtrl *ctrl, LosVmPage *page)
+{
+    LOS_AtomicSet(&page->refCounts, 0);
+    page->flags = 0;
+    page->nPages = 1;
+    LOS_ListTailInsert(&ctrl->freeList, &page->node);
+    OsVmEventInc(VM_EVENT_PAGE_FREE);
+    ctrl->nUsed--;
+    ctrl->migrated++;
+}
+//新页接过旧页的标签和计费
+STATIC VOID OsVmCompactPageStateMove(LosVmPage *newPage, LosVmPage *oldPage)
+{
+    newPage->flags = oldPage->flags;
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    newPage->charge = oldPage->charge;
+    oldPage->charge = NULL;
+#endif
+}
+//粗筛:块里已用的页只要有一页既没有被映射也不在页缓存里(内核分配的,页表等)或是共享内存页,整块就搬不空
+STATIC BOOL OsVmCompactBlockMovable(LosVmPage *base, size_t nPages)
+{
+    LosVmPage *page = NULL;
+    size_t index = 0;
+
+    while (index < nPages) {
+        page = &base[index];
+        if (page->order < VM_LIST_ORDER_MAX) {//空闲块
+            index += VM_ORDER_TO_PAGES(page->order);
+            continue;
+        }
+        if (((LOS_AtomicRead(&page->refCounts) == 0) && !BIT_GET(page->flags, FILE_PAGE_LRU)) ||
+            OsIsPageShared(page)) {
+            return FALSE;
+        }
+        index++;
+    }
+    return TRUE;
+}
+
+#ifdef LOSCFG_FS_VFS
+/**************************************************************************************************
+ 搬一个页缓存页,调用者持有 lruLock 和 mapping->list_lock.
+ 先解除所有映射(拆映射时刷了TLB,之后不会再有人通过旧映射写旧页),再拷贝;
+ 进程再访问时缺页要拿 list_lock,等这里搬完后找到的已经是新页.
+ 回收也不动的页这里同样不动:正在读写的,mlock 的,映射着的代码页;旧页被别处(如回写副本)引用着也不动
+**************************************************************************************************/
+STATIC BOOL OsVmCompactFilePage(LosVmCompactCtrl *ctrl, LosFilePage *fpage)
+{
+    LosVmPage *oldPage = fpage->vmPage;
+    LosVmPage *newPage = NULL;
+
+    if (OsIsPageLocked(oldPage) || OsIsPageMlocked(fpage) ||
+        (OsIsPageMapped(fpage) && (fpage->flags & VM_MAP_REGION_FLAG_PERM_EXECUTE))) {
+        return FALSE;
+    }
+    if (LOS_AtomicRead(&oldPage->refCounts) != (INT32)fpage->n_maps) {
+        return FALSE;
+    }
+
+    newPage = LOS_PhysPageAlloc();
+    if (newPage == NULL) {
+        return FALSE;
+    }
+    if (OsVmPhysSegGet(newPage) != fpage->physSeg) {//换段就要换LRU链表,不搬
+        LOS_PhysPageFree(newPage);
+        return FALSE;
+    }
+
+    if (OsIsPageMapped(fpage)) {
+        OsUnmapAllLocked(fpage);
+    }
+    OsPhysPageCopy(OsVmPageToVaddr(newPage), OsVmPageToVaddr(oldPage));
+    OsVmCompactPageStateMove(newPage, oldPage);
+    fpage->vmPage = newPage;
+    OsVmCompactOldPagePut(ctrl, oldPage);
+    return TRUE;
+}
+//在段的各代LRU链表里找页框落在块内的页缓存页,拿不到 mapping 锁的跳过
+STATIC VOID OsVmCompactFilePages(LosVmPhysSeg *seg, LosVmCompactCtrl *ctrl)
+{
+    UINT32 intSave;
+    UINT32 seq;
+    LosFilePage *fpage = NULL;
+    LosFilePage *fnext = NULL;
+    SPIN_LOCK_S *flock = NULL;
+
+    LOS_SpinLockSave(&seg->lruLock, &intSave);
+    for (seq = seg->minSeq; (seq <= seg->maxSeq) && (ctrl->nUsed > 0); seq++) {
+        LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(fpage, fnext, &seg->genList[VM_LRU_GEN(seq)], LosFilePage, lru) {
+            if (!OsVmCompactInBlock(ctrl, fpage->vmPage)) {
+                continue;
+            }
+            flock = &fpage->mapping->list_lock;
+            if (LOS_SpinTrylock(flock) != LOS_OK) {
+                continue;
+            }
+            (VOID)OsVmCompactFilePage(ctrl, fpage);
+            LOS_SpinUnlock(flock);
+            if (ctrl->nUsed == 0) {
+                break;
+            }
+        }
+    }
+    LOS_SpinUnlockRestore(&seg->lruLock, intSave);
+}
+#endif
+//可迁移的线性区和可换出的相同:进程私有的匿名映射和堆.代码不动,省得维护指令缓存
+STATIC BOOL OsVmCompactRegionMovable(const LosVmSpace *space, const LosVmMapRegion *region)
+{
+    if ((region->regionFlags & (VM_MAP_REGION_FLAG_SHM | VM_MAP_REGION_FLAG_LOCKED | VM_MAP_REGION_FLAG_VDSO |
+        VM_MAP_REGION_FLAG_SHARED | VM_MAP_REGION_FLAG_PERM_EXECUTE)) != 0) {
+        return FALSE;
+    }
+    if ((region->regionFlags & VM_MAP_REGION_FLAG_PERM_USER) == 0) {
+        return FALSE;
+    }
+    return LOS_IsRegionTypeAnon((LosVmMapRegion *)region) || (region == space->heap);
+}
+/**************************************************************************************************
+ 搬一个匿名页,调用者持有 space->regionMux.只搬本空间独占的页,写时拷贝共享着的和合并页不动.
+ 先拆映射并刷TLB,其他核上的线程再访问会缺页,缺页处理要拿 regionMux,等这里映射好新页后直接返回.
+ 新映射沿用旧页表项的属性,64K大页拆映射时会先拆成小页
+**************************************************************************************************/
+STATIC BOOL OsVmCompactAnonPage(LosVmCompactCtrl *ctrl, LosVmSpace *space, VADDR_T vaddr)
+{
+    LosArchMmu *archMmu = &space->archMmu;
+    LosVmPage *oldPage = NULL;
+    LosVmPage *newPage = NULL;
+    PADDR_T paddr = 0;
+    UINT32 flags = 0;
+
+    if (LOS_ArchMmuQuery(archMmu, vaddr, &paddr, &flags) != LOS_OK) {
+        return FALSE;
+    }
+    oldPage = LOS_VmPageGet(paddr);
+    if ((oldPage == NULL) || !OsVmCompactInBlock(ctrl, oldPage)) {
+        return FALSE;
+    }
+    if (OsIsPageShared(oldPage) || OsIsPageMerged(oldPage) || (LOS_AtomicRead(&oldPage->refCounts) != 1)) {
+        return FALSE;
+    }
+
+    newPage = LOS_PhysPageAlloc();
+    if (newPage == NULL) {
+        return FALSE;
+    }
+    (VOID)LOS_ArchMmuUnmap(archMmu, vaddr, 1);
+    OsPhysPageCopy(OsVmPageToVaddr(newPage), OsVmPageToVaddr(oldPage));
+    if (LOS_ArchMmuMap(archMmu, vaddr, VM_PAGE_TO_PHYS(newPage), 1, flags) < 0) {
+        (VOID)LOS_ArchMmuMap(archMmu, vaddr, paddr, 1, flags);
+        LOS_PhysPageFree(newPage);
+        return FALSE;
+    }
+    LOS_AtomicSet(&newPage->refCounts, 1);
+    OsVmCompactPageStateMove(newPage, oldPage);
+    OsVmCompactOldPagePut(ctrl, oldPage);
+    return TRUE;
+}
+//遍历用户空间的私有匿名线性区找页框落在块内的页,拿不到锁的空间跳过
+STATIC VOID OsVmCompactAnonPages(LosVmCompactCtrl *ctrl)
+{
+    LOS_DL_LIST *spaceList = LOS_GetVmSpaceList();
+    LosMux *spaceMux = OsGVmSpaceMuxGet();
+    LosVmSpace *space = NULL;
+    LosVmMapRegion *region = NULL;
+    LosRbNode *pstRbNode = NULL;
+    LosRbNode *pstRbNodeNext = NULL;
+    VADDR_T vaddr;
+    VADDR_T end;
+
+    if (LOS_MuxTrylock(spaceMux) != LOS_OK) {
+        return;
+    }
+
+    LOS_DL_LIST_FOR_EACH_ENTRY(space, spaceList, LosVmSpace, node) {
+        if (ctrl->nUsed == 0) {
+            break;
+        }
+        if (!LOS_IsUserAddress(space->base) || (LOS_MuxTrylock(&space->regionMux) != LOS_OK)) {
+            continue;
+        }
+        RB_SCAN_SAFE(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+            region = (LosVmMapRegion *)pstRbNode;
+            if (!OsVmCompactRegionMovable(space, region)) {
+                continue;
+            }
+            end = region->range.base + region->range.size;
+            for (vaddr = region->range.base; (vaddr < end) && (ctrl->nUsed > 0); vaddr += PAGE_SIZE) {
+                (VOID)OsVmCompactAnonPage(ctrl, space, vaddr);
+            }
+        RB_SCAN_SAFE_END(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+        (VOID)LOS_MuxUnlock(&space->regionMux);
+    }
+
+    (VOID)LOS_MuxUnlock(spaceMux);
+}
+//搬空一个块,返回块是否整个空出来了
+STATIC BOOL OsVmCompactBlock(LosVmPhysSeg *seg, LosVmPage *base, size_t nPages)
+{
+    LosVmCompactCtrl ctrl;
+
+    ctrl.base = base;
+    ctrl.nPages = nPages;
+    ctrl.migrated = 0;
+    LOS_ListInit(&ctrl.freeList);
+    ctrl.nUsed = nPages - OsVmPhysRangeIsolate(base, nPages, &ctrl.freeList);
+
+#ifdef LOSCFG_FS_VFS
+    if (ctrl.nUsed > 0) {
+        OsVmCompactFilePages(seg, &ctrl);
+    }
+#endif
+    if (ctrl.nUsed > 0) {
+        OsVmCompactAnonPages(&ctrl);
+    }
+
+    seg->compactMigrated += ctrl.migrated;
+    OsVmPhysRangePutback(&ctrl.freeList);
+    return (ctrl.nUsed == 0);
+}
+//从上次停下的块往后挑可以搬空的块,最多搬 VM_COMPACT_BLOCKS_MAX 块
+STATIC BOOL OsVmCompactSeg(LosVmPhysSeg *seg, UINT32 order)
+{
+    size_t nBlock = VM_ORDER_TO_PAGES(order);
+    size_t segPages = seg->size >> PAGE_SHIFT;
+    size_t first = (ROUNDUP(seg->start, VM_ORDER_TO_PHYS(order)) - seg->start) >> PAGE_SHIFT;
+    size_t last;
+    size_t cursor;
+    size_t index;
+    LosVmPage *base = NULL;
+    UINT32 tries = 0;
+
+    if (segPages < (first + nBlock)) {
+        return FALSE;
+    }
+    last = first + ((segPages - first) / nBlock) * nBlock;
+    cursor = seg->compactCursor;
+    if ((cursor < first) || (cursor >= last) || (((cursor - first) % nBlock) != 0)) {
+        cursor = first;
+    }
+
+    seg->compactRuns++;
+    for (index = first; (index < last) && (tries < VM_COMPACT_BLOCKS_MAX); index += nBlock) {
+        base = &seg->pageBase[cursor];
+        cursor += nBlock;
+        if (cursor >= last) {
+            cursor = first;
+        }
+        if (!OsVmCompactBlockMovable(base, nBlock)) {
+            continue;
+        }
+        tries++;
+        if (OsVmCompactBlock(seg, base, nBlock)) {
+            seg->compactCursor = cursor;
+            return TRUE;
+        }
+    }
+    seg->compactCursor = cursor;
+    return FALSE;
+}
+/**************************************************************************************************
+ 连续分配 2^order 页失败后调用,整理出一个这么大的空闲块返回 TRUE,调用者应再分配一次.
+ 只在碎片造成失败(碎片指数高于 VM_COMPACT_FRAG_THRESHOLD)时整理,失败后推迟下几次
+**************************************************************************************************/
+BOOL OsVmPhysCompact(UINT32 order)
+{
+    LosVmPhysSeg *seg = NULL;
+    UINT32 segID;
+    INT32 fragIndex;
+
+    if ((order == 0) || (order >= VM_LIST_ORDER_MAX) || !OsVmCompactAllowed()) {
+        return FALSE;
+    }
+
+    for (segID = 0; segID < g_vmPhysSegNum; segID++) {
+        seg = &g_vmPhysSeg[segID];
+        if (seg->size == 0) {
+            continue;
+        }
+        fragIndex = OsVmPhysFragIndex(seg, order);
+        if (fragIndex == VM_FRAG_INDEX_SUITABLE) {//期间有页释放,已经有大块了
+            return TRUE;
+        }
+        seg->fragIndex = fragIndex;
+        if (fragIndex <= VM_COMPACT_FRAG_THRESHOLD) {//空闲页本来就不够,整理也凑不出来
+            continue;
+        }
+        if (seg->compactDefer > 0) {
+            seg->compactDefer--;
+            continue;
+        }
+        if (OsVmCompactSeg(seg, order)) {
+            seg->compactSuccess++;
+            seg->compactDeferShift = 0;
+            return TRUE;
+        }
+        seg->compactDefer = 1U << seg->compactDeferShift;
+        if (seg->compactDeferShift < VM_COMPACT_DEFER_SHIFT_MAX) {
+            seg->compactDeferShift++;
+        }
+    }
+    return FALSE;
+}
+
+VOID OsVmCompactDump(const LosVmPhysSeg *seg)
+{
+    PRINTK("frag index %d, compact runs %u success %u migrated %u defer %u\n", seg->fragIndex,
+           seg->compactRuns, seg->compactSuccess, seg->compactMigrated, seg->compactDefer);
+}
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
@@ -44,6 +44,15 @@
 #include "los_atomic.h"
 #include "los_vm_lock.h"
 #include "los_memory_pri.h"
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+#include "los_vm_zram.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+#include "los_vm_compact.h"
+#endif
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -397,6 +406,14 @@ VOID OsDumpAspace(LosVmSpace *space)
     PRINTK(" ----   ------     ----       ----       -----     ----\n");
     PRINTK(" %-4d %#010x %-10.10s %#010x %#010x     %d\n", pcb->processID, space, pcb->processName,
         space->base, space->size, spacePages);
+    PRINTK(" region cache: hits %u, misses %u\n", space->regionCacheHits, space->regionCacheMisses);//LOS_RegionFind 缓存命中情况
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    if (space->charge != NULL) {//计费组用量,上限(0为不限),峰值,因超限回收的页数和分配失败次数
+        PRINTK(" mem limit: usage %d, limit %u, max %u, reclaimed %u, failcnt %u\n",
+            LOS_AtomicRead(&space->charge->usage), space->charge->limit, space->charge->maxUsage,
+            space->charge->reclaimed, space->charge->failCnt);
+    }
+#endif
 	
 	//虚拟区间控制块地址信息 | 虚拟区间类型 | 虚拟区间起始地址 | 虚拟区间大小 | 虚拟区间mmu映射属性 | 已使用的物理页数量（包括共享内存部分 | 已使用的物理页数量
 
@@ -507,6 +524,7 @@ VOID OsVmPhysDump(VOID)
     UINT32 totalFreePages = 0;
     UINT32 totalPages = 0;
     UINT32 segIndex;
+    UINT32 gen;
 
     for (segIndex = 0; segIndex < g_vmPhysSegNum; segIndex++) {//循环取段
         seg = &g_vmPhysSeg[segIndex];
@@ -522,12 +540,19 @@ VOID OsVmPhysDump(VOID)
 
             PRINTK("active   anon   %d\n", seg->lruSize[VM_LRU_ACTIVE_ANON]);
             PRINTK("inactive anon   %d\n", seg->lruSize[VM_LRU_INACTIVE_ANON]);
-            PRINTK("active   file   %d\n", seg->lruSize[VM_LRU_ACTIVE_FILE]);
-            PRINTK("inactice file   %d\n", seg->lruSize[VM_LRU_INACTIVE_FILE]);
+            for (gen = seg->minSeq; gen != seg->maxSeq + 1; gen++) {//文件页从老到新逐代打印
+                PRINTK("file gen %-6u %d\n", gen, seg->genSize[VM_LRU_GEN(gen)]);
+            }
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+            OsVmCompactDump(seg);
+#endif
         }
     }
     PRINTK("\n\rpmm pages: total = %u, used = %u, free = %u\n",
            totalPages, (totalPages - totalFreePages), totalFreePages);
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    OsVmZramDump();
+#endif
 }
 //获取物理内存的使用信息，两个参数接走数据
 VOID OsVmPhysUsedInfoGet(UINT32 *usedCount, UINT32 *totalCount)
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "los_vm_event.h"
+#include "los_vm_common.h"
+#include "los_printf.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+LosVmEventCpu g_vmEvents[LOSCFG_KERNEL_CORE_NUM];
+
+STATIC const CHAR *g_vmEventNames[VM_EVENT_NR_ITEMS] = {
+    "fault_read",
+    "fault_cow",
+    "fault_shared",
+    "pgcache_hit",
+    "pgcache_miss",
+    "reclaim_scan",
+    "reclaim_steal",
+    "page_alloc",
+    "page_free",
+};
+//把各核的计数加起来,取前 count 项
+VOID OsVmEventSnapshot(UINT32 *events, UINT32 count)
+{
+    UINT32 cpuid;
+    UINT32 item;
+
+    count = MIN2(count, VM_EVENT_NR_ITEMS);
+    for (item = 0; item < count; item++) {
+        events[item] = 0;
+        for (cpuid = 0; cpuid < LOSCFG_KERNEL_CORE_NUM; cpuid++) {
+            events[item] += g_vmEvents[cpuid].events[item];
+        }
+    }
+}
+//vmm -e 打印内存事件计数
+VOID OsVmEventDump(VOID)
+{
+    UINT32 events[VM_EVENT_NR_ITEMS];
+    UINT32 item;
+
+    OsVmEventSnapshot(events, VM_EVENT_NR_ITEMS);
+    for (item = 0; item < VM_EVENT_NR_ITEMS; item++) {
+        PRINTK("%-16s %u\n", g_vmEventNames[item], events[item]);
+    }
+}
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
@@ -38,7 +38,16 @@
 #include "los_vm_dump.h"
 #include "los_vm_filemap.h"
 #include "los_vm_page.h"
+#include "los_vm_phys.h"
 #include "los_vm_lock.h"
+#include "los_vm_shm_pri.h"
+#include "los_vm_event.h"
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+#include "los_vm_zram.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
 #include "los_exc.h"
 #include "los_oom.h"
 #include "los_printf.h"
@@ -103,6 +112,74 @@ STATIC VOID OsFaultTryFixup(ExcContext *frame, VADDR_T excVaddr, STATUS_T *statu
 }
 
 #ifdef LOSCFG_FS_VFS 
+#define VM_FAULT_AROUND_PAGES   16  /* aligned 64KB window around a read fault */
+
+/**************************************************************************************************
+ 把 [start, end) 中已在页高速缓存、未被锁且尚未映射的文件页只读映射进来,跳过 skipVaddr,区间不超过一个窗口.
+ 先收集候选页,再按虚拟/物理都连续的段一次性填写页表,映射失败时只放弃剩余的页.
+**************************************************************************************************/
+STATIC VOID OsFileMapCached(LosVmMapRegion *region, VADDR_T start, VADDR_T end, VADDR_T skipVaddr)
+{
+    UINT32 intSave;
+    UINT32 nPages = 0;
+    UINT32 run;
+    VADDR_T vaddr;
+    VM_OFFSET_T pgoff;
+    LosFilePage *fpage = NULL;
+    LosFilePage *fpages[VM_FAULT_AROUND_PAGES];
+    VADDR_T vaddrs[VM_FAULT_AROUND_PAGES];
+    LosArchMmu *archMmu = &region->space->archMmu;
+    struct page_mapping *mapping = region->unTypeData.rf.file->f_mapping;
+    UINT32 archFlags = region->regionFlags & (~VM_MAP_REGION_FLAG_PERM_WRITE);
+
+    LOS_SpinLockSave(&mapping->list_lock, &intSave);
+    for (vaddr = start; (vaddr < end) && (nPages < VM_FAULT_AROUND_PAGES); vaddr += PAGE_SIZE) {
+        if ((vaddr == skipVaddr) || (LOS_ArchMmuQuery(archMmu, vaddr, NULL, NULL) == LOS_OK)) {
+            continue;
+        }
+        pgoff = ((vaddr - region->range.base) >> PAGE_SHIFT) + region->pgOff;
+        fpage = OsFindGetEntry(mapping, pgoff);
+        if ((fpage == NULL) || OsIsPageLocked(fpage->vmPage)) {//不在缓存或正在被读写的页不处理
+            continue;
+        }
+        fpages[nPages] = fpage;
+        vaddrs[nPages] = vaddr;
+        nPages++;
+    }
+
+    for (UINT32 i = 0; i < nPages; i += run) {
+        for (run = 1; (i + run) < nPages; run++) {//虚拟地址和物理地址都连续的页合并成一次映射
+            if ((vaddrs[i + run] != (vaddrs[i] + (run << PAGE_SHIFT))) ||
+                (fpages[i + run]->vmPage->physAddr != (fpages[i]->vmPage->physAddr + (run << PAGE_SHIFT)))) {
+                break;
+            }
+        }
+        if (LOS_ArchMmuMap(archMmu, vaddrs[i], fpages[i]->vmPage->physAddr, run, archFlags) < 0) {
+            break;
+        }
+        for (UINT32 j = i; j < (i + run); j++) {//与 OsVmmFileFault 中单页缺页的记账保持一致
+            OsPageRefIncLocked(fpages[j]);
+            OsAddMapInfo(fpages[j], archMmu, vaddrs[j]);
+            OsFilePageFlagsSet(fpages[j], region->regionFlags);
+            LOS_AtomicInc(&fpages[j]->vmPage->refCounts);
+        }
+    }
+    LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+}
+//读缺页时顺带映射周围的文件页(fault-around),如ELF代码段逐页执行时不必每页缺一次
+STATIC VOID OsFaultAround(LosVmMapRegion *region, VADDR_T faultVaddr)
+{
+    VADDR_T start = ROUNDDOWN(faultVaddr, VM_FAULT_AROUND_PAGES << PAGE_SHIFT);
+    VADDR_T end = start + (VM_FAULT_AROUND_PAGES << PAGE_SHIFT);
+
+    if (start < region->range.base) {
+        start = region->range.base;
+    }
+    end = MIN2(end, region->range.base + region->range.size);
+
+    OsFileMapCached(region, start, end, faultVaddr);
+}
+
 //读页时发生缺页的处理
 STATIC STATUS_T OsDoReadFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)//读缺页
 {
@@ -116,6 +193,7 @@ STATIC STATUS_T OsDoReadFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)//
     if (ret == LOS_OK) {//注意这里时LOS_OK却返回,都OK了说明查到了物理地址,有页了。
         return LOS_OK;//查到了就说明不缺页的，缺页就是因为虚拟地址没有映射到物理地址嘛
     }
+    OsVmEventInc(VM_EVENT_FAULT_READ);
     if (region->unTypeData.rf.vmFOps == NULL || region->unTypeData.rf.vmFOps->fault == NULL) {//线性区必须有实现了缺页接口
         VM_ERR("region args invalid, file path: %s", region->unTypeData.rf.file->f_path);
         return LOS_ERRNO_VM_INVALID_ARGS;
@@ -139,6 +217,7 @@ STATIC STATUS_T OsDoReadFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)//
             return LOS_ERRNO_VM_NO_MEMORY;
         }
 
+        OsFaultAround(region, vaddr);//顺带映射周围已缓存的页
         (VOID)LOS_MuxRelease(&region->unTypeData.rf.file->f_mapping->mux_lock);
         return LOS_OK;
     }
@@ -191,6 +270,7 @@ status_t OsDoCowFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)
         VM_ERR("region args invalid");
         return LOS_ERRNO_VM_INVALID_ARGS;
     }
+    OsVmEventInc(VM_EVENT_FAULT_COW);
 
     space = region->space;
     ret = LOS_ArchMmuQuery(&space->archMmu, (VADDR_T)vmPgFault->vaddr, &oldPaddr, NULL);//查询出老物理地址
@@ -204,6 +284,12 @@ status_t OsDoCowFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)
         ret = LOS_ERRNO_VM_NO_MEMORY;
         goto ERR_OUT;
     }
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    ret = OsVmPageCharge(space, newPage, TRUE);//私有副本记到本进程名下,超限且回收不够则按无内存处理
+    if (ret != LOS_OK) {
+        goto ERR_OUT;
+    }
+#endif
 
     newPaddr = VM_PAGE_TO_PHYS(newPage);//拿到新的物理地址
     kvaddr = OsVmPageToVaddr(newPage);//拿到新的虚拟地址
@@ -222,7 +308,7 @@ status_t OsDoCowFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)
      * we can take it as a anonymous cow map.
      */
     if ((oldPaddr == 0) || (LOS_PaddrToKVaddr(oldPaddr) == vmPgFault->pageKVaddr)) {//没有映射或者 已在pagecache有映射
-        (VOID)memcpy_s(kvaddr, PAGE_SIZE, vmPgFault->pageKVaddr, PAGE_SIZE);//直接copy到新页
+        OsPhysPageCopy(kvaddr, vmPgFault->pageKVaddr);//直接copy到新页
         LOS_AtomicInc(&newPage->refCounts);//引用ref++
         OsCleanPageLocked(LOS_VmPageGet(LOS_PaddrQuery(vmPgFault->pageKVaddr)));//解锁
     } else {
@@ -274,6 +360,7 @@ status_t OsDoSharedFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault)
         VM_ERR("region args invalid");
         return LOS_ERRNO_VM_INVALID_ARGS;
     }
+    OsVmEventInc(VM_EVENT_FAULT_SHARED);
 
     ret = LOS_ArchMmuQuery(&space->archMmu, vmPgFault->vaddr, &paddr, NULL);//查询物理地址
     if (ret == LOS_OK) {
@@ -342,21 +429,39 @@ STATIC STATUS_T OsDoFileFault(LosVmMapRegion *region, LosVmPgFault *vmPgFault, U
     }
     return ret;
 }
+/* 放开 regionMux 期间线性区没有被 munmap/mprotect/mremap 改动过 */
+STATIC BOOL OsFaultRegionUnchanged(const LosVmMapRegion *region, const LosVmMapRegion *snap)
+{
+    return (region != NULL) && (region->range.base == snap->range.base) &&
+           (region->range.size == snap->range.size) && (region->regionFlags == snap->regionFlags) &&
+           (region->regionType == snap->regionType) && (region->pgOff == snap->pgOff) &&
+           (region->unTypeData.rf.file == snap->unTypeData.rf.file);
+}
 /***************************************************************
 缺页中断处理程序
 通常有两种情况导致
 第一种:由编程错误引起的异常
 第二种:属于进程的地址空间范围但还尚未分配物理页框引起的异常
+space->regionMux 只在查找线性区和填写页表时持有,分配清零物理页和读文件都在锁外进行,
+同一进程的多个线程缺页不再互相排队,也不会因为等设备而挡住 mmap/munmap.
 ***************************************************************/
 STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame)
 {
     LosVmSpace *space = LOS_SpaceGet(vaddr);//获取虚拟地址所属空间
     LosVmMapRegion *region = NULL;
+    LosVmMapRegion snap;
     STATUS_T status;
     PADDR_T oldPaddr;
     PADDR_T newPaddr;
     VADDR_T excVaddr = vaddr;
     LosVmPage *newPage = NULL;
+    BOOL mapped = FALSE;
+#ifdef LOSCFG_FS_VFS
+    UINT32 nPages = 0;
+    VM_OFFSET_T raStart = 0;
+    BOOL dirtied = FALSE;
+    LosFilePin pin = { 0 };
+#endif
     LosVmPgFault vmPgFault = { 0 };
 
     if (space == NULL) {
@@ -371,6 +476,7 @@ STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame)
         return LOS_ERRNO_VM_ACCESS_DENIED;//拒绝访问
     }
 
+    vaddr = ROUNDDOWN(vaddr, PAGE_SIZE);//为啥要向下圆整，因为这一页要重新使用，需找到页面基地址
     (VOID)LOS_MuxAcquire(&space->regionMux);
     region = LOS_RegionFind(space, vaddr);//通过虚拟地址找到所在线性区
     if (region == NULL) {
@@ -395,12 +501,59 @@ STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame)
         goto CHECK_FAILED;
     }
 
-    vaddr = ROUNDDOWN(vaddr, PAGE_SIZE);//为啥要向下圆整，因为这一页要重新使用，需找到页面基地址
-#ifdef LOSCFG_FS_VFS 
+    snap = *region;//记下线性区,重新持锁后用来判断是否被改动
+#ifdef LOSCFG_FS_VFS
     if (LOS_IsRegionFileValid(region)) {//是否为文件线性区
         if (region->unTypeData.rf.file->f_mapping == NULL) {
             goto  CHECK_FAILED;
         }
+        nPages = OsFileFaultReadaheadWindow(region, ((vaddr - region->range.base) >> PAGE_SHIFT) + region->pgOff,
+                                            &raStart);//顺序缺页时一次读入后续多页
+        if (nPages != 0) {
+            OsFileMappingPin(region->unTypeData.rf.file, &pin);//锁外读设备期间映射不能被释放
+        }
+    } else
+#endif
+    {
+        mapped = (LOS_ArchMmuQuery(&space->archMmu, vaddr, NULL, NULL) == LOS_OK);
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+        if (!mapped && (LOS_ArchMmuSwapEntryGet(&space->archMmu, vaddr, NULL) == LOS_OK)) {//页被换出到压缩交换区,解压换回
+            status = OsVmZramSwapIn(&space->archMmu, vaddr, region->regionFlags);
+            if (status != LOS_OK) {
+                goto CHECK_FAILED;
+            }
+            goto DONE;
+        }
+#endif
+    }
+    (VOID)LOS_MuxRelease(&space->regionMux);
+
+    /* slow part without regionMux: page cache fill from the device, page allocation and zeroing */
+#ifdef LOSCFG_FS_VFS
+    if (LOS_IsRegionFileValid(&snap)) {
+        OsPageCacheReadaheadPinned(&pin, raStart, nPages);
+    } else
+#endif
+    {
+        newPage = LOS_PhysPageAlloc();//请求调页:推迟到不能再推迟为止
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+        if ((newPage != NULL) && (OsVmPageCharge(space, newPage, TRUE) != LOS_OK)) {//超出进程上限,本次缺页失败
+            LOS_PhysPageFree(newPage);
+            newPage = NULL;
+        }
+#endif
+        if ((newPage != NULL) && !mapped) {//写时拷贝的页稍后会被整页覆盖,无需清0
+            OsPhysPageZero(OsVmPageToVaddr(newPage));
+        }
+    }
+
+    (VOID)LOS_MuxAcquire(&space->regionMux);
+    region = LOS_RegionFind(space, vaddr);
+    if (!OsFaultRegionUnchanged(region, &snap)) {//锁外期间线性区变了,放弃本次缺页,重新访问时按新布局处理
+        goto FAULT_RETRY;
+    }
+#ifdef LOSCFG_FS_VFS
+    if (LOS_IsRegionFileValid(region)) {//页通常已在页高速缓存,这里只剩填写页表
         vmPgFault.vaddr = vaddr;//虚拟地址
         vmPgFault.pgoff = ((vaddr - region->range.base) >> PAGE_SHIFT) + region->pgOff;//计算出文件读取位置
         vmPgFault.flags = flags;
@@ -411,20 +564,21 @@ STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame)
             VM_ERR("vm fault error, status=%d", status);
             goto CHECK_FAILED;
         }
+        dirtied = ((flags & VM_MAP_PF_FLAG_WRITE) != 0);//写缺页会把文件页标脏
         goto DONE;
     }
 #endif
-	//请求调页:推迟到不能再推迟为止
-    newPage = LOS_PhysPageAlloc();//分配一个新的物理页
     if (newPage == NULL) {
         status = LOS_ERRNO_VM_NO_MEMORY;
         goto CHECK_FAILED;
     }
 
     newPaddr = VM_PAGE_TO_PHYS(newPage);//获取物理地址
-    (VOID)memset_s(OsVmPageToVaddr(newPage), PAGE_SIZE, 0, PAGE_SIZE);//获取虚拟地址 清0
     status = LOS_ArchMmuQuery(&space->archMmu, vaddr, &oldPaddr, NULL);//通过虚拟地址查询老物理地址
-    if (status >= 0) {//已经映射过了,@note_thinking 不是缺页吗,怎么会有页的情况? 
+    if ((status >= 0) && !mapped) {//同进程的其他线程已经为这一页缺过页了
+        goto FAULT_RETRY;
+    }
+    if (status >= 0) {//已经映射过了,写时拷贝的情况
         LOS_ArchMmuUnmap(&space->archMmu, vaddr, 1);//解除映射关系
         OsPhysSharePageCopy(oldPaddr, &newPaddr, newPage);//将oldPaddr的数据拷贝到newPage
         /* use old page free the new one */
@@ -444,6 +598,14 @@ STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame)
         status = LOS_OK;
         goto DONE;
     } else {//
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+        if (LOS_ArchMmuSwapEntryGet(&space->archMmu, vaddr, NULL) == LOS_OK) {//锁外期间页被换出,重新访问时换回
+            goto FAULT_RETRY;
+        }
+#endif
+        if (mapped) {//锁外期间原映射已被解除,按全新的页处理
+            OsPhysPageZero(OsVmPageToVaddr(newPage));
+        }
         /* map all of the pages */
         LOS_AtomicInc(&newPage->refCounts);//引用数自增
         status = LOS_ArchMmuMap(&space->archMmu, vaddr, newPaddr, 1, region->regionFlags);//映射新物理地址,如此下次就不会缺页了
@@ -454,6 +616,12 @@ STATUS_T OsVmPageFaultHandler(VADDR_T vaddr, UINT32 flags, ExcContext *frame)
         }
     }
 
+    status = LOS_OK;
+    goto DONE;
+FAULT_RETRY:
+    if (newPage != NULL) {
+        LOS_PhysPageFree(newPage);
+    }
     status = LOS_OK;
     goto DONE;
 VMM_MAP_FAILED:
@@ -464,9 +632,212 @@ CHECK_FAILED:
     OsFaultTryFixup(frame, excVaddr, &status);
 DONE:
     (VOID)LOS_MuxRelease(&space->regionMux);
+#ifdef LOSCFG_FS_VFS
+    if (dirtied) {
+        OsWritebackThrottle();
+    }
+#endif
     return status;
 }
 
+#define VM_POPULATE_PAGES   16  /* 64KB window, a fully empty one is mapped as one large page */
+
+//窗口内的页是否都还没有映射
+STATIC BOOL OsPopulateWindowEmpty(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 count)
+{
+    UINT32 index;
+
+    for (index = 0; index < count; index++) {
+        if (LOS_ArchMmuQuery(archMmu, vaddr + (index << PAGE_SHIFT), NULL, NULL) == LOS_OK) {
+            return FALSE;
+        }
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+        if (LOS_ArchMmuSwapEntryGet(archMmu, vaddr + (index << PAGE_SHIFT), NULL) == LOS_OK) {
+            return FALSE;
+        }
+#endif
+    }
+    return TRUE;
+}
+/**************************************************************************************************
+ 为匿名线性区的 [vaddr, end) 预先申请清0的页并填写页表,调用者持有 regionMux
+ 按64K窗口处理,整窗都未映射时申请一个64K连续块,一次映射成大页;其余零散的页一页页补上.
+**************************************************************************************************/
+STATIC STATUS_T OsAnonPopulate(LosVmMapRegion *region, VADDR_T vaddr, VADDR_T end)
+{
+    LosArchMmu *archMmu = &region->space->archMmu;
+    LosVmPage *page = NULL;
+    VOID *kvaddr = NULL;
+    VADDR_T next;
+    UINT32 index;
+
+    for (; vaddr < end; vaddr = next) {
+        next = MIN2(ROUNDDOWN(vaddr, VM_POPULATE_PAGES << PAGE_SHIFT) + (VM_POPULATE_PAGES << PAGE_SHIFT), end);
+        if (((next - vaddr) == (VM_POPULATE_PAGES << PAGE_SHIFT)) &&
+            OsPopulateWindowEmpty(archMmu, vaddr, VM_POPULATE_PAGES)) {
+            kvaddr = LOS_PhysPagesAllocContiguous(VM_POPULATE_PAGES);
+            if (kvaddr != NULL) {
+                for (index = 0; index < VM_POPULATE_PAGES; index++) {
+                    OsPhysPageZero((CHAR *)kvaddr + (index << PAGE_SHIFT));
+                }
+                page = OsVmVaddrToPage(kvaddr);
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+                for (index = 0; index < VM_POPULATE_PAGES; index++) {//逐页记账,释放连续块时已记的页一并退费
+                    if (OsVmPageCharge(region->space, &page[index], TRUE) != LOS_OK) {
+                        LOS_PhysPagesFreeContiguous(kvaddr, VM_POPULATE_PAGES);
+                        return LOS_ERRNO_VM_NO_MEMORY;
+                    }
+                }
+#endif
+                for (index = 0; index < VM_POPULATE_PAGES; index++) {//页框各自计数,以后可以单页释放
+                    LOS_AtomicSet(&page[index].refCounts, 1);
+                }
+                if (LOS_ArchMmuMap(archMmu, vaddr, page->physAddr, VM_POPULATE_PAGES, region->regionFlags) < 0) {
+                    for (index = 0; index < VM_POPULATE_PAGES; index++) {
+                        LOS_AtomicSet(&page[index].refCounts, 0);
+                    }
+                    LOS_PhysPagesFreeContiguous(kvaddr, VM_POPULATE_PAGES);
+                    return LOS_ERRNO_VM_MAP_FAILED;
+                }
+                continue;
+            }
+        }
+
+        for (; vaddr < next; vaddr += PAGE_SIZE) {
+            if (LOS_ArchMmuQuery(archMmu, vaddr, NULL, NULL) == LOS_OK) {
+                continue;
+            }
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+            if (LOS_ArchMmuSwapEntryGet(archMmu, vaddr, NULL) == LOS_OK) {//换出的页换回,内容不能丢
+                if (OsVmZramSwapIn(archMmu, vaddr, region->regionFlags) != LOS_OK) {
+                    return LOS_ERRNO_VM_NO_MEMORY;
+                }
+                continue;
+            }
+#endif
+            page = LOS_PhysPageAlloc();
+            if (page == NULL) {
+                return LOS_ERRNO_VM_NO_MEMORY;
+            }
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+            if (OsVmPageCharge(region->space, page, TRUE) != LOS_OK) {
+                LOS_PhysPageFree(page);
+                return LOS_ERRNO_VM_NO_MEMORY;
+            }
+#endif
+            OsPhysPageZero(OsVmPageToVaddr(page));
+            LOS_AtomicInc(&page->refCounts);
+            if (LOS_ArchMmuMap(archMmu, vaddr, page->physAddr, 1, region->regionFlags) < 0) {
+                LOS_PhysPageFree(page);
+                return LOS_ERRNO_VM_MAP_FAILED;
+            }
+        }
+    }
+    return LOS_OK;
+}
+
+#ifdef LOSCFG_FS_VFS
+/**************************************************************************************************
+ 文件线性区预先缺页:每次先放开 regionMux 把一个最大预读窗口读入页高速缓存,再持锁按窗口只读映射.
+ 锁外期间线性区被改动时放弃剩下的部分,交给以后的缺页处理.
+ pin 为调用者持锁时 OsFileMappingPin 钉住的文件,每个窗口读完释放,放锁前再为下一个窗口钉住.
+**************************************************************************************************/
+STATIC VOID OsFilePopulate(LosVmSpace *space, struct file *filp, LosFilePin *pin,
+                           VM_OFFSET_T pgoff, VADDR_T vaddr, VADDR_T end)
+{
+    LosVmMapRegion *region = NULL;
+    UINT32 nPages;
+    VADDR_T next;
+
+    while (vaddr < end) {
+        nPages = MIN2((end - vaddr) >> PAGE_SHIFT, VM_FILEMAP_RA_MAX_PAGES);
+        OsPageCacheReadaheadPinned(pin, pgoff, nPages);
+
+        (VOID)LOS_MuxAcquire(&space->regionMux);
+        region = LOS_RegionFind(space, vaddr);
+        if ((region == NULL) || !LOS_IsRegionFileValid(region) || (region->unTypeData.rf.file != filp)) {
+            (VOID)LOS_MuxRelease(&space->regionMux);
+            return;
+        }
+        next = MIN2(vaddr + (nPages << PAGE_SHIFT), region->range.base + region->range.size);
+        for (; vaddr < next; vaddr += VM_FAULT_AROUND_PAGES << PAGE_SHIFT) {
+            OsFileMapCached(region, vaddr, MIN2(vaddr + (VM_FAULT_AROUND_PAGES << PAGE_SHIFT), next), 0);
+        }
+        vaddr = next;
+        if (vaddr < end) {
+            OsFileMappingPin(filp, pin);
+        }
+        (VOID)LOS_MuxRelease(&space->regionMux);
+        pgoff += nPages;
+    }
+}
+#endif
+//找到 vaddr 所在的线性区,vaddr 落在空洞中时取它之后的第一个线性区
+STATIC LosVmMapRegion *OsPopulateRegionGet(LosVmSpace *space, VADDR_T vaddr)
+{
+    LosVmMapRange rangeKey;
+    LosVmMapRegion *region = LOS_RegionFind(space, vaddr);
+
+    if (region != NULL) {
+        return region;
+    }
+    rangeKey.base = vaddr;
+    rangeKey.size = 1;
+    return (LosVmMapRegion *)LOS_RbGetNextNode(&space->regionRbTree, (VOID *)&rangeKey);
+}
+/**************************************************************************************************
+ 为 [vaddr, vaddr + size) 中的线性区预先缺页,MAP_POPULATE 和 mlock 使用,区间中的空洞直接跳过.
+ 调用者不能持有 regionMux,文件页读设备时会放开它.共享内存和设备线性区映射时已经建好页表,不用处理.
+ 文件页只读映射,私有可写的文件页第一次写时仍要写时拷贝.
+**************************************************************************************************/
+STATUS_T OsVmPopulate(LosVmSpace *space, VADDR_T vaddr, size_t size)
+{
+    LosVmMapRegion *region = NULL;
+    VADDR_T end = vaddr + size;
+    VADDR_T next;
+    STATUS_T ret = LOS_OK;
+#ifdef LOSCFG_FS_VFS
+    struct file *filp = NULL;
+    LosFilePin pin = { 0 };
+    VM_OFFSET_T pgoff = 0;
+#endif
+
+    while ((vaddr < end) && (ret == LOS_OK)) {
+        (VOID)LOS_MuxAcquire(&space->regionMux);
+        region = OsPopulateRegionGet(space, vaddr);
+        if ((region == NULL) || (region->range.base >= end)) {
+            (VOID)LOS_MuxRelease(&space->regionMux);
+            break;
+        }
+        if (vaddr < region->range.base) {
+            vaddr = region->range.base;
+        }
+        next = MIN2(region->range.base + region->range.size, end);
+#ifdef LOSCFG_FS_VFS
+        filp = NULL;
+        if (LOS_IsRegionFileValid(region)) {
+            if (region->unTypeData.rf.file->f_mapping != NULL) {
+                filp = region->unTypeData.rf.file;
+                pgoff = ((vaddr - region->range.base) >> PAGE_SHIFT) + region->pgOff;
+                OsFileMappingPin(filp, &pin);//锁外读设备期间映射不能被释放
+            }
+        } else
+#endif
+        if (!OsIsShmRegion(region) && !LOS_IsRegionTypeDev(region)) {
+            ret = OsAnonPopulate(region, vaddr, next);
+        }
+        (VOID)LOS_MuxRelease(&space->regionMux);
+#ifdef LOSCFG_FS_VFS
+        if (filp != NULL) {
+            OsFilePopulate(space, filp, &pin, pgoff, vaddr, next);
+        }
+#endif
+        vaddr = next;
+    }
+
+    return ret;
+}
+
 #ifdef __cplusplus
 #if __cplusplus
 }
@@ -39,7 +39,13 @@
 #include "los_vm_phys.h"
 #include "los_vm_common.h"
 #include "los_vm_fault.h"
+#include "los_vm_event.h"
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
 #include "los_process_pri.h"
+#include "fs/fs.h"
+#include "fs/fs_operation.h"
 #include "inode/inode.h"
 #include "los_vm_lock.h"
 
@@ -71,11 +77,11 @@ STATIC VOID OsPageCacheAdd(LosFilePage *page, struct page_mapping *mapping, VM_O
 done_add:
     mapping->nrpages++;	//文件在缓存中多了一个 文件页
 }
-//将页面加到活动文件页LRU链表上
+//将页面加到最年轻一代的LRU链表上
 VOID OsAddToPageacheLru(LosFilePage *page, struct page_mapping *mapping, VM_OFFSET_T pgoff)
 {
     OsPageCacheAdd(page, mapping, pgoff);
-    OsLruCacheAdd(page, VM_LRU_ACTIVE_FILE);
+    OsLruCacheAdd(page);
 }
 //从页高速缓存上删除页
 VOID OsPageCacheDel(LosFilePage *fpage)
@@ -136,6 +142,289 @@ VOID OsDeletePageCacheLru(LosFilePage *page)
     /* delete from cache lits and free pmm if need */
     OsPageCacheDel(page); //从page缓存中删除
 }
+
+/* readahead states of read() path, one per entry of the system file table tg_filelist */
+typedef struct {
+    struct page_mapping     *mapping;   /* mapping the state was built for, NULL after open/close */
+    LosFileReadahead        ra;
+} FileReadaheadState;
+
+STATIC FileReadaheadState g_fileRaStates[CONFIG_NFILE_DESCRIPTORS];
+STATIC SPIN_LOCK_INIT(g_fileRaSpin);
+
+VOID OsFileReadaheadInit(LosFileReadahead *ra, UINT32 mode)
+{
+    ra->start = 0;
+    ra->size = 0;
+    ra->mode = mode;
+    ra->prevPgoff = 0;
+}
+//由系统文件表中的位置找到预读状态,不在 tg_filelist 中的 file 没有预读状态
+STATIC FileReadaheadState *OsFileReadaheadState(struct file *filp)
+{
+    if ((filp < &tg_filelist.fl_files[0]) || (filp >= &tg_filelist.fl_files[CONFIG_NFILE_DESCRIPTORS])) {
+        return NULL;
+    }
+    return &g_fileRaStates[filp - &tg_filelist.fl_files[0]];
+}
+//取文件对应的预读状态,文件换了映射时重新初始化,调用者持有 g_fileRaSpin
+STATIC LosFileReadahead *OsFileReadaheadGet(struct file *filp)
+{
+    FileReadaheadState *state = OsFileReadaheadState(filp);
+
+    if (state == NULL) {
+        return NULL;
+    }
+    if (state->mapping != filp->f_mapping) {
+        state->mapping = filp->f_mapping;
+        OsFileReadaheadInit(&state->ra, FILE_RA_NORMAL);
+    }
+    return &state->ra;
+}
+//设置文件的预读模式, posix_fadvise 使用
+VOID OsFileReadaheadModeSet(struct file *filp, UINT32 mode)
+{
+    UINT32 intSave;
+    LosFileReadahead *ra = NULL;
+
+    LOS_SpinLockSave(&g_fileRaSpin, &intSave);
+    ra = OsFileReadaheadGet(filp);
+    if (ra != NULL) {
+        OsFileReadaheadInit(ra, mode);
+    }
+    LOS_SpinUnlockRestore(&g_fileRaSpin, intSave);
+}
+//打开和关闭文件时清除预读状态,同一表项的下一个打开者不会继承窗口和 posix_fadvise 模式
+VOID OsFileReadaheadReset(struct file *filp)
+{
+    UINT32 intSave;
+    FileReadaheadState *state = OsFileReadaheadState(filp);
+
+    if (state == NULL) {
+        return;
+    }
+    LOS_SpinLockSave(&g_fileRaSpin, &intSave);
+    state->mapping = NULL;
+    OsFileReadaheadInit(&state->ra, FILE_RA_NORMAL);
+    LOS_SpinUnlockRestore(&g_fileRaSpin, intSave);
+}
+/**************************************************************************************************
+ 根据本次访问的页更新预读窗口,返回需要预读的页数,起始页由 start 带回
+ 1.非顺序访问:窗口清零,不预读
+ 2.缺页或窗口为空:以当前页为起点开启新窗口,大小翻倍
+ 3.读者越过窗口中点:在窗口之后提前预读下一个窗口,读者不会再等待设备
+**************************************************************************************************/
+STATIC UINT32 OsFileReadaheadWindow(LosFileReadahead *ra, VM_OFFSET_T pgoff, BOOL miss, VM_OFFSET_T *start)
+{
+    BOOL sequential;
+    UINT32 size;
+
+    if (ra->mode == FILE_RA_RANDOM) {
+        return 0;
+    }
+
+    sequential = (ra->mode == FILE_RA_SEQUENTIAL) || (pgoff == 0) ||
+                 (pgoff == ra->prevPgoff) || (pgoff == (ra->prevPgoff + 1));
+    ra->prevPgoff = pgoff;
+    if (!sequential) {
+        ra->start = pgoff;
+        ra->size = 0;
+        return 0;
+    }
+
+    if (miss || (ra->size == 0) || (pgoff < ra->start) || (pgoff >= (ra->start + ra->size))) {
+        size = (ra->size == 0) ? VM_FILEMAP_RA_MIN_PAGES : (ra->size << 1);
+        ra->start = pgoff;
+    } else if (pgoff >= (ra->start + (ra->size >> 1))) {
+        size = ra->size << 1;
+        ra->start += ra->size;
+    } else {
+        return 0;
+    }
+
+    if ((ra->mode == FILE_RA_SEQUENTIAL) || (size > VM_FILEMAP_RA_MAX_PAGES)) {
+        size = VM_FILEMAP_RA_MAX_PAGES;
+    }
+    ra->size = size;
+    *start = ra->start;
+    return size;
+}
+/**************************************************************************************************
+ 一次设备读把 [pgoff, pgoff + nPages) 读入 buf,返回读到的字节数
+ 预读和用户的 read/lseek 并发,不能借用户文件的 f_pos 定位,在文件的一份私有副本上按偏移读.
+**************************************************************************************************/
+STATIC INT32 OsPageCacheReadChunk(const struct file *filp, VM_OFFSET_T pgoff, UINT32 nPages, VOID *buf)
+{
+    struct file raFile;
+
+    if ((memcpy_s(&raFile, sizeof(struct file), filp, sizeof(struct file)) != EOK) || (raFile.f_inode == NULL)) {
+        return -EBADF;
+    }
+    raFile.f_pos = pgoff << PAGE_SHIFT;
+    if (raFile.f_inode->u.i_mops->readpage) {
+        return raFile.f_inode->u.i_mops->readpage(&raFile, (char *)buf, nPages << PAGE_SHIFT);
+    }
+    return file_read(&raFile, buf, nPages << PAGE_SHIFT);
+}
+/**************************************************************************************************
+ 预读文件 [start, start + nPages) 中不在页高速缓存的页到 mapping,调用者不能持有 mapping->list_lock
+ 连续缺失的页合并成一次最多 VM_FILEMAP_RA_CHUNK_PAGES 页的设备读,读完再拆分到各文件页中.
+ 设备读都按偏移在 filp 的副本上进行,filp 可以是调用者持锁时保存的文件快照.
+ 预读只是优化,内存不足或读失败时直接返回,由后续的按页读兜底.
+**************************************************************************************************/
+STATIC VOID OsMappingReadRange(const struct file *filp, struct page_mapping *mapping,
+                               VM_OFFSET_T start, UINT32 nPages)
+{
+    UINT32 intSave;
+    UINT32 run;
+    INT32 readSize;
+    INT32 copySize;
+    BOOL noMem = FALSE;
+    VOID *buf = NULL;
+    LosFilePage *fpage = NULL;
+    VM_OFFSET_T pgoff = start;
+    VM_OFFSET_T end = start + nPages;
+
+    while (pgoff < end) {
+        LOS_SpinLockSave(&mapping->list_lock, &intSave);
+        while ((pgoff < end) && (OsFindGetEntry(mapping, pgoff) != NULL)) {//跳过已缓存的页
+            pgoff++;
+        }
+        for (run = 0; ((pgoff + run) < end) && (run < VM_FILEMAP_RA_CHUNK_PAGES); run++) {
+            if (OsFindGetEntry(mapping, pgoff + run) != NULL) {
+                break;
+            }
+        }
+        LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+        if (run == 0) {
+            break;
+        }
+
+        if (buf == NULL) {
+            buf = LOS_PhysPagesAllocContiguous(VM_FILEMAP_RA_CHUNK_PAGES);
+            if (buf == NULL) {
+                return;
+            }
+        }
+
+        readSize = OsPageCacheReadChunk(filp, pgoff, run, buf);
+        if (readSize <= 0) {
+            break;
+        }
+
+        LOS_SpinLockSave(&mapping->list_lock, &intSave);
+        for (UINT32 i = 0; (i < run) && ((INT32)(i << PAGE_SHIFT) < readSize); i++) {
+            if (OsFindGetEntry(mapping, pgoff + i) != NULL) {//读盘期间已被别人缓存
+                continue;
+            }
+            fpage = OsPageCacheAlloc(mapping, pgoff + i);
+            if (fpage == NULL) {
+                noMem = TRUE;
+                break;
+            }
+            copySize = MIN2(PAGE_SIZE, readSize - (INT32)(i << PAGE_SHIFT));
+            (VOID)memcpy_s(OsVmPageToVaddr(fpage->vmPage), PAGE_SIZE, (CHAR *)buf + (i << PAGE_SHIFT), copySize);
+            OsAddToPageacheLru(fpage, mapping, pgoff + i);
+        }
+        LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+
+        if (noMem || (readSize < (INT32)(run << PAGE_SHIFT))) {//内存不足或到达文件末尾
+            break;
+        }
+        pgoff += run;
+    }
+
+    if (buf != NULL) {
+        LOS_PhysPagesFreeContiguous(buf, VM_FILEMAP_RA_CHUNK_PAGES);
+    }
+}
+//预读打开着的文件,调用者持有文件描述符
+VOID OsPageCacheReadahead(struct file *filp, VM_OFFSET_T start, UINT32 nPages)
+{
+    struct page_mapping *mapping = filp->f_mapping;
+
+    if (mapping != NULL) {
+        OsMappingReadRange(filp, mapping, start, nPages);
+    }
+}
+/**************************************************************************************************
+ 钉住文件线性区的 page_mapping 并保存文件快照,调用者持有 regionMux,线性区还在所以文件一定打开着.
+ 放开 regionMux 后文件可能被关闭,表项可能被同一路径重新打开,锁外只用快照读设备,不再碰 filp;
+ 映射被钉住,munmap + close + unlink 也不会释放它.用 OsPageCacheReadaheadPinned 释放.
+**************************************************************************************************/
+VOID OsFileMappingPin(struct file *filp, LosFilePin *pin)
+{
+    pin->mapping = get_file_mapping(filp);
+    if (pin->mapping == NULL) {
+        return;
+    }
+    if ((memcpy_s(&pin->file, sizeof(struct file), filp, sizeof(struct file)) != EOK) ||
+        (pin->file.f_mapping != pin->mapping)) {
+        dec_mapping(pin->mapping);
+        pin->mapping = NULL;
+    }
+}
+//不持 regionMux 用快照预读文件线性区,读完释放 OsFileMappingPin 钉住的映射, nPages 为 0 时只释放
+VOID OsPageCacheReadaheadPinned(LosFilePin *pin, VM_OFFSET_T start, UINT32 nPages)
+{
+    if (pin->mapping == NULL) {
+        return;
+    }
+    if (nPages != 0) {
+        OsMappingReadRange(&pin->file, pin->mapping, start, nPages);
+    }
+    dec_mapping(pin->mapping);
+    pin->mapping = NULL;
+}
+//read()路径的预读, fileSize 用于裁剪窗口
+STATIC VOID OsMappingReadahead(struct file *filp, VM_OFFSET_T pgoff, off_t fileSize)
+{
+    BOOL miss;
+    UINT32 intSave;
+    UINT32 nPages;
+    VM_OFFSET_T start = 0;
+    VM_OFFSET_T endPgoff = ROUNDUP(fileSize, PAGE_SIZE) >> PAGE_SHIFT;
+    struct page_mapping *mapping = filp->f_mapping;
+    LosFileReadahead *ra = NULL;
+
+    LOS_SpinLockSave(&mapping->list_lock, &intSave);
+    miss = (OsFindGetEntry(mapping, pgoff) == NULL);
+    LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+
+    LOS_SpinLockSave(&g_fileRaSpin, &intSave);
+    ra = OsFileReadaheadGet(filp);
+    nPages = (ra != NULL) ? OsFileReadaheadWindow(ra, pgoff, miss, &start) : 0;
+    LOS_SpinUnlockRestore(&g_fileRaSpin, intSave);
+
+    if ((nPages == 0) || (start >= endPgoff)) {
+        return;
+    }
+    OsPageCacheReadahead(filp, start, MIN2(nPages, endPgoff - start));
+}
+/**************************************************************************************************
+ 缺页路径的预读窗口,窗口记录在线性区上,不超出线性区范围,调用者持有 space->regionMux
+ 返回放开 regionMux 后需要用 OsPageCacheReadahead 读入的页数,缺失的当前页总在其中,
+ 这样设备读不会在 regionMux 下进行,同一进程的其他缺页和 mmap/munmap 不必等待.
+**************************************************************************************************/
+UINT32 OsFileFaultReadaheadWindow(LosVmMapRegion *region, VM_OFFSET_T pgoff, VM_OFFSET_T *start)
+{
+    BOOL miss;
+    UINT32 intSave;
+    UINT32 nPages;
+    struct page_mapping *mapping = region->unTypeData.rf.file->f_mapping;
+    VM_OFFSET_T endPgoff = region->pgOff + (region->range.size >> PAGE_SHIFT);
+
+    LOS_SpinLockSave(&mapping->list_lock, &intSave);
+    miss = (OsFindGetEntry(mapping, pgoff) == NULL);
+    nPages = OsFileReadaheadWindow(&region->unTypeData.rf.readahead, pgoff, miss, start);
+    LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+
+    if ((nPages == 0) || (*start >= endPgoff)) {
+        *start = pgoff;
+        return miss ? 1 : 0;
+    }
+    return MIN2(nPages, endPgoff - *start);
+}
 /**************************************************************************************************
  找到文件filp的pgOff位置在内核空间的虚拟地址,并填充文件数据,参数带回 kvaddr 和 readSize
 **************************************************************************************************/
@@ -145,6 +434,7 @@ STATIC LosFilePage *OsPagecacheGetPageAndFill(struct file *filp, VM_OFFSET_T pgO
     struct page_mapping *mapping = filp->f_mapping;//找到文件和文件页的映射关系结构体
 
     page = OsFindGetEntry(mapping, pgOff);//通过位置找到对应的文件页
+    OsVmEventInc((page != NULL) ? VM_EVENT_CACHE_HIT : VM_EVENT_CACHE_MISS);
     if (page != NULL) {//找到了
         OsSetPageLocked(page->vmPage);//因为一个文件页可能多个进程同时访问,所以操作之前必须先锁
         OsPageRefIncLocked(page);
@@ -201,11 +491,12 @@ ssize_t OsMappingRead(struct file *filp, char *buf, size_t size)
         return 0;
     }
 
-    LOS_SpinLockSave(&mapping->list_lock, &intSave);//一定要用自旋锁,因为多CPU可能同时操作
-
     for (INT32 i = 0; (i < nPages) && readLeft; i++, pgOff++) {//一页一页读
+        OsMappingReadahead(filp, pgOff, bufStat.st_size);//顺序读时提前把后面的页读进缓存
+        LOS_SpinLockSave(&mapping->list_lock, &intSave);//一定要用自旋锁,因为多CPU可能同时操作
         page = OsPagecacheGetPageAndFill(filp, pgOff, &readSize, &kvaddr);//按页读
         if ((page == NULL) || (readSize == 0)) {
+            LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
             break;
         }
         if (readSize < PAGE_SIZE) {//当读的数据还不要一页时
@@ -222,9 +513,9 @@ ssize_t OsMappingRead(struct file *filp, char *buf, size_t size)
         offInPage = 0;
 
         OsCleanPageLocked(page->vmPage);
+        LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
     }
 
-    LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
     file_seek(filp, pos + readTotal, SEEK_SET);//文件要跳到读取后的位置
 
     return readTotal;
@@ -280,6 +571,7 @@ ssize_t OsMappingWrite(struct file *filp, const char *buf, size_t size)
     LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
 
     file_seek(filp, pos + size - writeLeft, SEEK_SET);//最后文件要seek到指定的位置
+    OsWritebackThrottle();//脏页过多时唤醒回写任务,超过上限则让写者等一等
     return (size - writeLeft);
 }
 //解除文件页和进程的映射关系
@@ -349,9 +641,46 @@ VOID OsVmmFileRemove(LosVmMapRegion *region, LosArchMmu *archMmu, VM_OFFSET_T pg
     }
     return;
 }
+/**************************************************************************************************
+ munlock 时解除线性区映射的文件页的锁定.
+ 只被本线性区映射的页才清锁定标签,还被其他进程映射的页可能也被对方锁定,保留到最后一个映射解除.
+**************************************************************************************************/
+VOID OsFilePagesUnlock(LosVmMapRegion *region)
+{
+    UINT32 intSave;
+    PADDR_T paddr;
+    VADDR_T vaddr;
+    VM_OFFSET_T pgoff;
+    LosFilePage *fpage = NULL;
+    struct page_mapping *mapping = NULL;
+
+    if (!LOS_IsRegionFileValid(region) || (region->unTypeData.rf.file->f_mapping == NULL)) {
+        return;
+    }
+    mapping = region->unTypeData.rf.file->f_mapping;
+
+    LOS_SpinLockSave(&mapping->list_lock, &intSave);
+    for (vaddr = region->range.base; vaddr < (region->range.base + region->range.size); vaddr += PAGE_SIZE) {
+        pgoff = ((vaddr - region->range.base) >> PAGE_SHIFT) + region->pgOff;
+        fpage = OsFindGetEntry(mapping, pgoff);
+        if ((fpage == NULL) || (fpage->n_maps != 1)) {
+            continue;
+        }
+        if ((LOS_ArchMmuQuery(&region->space->archMmu, vaddr, &paddr, NULL) == LOS_OK) &&
+            (paddr == fpage->vmPage->physAddr)) {
+            fpage->flags &= ~VM_MAP_REGION_FLAG_LOCKED;
+        }
+    }
+    LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+}
 //标记page为脏页 进程修改了高速缓存里的数据时，该页就被内核标记为脏页
 VOID OsMarkPageDirty(LosFilePage *fpage, LosVmMapRegion *region, INT32 off, INT32 len)
 {
+    if (!OsIsPageDirty(fpage->vmPage)) {//由干净变脏,记下时间供回写任务判断是否过期
+        fpage->dirtyTick = (UINT32)LOS_TickCountGet();
+        OsWritebackDirtyInc();
+    }
+
     if (region != NULL) {
         OsSetPageDirty(fpage->vmPage);//设置为脏页
         fpage->dirtyOff = off;//脏页偏移位置
@@ -443,6 +772,9 @@ LosFilePage *OsDumpDirtyPage(LosFilePage *oldFPage)
         return NULL;
     }
 
+    if (OsIsPageDirty(oldFPage->vmPage)) {
+        OsWritebackDirtyDec();
+    }
     OsCleanPageDirty(oldFPage->vmPage);//脏页标识位 置0
     LOS_AtomicInc(&oldFPage->vmPage->refCounts);//引用自增
     /* no map page cache */
@@ -494,12 +826,16 @@ VOID OsDelMapInfo(LosVmMapRegion *region, LosVmPgFault *vmf, BOOL cleanDirty)
         return;
     }
 
-    if (cleanDirty) {
+    if (cleanDirty && OsIsPageDirty(fpage->vmPage)) {
+        OsWritebackDirtyDec();
         OsCleanPageDirty(fpage->vmPage);//恢复干净页
     }
     info = OsGetMapInfo(fpage, &region->space->archMmu, (vaddr_t)vmf->vaddr);//通过虚拟地址获取映射信息
     if (info != NULL) {
         fpage->n_maps--;
+        if (fpage->n_maps == 0) {
+            fpage->flags &= ~VM_MAP_REGION_FLAG_LOCKED;
+        }
         LOS_ListDelete(&info->node);
         LOS_AtomicDec(&fpage->vmPage->refCounts);
         LOS_MemFree(m_aucSysMem0, info);
@@ -532,6 +868,7 @@ INT32 OsVmmFileFault(LosVmMapRegion *region, LosVmPgFault *vmf)
     /* get or create a new cache node */
     LOS_SpinLockSave(&mapping->list_lock, &intSave);
     fpage = OsFindGetEntry(mapping, vmf->pgoff);//获取文件页
+    OsVmEventInc((fpage != NULL) ? VM_EVENT_CACHE_HIT : VM_EVENT_CACHE_MISS);
     if (fpage != NULL) {//找到了,说明该页已经在页高速缓存中
         OsPageRefIncLocked(fpage);
     } else {//真的缺页了,页高速缓存中没找到
@@ -571,7 +908,7 @@ INT32 OsVmmFileFault(LosVmMapRegion *region, LosVmPgFault *vmf)
     /* cow fault case no need to save mapinfo */
     if (!((vmf->flags & VM_MAP_PF_FLAG_WRITE) && !(region->regionFlags & VM_MAP_REGION_FLAG_SHARED))) {
         OsAddMapInfo(fpage, &region->space->archMmu, (vaddr_t)vmf->vaddr);//添加<虚拟地址,文件页>的映射关系,如此进程以后就能通过虚拟地址操作文件页了.
-        fpage->flags = region->regionFlags;
+        OsFilePageFlagsSet(fpage, region->regionFlags);
     }
 
     /* share page fault, mark the page dirty */
@@ -660,6 +997,7 @@ INT32 OsVfsFileMmap(struct file *filep, LosVmMapRegion *region)
     region->unTypeData.rf.vmFOps = &g_commVmOps;//文件操作
     region->unTypeData.rf.file = filep; //文件描述信息
     region->unTypeData.rf.fileMagic = filep->f_magicnum;//magic数
+    OsFileReadaheadInit(&region->unTypeData.rf.readahead, FILE_RA_NORMAL);//缺页预读窗口
     return ENOERR;
 }
 /******************************************************************************
@@ -737,6 +1075,13 @@ LosFilePage *OsPageCacheAlloc(struct page_mapping *mapping, VM_OFFSET_T pgoff)
         VM_ERR("alloc vm page failed");
         return NULL;
     }
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    if (OsProcessIsUserMode(OsCurrProcessGet()) &&//读入页缓存的进程付费;这里可能持有 mapping 自旋锁,不能回收
+        (OsVmPageCharge(OsCurrProcessGet()->vmSpace, vmPage, FALSE) != LOS_OK)) {
+        LOS_PhysPageFree(vmPage);
+        return NULL;
+    }
+#endif
     physSeg = OsVmPhysSegGet(vmPage);//通过页获取所在seg
     kvaddr = OsVmPageToVaddr(vmPage);//获取内核空间的虚拟地址,具体点进去看函数说明，这里一定要理解透彻！
     if ((physSeg == NULL) || (kvaddr == NULL)) {
@@ -764,7 +1109,7 @@ LosFilePage *OsPageCacheAlloc(struct page_mapping *mapping, VM_OFFSET_T pgoff)
     fpage->vmPage = vmPage;			//物理页框
     fpage->mapping = mapping;		//记录所有文件页映射
     fpage->pgoff = pgoff;			//将文件切成一页页，页标
-    (VOID)memset_s(kvaddr, PAGE_SIZE, 0, PAGE_SIZE);//页内数据清0
+    OsPhysPageZero(kvaddr);//页内数据清0
 
     return fpage;
 }
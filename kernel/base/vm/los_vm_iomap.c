@@ -35,6 +35,9 @@
 #include "los_vm_common.h"
 #include "los_vm_map.h"
 #include "los_vm_lock.h"
+#include "los_vm_phys.h"
+#include "los_memory.h"
+#include "los_hw.h"
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -211,6 +214,151 @@ DMA_ADDR_T LOS_DmaVaddrToPaddr(VOID *vaddr)
 
     return (DMA_ADDR_T)pa;
 }
+
+typedef struct {
+    LOS_DL_LIST node;
+    UINT32      nPages;
+} LosDmaPoolBlock;
+
+LosDmaPool *LOS_DmaPoolCreate(const CHAR *name, size_t size, size_t align, enum DmaMemType type)
+{
+    LosDmaPool *pool = NULL;
+    size_t blockSize;
+
+    if ((size == 0) || ((align & (align - 1)) != 0)) {
+        VM_ERR("invalid dma pool size = %u, align = %u", size, align);
+        return NULL;
+    }
+
+    if ((type != DMA_CACHE) && (type != DMA_NOCACHE)) {
+        VM_ERR("The dma type = %d is not support!", type);
+        return NULL;
+    }
+
+    pool = (LosDmaPool *)LOS_MemAlloc(m_aucSysMem0, sizeof(LosDmaPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->name = name;
+    pool->align = (align > DMA_POOL_MIN_ALIGN) ? align : DMA_POOL_MIN_ALIGN;
+    pool->size = ROUNDUP(size, pool->align);
+    pool->type = type;
+    blockSize = ROUNDUP(sizeof(LosDmaPoolBlock), pool->align) + pool->size;
+    pool->blockPages = ROUNDUP(blockSize, PAGE_SIZE) >> PAGE_SHIFT;
+    if (pool->blockPages < DMA_POOL_BLOCK_PAGES) {
+        pool->blockPages = DMA_POOL_BLOCK_PAGES;
+    }
+    LOS_SpinInit(&pool->lock);
+    pool->freeList = NULL;
+    LOS_ListInit(&pool->blocks);
+    pool->nrChunks = 0;
+    pool->nrFree = 0;
+    return pool;
+}
+
+/* called with pool->lock held */
+STATIC STATUS_T OsDmaPoolGrow(LosDmaPool *pool)
+{
+    LosDmaPoolBlock *block = NULL;
+    UINTPTR base;
+    UINTPTR end;
+    UINTPTR chunk;
+
+    base = (UINTPTR)LOS_PhysPagesAllocContiguous(pool->blockPages);
+    if (base == 0) {
+        return LOS_ERRNO_VM_NO_MEMORY;
+    }
+    end = base + (pool->blockPages << PAGE_SHIFT);
+
+    if (pool->type == DMA_NOCACHE) {
+        /* dirty lines left by the previous owner must not be written back over device data */
+        DCacheFlushRange(base, end);
+        base = VMM_TO_UNCACHED_ADDR(base);
+        end = VMM_TO_UNCACHED_ADDR(end);
+    }
+
+    block = (LosDmaPoolBlock *)base;
+    block->nPages = pool->blockPages;
+    LOS_ListAdd(&pool->blocks, &block->node);
+
+    for (chunk = ROUNDUP(base + sizeof(LosDmaPoolBlock), pool->align); (chunk + pool->size) <= end;
+         chunk += pool->size) {
+        *(VOID **)chunk = pool->freeList;
+        pool->freeList = (VOID *)chunk;
+        pool->nrChunks++;
+        pool->nrFree++;
+    }
+    return LOS_OK;
+}
+
+VOID *LOS_DmaPoolAlloc(LosDmaPool *pool, DMA_ADDR_T *dmaAddr)
+{
+    UINT32 intSave;
+    UINTPTR chunk;
+
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    LOS_SpinLockSave(&pool->lock, &intSave);
+    if ((pool->freeList == NULL) && (OsDmaPoolGrow(pool) != LOS_OK)) {
+        LOS_SpinUnlockRestore(&pool->lock, intSave);
+        VM_ERR("dma pool %s: failed to grow, chunk size = %u", pool->name, pool->size);
+        return NULL;
+    }
+    chunk = (UINTPTR)pool->freeList;
+    pool->freeList = *(VOID **)chunk;
+    pool->nrFree--;
+    LOS_SpinUnlockRestore(&pool->lock, intSave);
+
+    if (dmaAddr != NULL) {
+        *dmaAddr = (pool->type == DMA_NOCACHE) ? (DMA_ADDR_T)VMM_TO_DMA_ADDR(UNCACHED_TO_VMM_ADDR(chunk)) :
+                                                 (DMA_ADDR_T)VMM_TO_DMA_ADDR(chunk);
+    }
+    return (VOID *)chunk;
+}
+
+VOID LOS_DmaPoolFree(LosDmaPool *pool, VOID *vaddr)
+{
+    UINT32 intSave;
+
+    if ((pool == NULL) || (vaddr == NULL)) {
+        return;
+    }
+
+    LOS_SpinLockSave(&pool->lock, &intSave);
+    *(VOID **)vaddr = pool->freeList;
+    pool->freeList = vaddr;
+    pool->nrFree++;
+    LOS_SpinUnlockRestore(&pool->lock, intSave);
+}
+
+STATUS_T LOS_DmaPoolDestroy(LosDmaPool *pool)
+{
+    LosDmaPoolBlock *block = NULL;
+    LosDmaPoolBlock *next = NULL;
+    UINTPTR addr;
+
+    if (pool == NULL) {
+        return LOS_ERRNO_VM_INVALID_ARGS;
+    }
+
+    if (pool->nrFree != pool->nrChunks) {
+        VM_ERR("dma pool %s: %u chunks still in use", pool->name, pool->nrChunks - pool->nrFree);
+        return LOS_ERRNO_VM_BUSY;
+    }
+
+    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(block, next, &pool->blocks, LosDmaPoolBlock, node) {
+        addr = (UINTPTR)block;
+        if (pool->type == DMA_NOCACHE) {
+            addr = UNCACHED_TO_VMM_ADDR(addr);
+        }
+        LOS_PhysPagesFreeContiguous((VOID *)addr, block->nPages);
+    }
+    LOS_MemFree(m_aucSysMem0, pool);
+    return LOS_OK;
+}
 #ifdef __cplusplus
 #if __cplusplus
 }
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**************************************************************************************************
+ 相同页合并(KSM)
+ fork 出来的进程常有大量内容相同又从未写过的匿名页,如清0的缓冲区,拷贝来的配置表.
+ 后台任务按 madvise(MADV_MERGEABLE) 标记的线性区轮流扫描,按页内容算校验和:
+ 1.和已合并页(稳定表)相同,把映射换成合并页;
+ 2.和上次记下的候选页(不稳定表)相同,把本页变成合并页,对方换过来.
+ 合并页在所有进程中都是只读映射,稳定表自己也持有一个引用,所以写的时候引用数一定大于1,
+ 缺页走已有的写时拷贝(OsPhysSharePageCopy)复制出私有页.没有进程再映射的合并页由扫描任务释放.
+**************************************************************************************************/
+#include "los_vm_ksm.h"
+#include "los_vm_filemap.h"
+#include "los_vm_lock.h"
+#include "los_vm_page.h"
+#include "los_vm_phys.h"
+#include "los_memory.h"
+#include "los_task_pri.h"
+#include "los_sys.h"
+#include "los_printf.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_KSM
+
+#define VM_KSM_STABLE_BUCKETS   256
+#define VM_KSM_UNSTABLE_SIZE    512
+#define VM_KSM_TASK_PRIO        (OS_TASK_PRIORITY_LOWEST - 1)  /* only ahead of the idle task */
+
+typedef struct {
+    LOS_DL_LIST node;
+    LosVmPage   *page;      /* merged read-only page, the node holds one reference */
+    UINT32      checksum;
+} LosVmKsmStable;
+
+typedef struct {
+    LosVmSpace  *space;     /* may be stale, checked against the space list before use */
+    VADDR_T     vaddr;
+    UINT32      checksum;
+} LosVmKsmCandidate;
+
+STATIC LosMux g_ksmMux;                                     /* stable table and counters */
+STATIC LOS_DL_LIST g_ksmStable[VM_KSM_STABLE_BUCKETS];
+STATIC LosVmKsmCandidate g_ksmUnstable[VM_KSM_UNSTABLE_SIZE];  /* scanner task only */
+STATIC UINT32 g_ksmPagesToScan = VM_KSM_PAGES_TO_SCAN;
+STATIC UINT32 g_ksmSleepMs = VM_KSM_SLEEP_MS;
+STATIC UINT32 g_ksmPagesShared;     /* pages in the stable table */
+STATIC UINT32 g_ksmPagesScanned;
+STATIC UINT32 g_ksmMerges;          /* mappings switched over to a merged page */
+
+STATIC UINT32 OsVmKsmChecksum(const UINT32 *word)
+{
+    UINT32 hash = 0x811C9DC5;   /* FNV-1a over 32-bit words */
+    UINT32 index;
+
+    for (index = 0; index < (PAGE_SIZE / sizeof(UINT32)); index++) {
+        hash = (hash ^ word[index]) * 0x01000193;
+    }
+    return hash;
+}
+//madvise 标记过的私有匿名线性区才参与合并
+STATIC BOOL OsVmKsmRegionMergeable(const LosVmSpace *space, const LosVmMapRegion *region)
+{
+    if ((region == NULL) || ((region->regionFlags & VM_MAP_REGION_FLAG_MERGEABLE) == 0)) {
+        return FALSE;
+    }
+    if ((region->regionFlags & (VM_MAP_REGION_FLAG_SHM | VM_MAP_REGION_FLAG_SHARED | VM_MAP_REGION_FLAG_VDSO)) != 0) {
+        return FALSE;
+    }
+    return LOS_IsRegionTypeAnon((LosVmMapRegion *)region) || (region == space->heap);
+}
+//取出 vaddr 处映射的匿名页,带回当前的映射属性
+STATIC LosVmPage *OsVmKsmPageGet(LosVmSpace *space, VADDR_T vaddr, UINT32 *flags)
+{
+    LosVmPage *page = NULL;
+    PADDR_T paddr = 0;
+
+    if (LOS_ArchMmuQuery(&space->archMmu, vaddr, &paddr, flags) != LOS_OK) {
+        return NULL;
+    }
+    page = LOS_VmPageGet(paddr);
+    if ((page == NULL) || OsIsPageShared(page)) {
+        return NULL;
+    }
+    return page;
+}
+//先去掉写权限再比较内容,比较和替换期间进程的写会缺页并等在 regionMux 上
+STATIC VOID OsVmKsmWriteProtect(LosVmSpace *space, VADDR_T vaddr, UINT32 flags)
+{
+    if (flags & VM_MAP_REGION_FLAG_PERM_WRITE) {
+        (VOID)LOS_ArchMmuChangeProt(&space->archMmu, vaddr, 1, flags & ~VM_MAP_REGION_FLAG_PERM_WRITE);
+    }
+}
+
+STATIC VOID OsVmKsmWriteRestore(LosVmSpace *space, VADDR_T vaddr, UINT32 flags)
+{
+    if (flags & VM_MAP_REGION_FLAG_PERM_WRITE) {
+        (VOID)LOS_ArchMmuChangeProt(&space->archMmu, vaddr, 1, flags);
+    }
+}
+//把已写保护且内容相同的 page 在 vaddr 处的映射换成合并页 kpage
+STATIC STATUS_T OsVmKsmReplace(LosVmSpace *space, VADDR_T vaddr, LosVmPage *page, LosVmPage *kpage, UINT32 flags)
+{
+    LosArchMmu *archMmu = &space->archMmu;
+
+    flags &= ~VM_MAP_REGION_FLAG_PERM_WRITE;
+    LOS_AtomicInc(&kpage->refCounts);
+    (VOID)LOS_ArchMmuUnmap(archMmu, vaddr, 1);
+    if (LOS_ArchMmuMap(archMmu, vaddr, kpage->physAddr, 1, flags) < 0) {
+        LOS_AtomicDec(&kpage->refCounts);
+        (VOID)LOS_ArchMmuMap(archMmu, vaddr, page->physAddr, 1, flags);
+        return LOS_ERRNO_VM_MAP_FAILED;
+    }
+
+    LOS_PhysPageFree(page);//原页少一个引用,fork 共享的页还留给其他进程
+    g_ksmMerges++;
+    return LOS_OK;
+}
+
+STATIC LosVmKsmStable *OsVmKsmStableFind(UINT32 checksum, const VOID *kvaddr)
+{
+    LosVmKsmStable *stable = NULL;
+
+    LOS_DL_LIST_FOR_EACH_ENTRY(stable, &g_ksmStable[checksum % VM_KSM_STABLE_BUCKETS], LosVmKsmStable, node) {
+        if ((stable->checksum == checksum) && (memcmp(OsVmPageToVaddr(stable->page), kvaddr, PAGE_SIZE) == 0)) {
+            return stable;
+        }
+    }
+    return NULL;
+}
+//page 成为合并页,调用者已把它的映射改为只读
+STATIC LosVmKsmStable *OsVmKsmStableAdd(LosVmPage *page, UINT32 checksum)
+{
+    LosVmKsmStable *stable = LOS_MemAlloc(m_aucSysMem0, sizeof(LosVmKsmStable));
+
+    if (stable == NULL) {
+        return NULL;
+    }
+    stable->page = page;
+    stable->checksum = checksum;
+    LOS_AtomicInc(&page->refCounts);
+    OsSetPageMerged(page);
+    LOS_ListAdd(&g_ksmStable[checksum % VM_KSM_STABLE_BUCKETS], &stable->node);
+    g_ksmPagesShared++;
+    return stable;
+}
+//所有进程都已写时拷贝走或解除映射,只剩稳定表自己的引用时释放
+STATIC VOID OsVmKsmStablePrune(VOID)
+{
+    LosVmKsmStable *stable = NULL;
+    LosVmKsmStable *next = NULL;
+    UINT32 index;
+
+    for (index = 0; index < VM_KSM_STABLE_BUCKETS; index++) {
+        LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(stable, next, &g_ksmStable[index], LosVmKsmStable, node) {
+            if (LOS_AtomicRead(&stable->page->refCounts) > 1) {
+                continue;
+            }
+            LOS_ListDelete(&stable->node);
+            OsCleanPageMerged(stable->page);
+            LOS_PhysPageFree(stable->page);
+            (VOID)LOS_MemFree(m_aucSysMem0, stable);
+            g_ksmPagesShared--;
+        }
+    }
+}
+//空间引用计数已经归零说明正在释放,不能再拿引用
+STATIC BOOL OsVmKsmSpaceTryGet(LosVmSpace *space)
+{
+    INT32 ref;
+
+    do {
+        ref = LOS_AtomicRead(&space->refCount);
+        if (ref <= 0) {
+            return FALSE;
+        }
+    } while (LOS_AtomicCmpXchg32bits(&space->refCount, ref + 1, ref));
+    return TRUE;
+}
+//不稳定表里记的空间可能已经销毁,还在链表上才拿引用;调用者持有 regionMux,不能等空间链表锁
+STATIC BOOL OsVmKsmSpaceGetAlive(LosVmSpace *space)
+{
+    LosMux *spaceMux = OsGVmSpaceMuxGet();
+    LosVmSpace *iter = NULL;
+    BOOL alive = FALSE;
+
+    if (LOS_MuxTrylock(spaceMux) != LOS_OK) {
+        return FALSE;
+    }
+    LOS_DL_LIST_FOR_EACH_ENTRY(iter, LOS_GetVmSpaceList(), LosVmSpace, node) {
+        if (iter == space) {
+            alive = OsVmKsmSpaceTryGet(space);
+            break;
+        }
+    }
+    (VOID)LOS_MuxUnlock(spaceMux);
+    return alive;
+}
+//本页和候选页内容相同:本页留作合并页,候选页换过来
+STATIC VOID OsVmKsmMergePair(LosVmSpace *space, VADDR_T vaddr, LosVmPage *page, UINT32 flags,
+                             const LosVmKsmCandidate *cand)
+{
+    LosVmSpace *other = cand->space;
+    LosVmPage *otherPage = NULL;
+    LosVmKsmStable *stable = NULL;
+    UINT32 otherFlags = 0;
+
+    if (other != space) {
+        if (!OsVmKsmSpaceGetAlive(other)) {
+            return;
+        }
+        /* the scanner already holds one regionMux, never block on a second one */
+        if (LOS_MuxTrylock(&other->regionMux) != LOS_OK) {
+            (VOID)OsVmSpacePut(other);
+            return;
+        }
+    }
+    if (!OsVmKsmRegionMergeable(other, LOS_RegionFind(other, cand->vaddr))) {
+        goto OUT;
+    }
+    otherPage = OsVmKsmPageGet(other, cand->vaddr, &otherFlags);
+    if ((otherPage == NULL) || (otherPage == page) || OsIsPageMerged(otherPage)) {
+        goto OUT;
+    }
+
+    OsVmKsmWriteProtect(space, vaddr, flags);
+    OsVmKsmWriteProtect(other, cand->vaddr, otherFlags);
+    if (memcmp(OsVmPageToVaddr(page), OsVmPageToVaddr(otherPage), PAGE_SIZE) == 0) {
+        stable = OsVmKsmStableAdd(page, cand->checksum);
+        if ((stable != NULL) && (OsVmKsmReplace(other, cand->vaddr, otherPage, page, otherFlags) == LOS_OK)) {
+            goto OUT;
+        }
+    }
+    if (stable == NULL) {
+        OsVmKsmWriteRestore(space, vaddr, flags);
+    }
+    OsVmKsmWriteRestore(other, cand->vaddr, otherFlags);
+OUT:
+    if (other != space) {
+        (VOID)LOS_MuxUnlock(&other->regionMux);
+        (VOID)OsVmSpacePut(other);  /* its process may have exited meanwhile, the last put frees it */
+    }
+}
+//扫描一页,调用者持有 g_ksmMux 和 space->regionMux
+STATIC VOID OsVmKsmScanPage(LosVmSpace *space, VADDR_T vaddr)
+{
+    LosVmKsmStable *stable = NULL;
+    LosVmKsmCandidate *cand = NULL;
+    LosVmPage *page = NULL;
+    VOID *kvaddr = NULL;
+    UINT32 flags = 0;
+    UINT32 checksum;
+
+    page = OsVmKsmPageGet(space, vaddr, &flags);
+    if ((page == NULL) || OsIsPageMerged(page)) {
+        return;
+    }
+    g_ksmPagesScanned++;
+
+    kvaddr = OsVmPageToVaddr(page);
+    checksum = OsVmKsmChecksum(kvaddr);
+    stable = OsVmKsmStableFind(checksum, kvaddr);
+    if (stable != NULL) {//校验和与内容只是预筛,写保护之后再比较一次才算数
+        OsVmKsmWriteProtect(space, vaddr, flags);
+        if ((memcmp(OsVmPageToVaddr(stable->page), kvaddr, PAGE_SIZE) != 0) ||
+            (OsVmKsmReplace(space, vaddr, page, stable->page, flags) != LOS_OK)) {
+            OsVmKsmWriteRestore(space, vaddr, flags);
+        }
+        return;
+    }
+
+    cand = &g_ksmUnstable[checksum % VM_KSM_UNSTABLE_SIZE];
+    if ((cand->space != NULL) && (cand->checksum == checksum) && ((cand->space != space) || (cand->vaddr != vaddr))) {
+        OsVmKsmMergePair(space, vaddr, page, flags, cand);
+        cand->space = NULL;
+        return;
+    }
+    cand->space = space;//记下来等内容相同的页,同一槽位后来的覆盖先来的
+    cand->vaddr = vaddr;
+    cand->checksum = checksum;
+}
+//从 space->ksmCursor 接着上次停下的地方扫描
+STATIC VOID OsVmKsmScanSpace(LosVmSpace *space, UINT32 *budget)
+{
+    LosVmMapRegion *region = NULL;
+    LosRbNode *pstRbNode = NULL;
+    LosRbNode *pstRbNodeNext = NULL;
+    VADDR_T vaddr;
+    VADDR_T end;
+
+    RB_SCAN_SAFE(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+        region = (LosVmMapRegion *)pstRbNode;
+        end = region->range.base + region->range.size;
+        if ((end <= space->ksmCursor) || !OsVmKsmRegionMergeable(space, region)) {
+            continue;
+        }
+
+        vaddr = (region->range.base > space->ksmCursor) ? region->range.base : space->ksmCursor;
+        for (; (vaddr < end) && (*budget > 0); vaddr += PAGE_SIZE) {
+            (*budget)--;
+            OsVmKsmScanPage(space, vaddr);
+        }
+        space->ksmCursor = vaddr;
+        if (*budget == 0) {
+            return;
+        }
+    RB_SCAN_SAFE_END(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+
+    space->ksmCursor = 0;
+}
+//一次扫描最多 budget 页,进程之间轮流,扫过的空间排到队尾
+STATIC VOID OsVmKsmScan(UINT32 budget)
+{
+    LOS_DL_LIST *spaceList = LOS_GetVmSpaceList();
+    LosMux *spaceMux = OsGVmSpaceMuxGet();
+    LosVmSpace *space = NULL;
+    UINT32 spaces = 0;
+    BOOL got = FALSE;
+
+    (VOID)LOS_MuxAcquire(&g_ksmMux);
+    (VOID)LOS_MuxAcquire(spaceMux);
+    LOS_DL_LIST_FOR_EACH_ENTRY(space, spaceList, LosVmSpace, node) {
+        spaces++;
+    }
+    (VOID)LOS_MuxRelease(spaceMux);
+
+    /* the list lock is held only to rotate the cursor, a reference keeps the space while it is scanned */
+    while ((spaces > 0) && (budget > 0)) {
+        spaces--;
+        (VOID)LOS_MuxAcquire(spaceMux);
+        if (LOS_ListEmpty(spaceList)) {
+            (VOID)LOS_MuxRelease(spaceMux);
+            break;
+        }
+        space = LOS_DL_LIST_ENTRY(spaceList->pstNext, LosVmSpace, node);
+        LOS_ListDelete(&space->node);
+        LOS_ListTailInsert(spaceList, &space->node);
+        got = LOS_IsUserAddress(space->base) && OsVmKsmSpaceTryGet(space);
+        (VOID)LOS_MuxRelease(spaceMux);
+        if (!got) {
+            continue;
+        }
+        if (LOS_MuxTrylock(&space->regionMux) == LOS_OK) {//忙的空间跳过,下一轮再来
+            OsVmKsmScanSpace(space, &budget);
+            (VOID)LOS_MuxUnlock(&space->regionMux);
+        }
+        (VOID)OsVmSpacePut(space);
+    }
+    OsVmKsmStablePrune();
+    (VOID)LOS_MuxRelease(&g_ksmMux);
+}
+
+STATIC VOID OsVmKsmTask(VOID)
+{
+    while (1) {
+        (VOID)LOS_TaskDelay(LOS_MS2Tick(g_ksmSleepMs));
+        if (g_ksmPagesToScan != 0) {
+            OsVmKsmScan(g_ksmPagesToScan);
+        }
+    }
+}
+//调整扫描速度,pagesToScan 为0时暂停扫描
+VOID OsVmKsmScanRateSet(UINT32 pagesToScan, UINT32 sleepMs)
+{
+    g_ksmPagesToScan = pagesToScan;
+    g_ksmSleepMs = (sleepMs == 0) ? 1 : sleepMs;
+}
+/**************************************************************************************************
+ mprotect 恢复写权限时,合并页的映射仍然保持只读,写的时候照常写时拷贝,调用者持有 regionMux
+**************************************************************************************************/
+VOID OsVmKsmProtect(LosVmSpace *space, VADDR_T vaddr, UINT32 count)
+{
+    LosVmPage *page = NULL;
+    UINT32 flags = 0;
+
+    for (; count > 0; count--, vaddr += PAGE_SIZE) {
+        page = OsVmKsmPageGet(space, vaddr, &flags);
+        if ((page != NULL) && OsIsPageMerged(page)) {
+            OsVmKsmWriteProtect(space, vaddr, flags);
+        }
+    }
+}
+//shell vmm -m 查看合并情况,pages sharing 即合并省下的页数
+VOID OsVmKsmDump(VOID)
+{
+    LosVmKsmStable *stable = NULL;
+    UINT32 sharing = 0;
+    UINT32 index;
+    INT32 refs;
+
+    (VOID)LOS_MuxAcquire(&g_ksmMux);
+    for (index = 0; index < VM_KSM_STABLE_BUCKETS; index++) {
+        LOS_DL_LIST_FOR_EACH_ENTRY(stable, &g_ksmStable[index], LosVmKsmStable, node) {
+            refs = LOS_AtomicRead(&stable->page->refCounts);
+            if (refs > 2) { /* 2: the table's reference and the one page kept */
+                sharing += (UINT32)(refs - 2);
+            }
+        }
+    }
+    PRINTK("\r\n ksm: pages to scan %u, sleep %u ms\n", g_ksmPagesToScan, g_ksmSleepMs);
+    PRINTK(" ksm: pages shared %u, pages sharing %u, pages scanned %u, merges %u\n",
+           g_ksmPagesShared, sharing, g_ksmPagesScanned, g_ksmMerges);
+    (VOID)LOS_MuxRelease(&g_ksmMux);
+}
+//创建相同页合并扫描任务
+UINT32 OsVmKsmInit(VOID)
+{
+    UINT32 ret;
+    UINT32 taskID;
+    UINT32 index;
+    TSK_INIT_PARAM_S taskInitParam;
+
+    ret = LOS_MuxInit(&g_ksmMux, NULL);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+    for (index = 0; index < VM_KSM_STABLE_BUCKETS; index++) {
+        LOS_ListInit(&g_ksmStable[index]);
+    }
+
+    (VOID)memset_s((VOID *)(&taskInitParam), sizeof(TSK_INIT_PARAM_S), 0, sizeof(TSK_INIT_PARAM_S));
+    taskInitParam.pfnTaskEntry = (TSK_ENTRY_FUNC)OsVmKsmTask;
+    taskInitParam.uwStackSize = LOSCFG_BASE_CORE_TSK_DEFAULT_STACK_SIZE;
+    taskInitParam.pcName = "KsmTask";
+    taskInitParam.usTaskPrio = VM_KSM_TASK_PRIO;
+    return LOS_TaskCreate(&taskID, &taskInitParam);
+}
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
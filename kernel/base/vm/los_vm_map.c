@@ -38,6 +38,9 @@
 #include "los_vm_common.h"
 #include "los_vm_filemap.h"
 #include "los_vm_shm_pri.h"
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
 #include "los_arch_mmu.h"
 #include "los_process_pri.h"
 #include "fs/fs.h"
@@ -51,6 +54,10 @@ extern "C" {
 #endif /* __cplusplus */
 
 #define VM_MAP_WASTE_MEM_LEVEL          (PAGE_SIZE >> 2) //	浪费内存等级(1K)
+#define VM_MAP_LARGE_PAGES              16 //一个64K大页包含的页数
+#define VM_VMAP_BLOCK_PAGES             64 //一个 vmap 块的页数
+#define VM_VMAP_BLOCK_ALLOC_MAX         8  //不超过这么多页的 vmalloc 从 vmap 块里切
+#define VM_VMAP_LAZY_PAGES_MAX          256 //攒够这么多页的释放才做一次TLB失效
 LosMux g_vmSpaceListMux;				//用于锁g_vmSpaceList的互斥量
 LOS_DL_LIST_HEAD(g_vmSpaceList);		//初始化全局虚拟空间节点,所有虚拟空间都挂到此节点上.
 LosVmSpace g_kVmSpace;					//内核空间地址
@@ -124,6 +131,41 @@ ULONG_T OsRegionRbCmpKeyFn(VOID *pNodeKeyA, VOID *pNodeKeyB)
     }
     return RB_EQUAL;
 }
+//红黑树增强:由节点自身和左右孩子汇总子树的最低起始地址,最高结束地址和最大空洞,旋转和增删节点时由红黑树回调
+VOID OsRegionRbAugmentFn(LosRbNode *pstNode)
+{
+    LosVmMapRegion *region = (LosVmMapRegion *)pstNode;
+    LosVmMapRegion *child = NULL;
+    VADDR_T last = LOS_RegionEndAddr(region);
+    size_t maxGap = 0;
+
+    region->subtreeStart = region->range.base;
+    region->subtreeLast = last;
+    if (RB_IS_NOT_NILT(pstNode->pstLeft)) {
+        child = (LosVmMapRegion *)pstNode->pstLeft;
+        region->subtreeStart = child->subtreeStart;
+        maxGap = child->subtreeMaxGap;
+        if ((child->subtreeLast < region->range.base) && ((region->range.base - child->subtreeLast - 1) > maxGap)) {
+            maxGap = region->range.base - child->subtreeLast - 1;
+        }
+        if (child->subtreeLast > region->subtreeLast) {
+            region->subtreeLast = child->subtreeLast;
+        }
+    }
+    if (RB_IS_NOT_NILT(pstNode->pstRight)) {
+        child = (LosVmMapRegion *)pstNode->pstRight;
+        if (child->subtreeMaxGap > maxGap) {
+            maxGap = child->subtreeMaxGap;
+        }
+        if ((child->subtreeStart > last) && ((child->subtreeStart - last - 1) > maxGap)) {
+            maxGap = child->subtreeStart - last - 1;
+        }
+        if (child->subtreeLast > region->subtreeLast) {
+            region->subtreeLast = child->subtreeLast;
+        }
+    }
+    region->subtreeMaxGap = maxGap;
+}
 /**************************************************************************
 初始化虚拟空间，必须提供L1表的虚拟内存地址
 VADDR_T *virtTtb:L1表的地址，TTB表地址
@@ -131,8 +173,21 @@ VADDR_T *virtTtb:L1表的地址，TTB表地址
 STATIC BOOL OsVmSpaceInitCommon(LosVmSpace *vmSpace, VADDR_T *virtTtb)
 {
     LOS_RbInitTree(&vmSpace->regionRbTree, OsRegionRbCmpKeyFn, OsRegionRbFreeFn, OsRegionRbGetKeyFn);//初始化虚拟存储空间-以红黑树组织方式
+    LOS_RbSetAugment(&vmSpace->regionRbTree, OsRegionRbAugmentFn);//每个节点记录子树的最大空洞,找空闲地址时不必全树遍历
 
     LOS_ListInit(&vmSpace->regions);//初始化虚拟存储区域-以双循环链表组织方式
+    OsRegionCacheFlush(vmSpace);
+    vmSpace->regionCacheNext = 0;
+    vmSpace->regionCacheHits = 0;
+    vmSpace->regionCacheMisses = 0;
+    vmSpace->defRegionFlags = 0;
+    LOS_AtomicSet(&vmSpace->refCount, 1);
+#ifdef LOSCFG_KERNEL_VM_KSM
+    vmSpace->ksmCursor = 0;
+#endif
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    vmSpace->swapCursor = 0;
+#endif
     status_t retval = LOS_MuxInit(&vmSpace->regionMux, NULL);//初始化互斥量
     if (retval != LOS_OK) {
         VM_ERR("Create mutex for vm space failed, status: %d", retval);
@@ -193,7 +248,20 @@ BOOL OsUserVmSpaceInit(LosVmSpace *vmSpace, VADDR_T *virtTtb)//用户空间的TT
     vmSpace->codeStart = 0;
     vmSpace->codeEnd = 0;
 #endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    vmSpace->charge = OsVmChargeCreate(0);//计费组,默认不限,fork/exec 时沿用原进程的上限
+    if (vmSpace->charge == NULL) {
+        return FALSE;
+    }
+    if (!OsVmSpaceInitCommon(vmSpace, virtTtb)) {
+        OsVmChargePut(vmSpace->charge);
+        vmSpace->charge = NULL;
+        return FALSE;
+    }
+    return TRUE;
+#else
     return OsVmSpaceInitCommon(vmSpace, virtTtb);
+#endif
 }
 //鸿蒙内核空间有两个(内核空间和内核堆空间),共用一张L1页表
 VOID OsKSpaceInit(VOID)
@@ -238,6 +306,35 @@ LosVmMapRegion *OsPrivateRegionClone(LosVmMapRegion *oldRegion)
     *newRegion = *oldRegion;
     return newRegion;
 }
+#ifdef LOSCFG_FS_VFS
+/**************************************************************************************************
+ fork后为子进程登记文件页的映射信息.按pgoff有序遍历一次文件的page_list,
+ 只登记子进程页表中确实映射到该文件页的地址(写时拷贝过的私有页不登记).
+**************************************************************************************************/
+STATIC VOID OsFileRegionCloneMapInfo(LosVmMapRegion *region, LosArchMmu *archMmu)
+{
+    UINT32 intSave;
+    VADDR_T vaddr;
+    PADDR_T paddr;
+    LosFilePage *fpage = NULL;
+    struct page_mapping *mapping = region->unTypeData.rf.file->f_mapping;
+    VM_OFFSET_T end = region->pgOff + (region->range.size >> PAGE_SHIFT);
+
+    LOS_SpinLockSave(&mapping->list_lock, &intSave);
+    LOS_DL_LIST_FOR_EACH_ENTRY(fpage, &mapping->page_list, LosFilePage, node) {
+        if (fpage->pgoff < region->pgOff) {
+            continue;
+        } else if (fpage->pgoff >= end) {
+            break;
+        }
+        vaddr = region->range.base + ((fpage->pgoff - region->pgOff) << PAGE_SHIFT);
+        if ((LOS_ArchMmuQuery(archMmu, vaddr, &paddr, NULL) == LOS_OK) && (paddr == fpage->vmPage->physAddr)) {
+            OsAddMapInfo(fpage, archMmu, vaddr);
+        }
+    }
+    LOS_SpinUnlockRestore(&mapping->list_lock, intSave);
+}
+#endif
 //虚拟内存空间克隆，被用于fork进程
 STATUS_T LOS_VmSpaceClone(LosVmSpace *oldVmSpace, LosVmSpace *newVmSpace)
 {
@@ -247,12 +344,6 @@ STATUS_T LOS_VmSpaceClone(LosVmSpace *oldVmSpace, LosVmSpace *newVmSpace)
     LosRbNode *pstRbNodeNext = NULL;
     STATUS_T ret = LOS_OK;
     UINT32 numPages;
-    PADDR_T paddr;
-    VADDR_T vaddr;
-    UINT32 intSave;
-    LosVmPage *page = NULL;
-    UINT32 flags;
-    UINT32 i;
 
     if ((OsVmSpaceParamCheck(oldVmSpace) == FALSE) || (OsVmSpaceParamCheck(newVmSpace) == FALSE)) {
         return LOS_ERRNO_VM_INVALID_ARGS;
@@ -266,6 +357,9 @@ STATUS_T LOS_VmSpaceClone(LosVmSpace *oldVmSpace, LosVmSpace *newVmSpace)
     newVmSpace->mapBase = oldVmSpace->mapBase;
     newVmSpace->heapBase = oldVmSpace->heapBase;
     newVmSpace->heapNow = oldVmSpace->heapNow;
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    OsVmChargeLimitInherit(newVmSpace, oldVmSpace);//子进程沿用上限;共享的写时拷贝页仍记在父进程名下,写时拷贝出的新页才记到子进程
+#endif
     (VOID)LOS_MuxAcquire(&oldVmSpace->regionMux);
     RB_SCAN_SAFE(&oldVmSpace->regionRbTree, pstRbNode, pstRbNodeNext)//红黑树循环开始
         oldRegion = (LosVmMapRegion *)pstRbNode;
@@ -276,6 +370,8 @@ STATUS_T LOS_VmSpaceClone(LosVmSpace *oldVmSpace, LosVmSpace *newVmSpace)
             goto ERR_CLONE_ASPACE;
         }
 
+        newRegion->regionFlags &= ~VM_MAP_REGION_FLAG_LOCKED;//mlock 不被子进程继承
+
         if (oldRegion->regionFlags & VM_MAP_REGION_FLAG_SHM) {//如果老线性区是共享内存
             OsShmFork(newVmSpace, oldRegion, newRegion);//fork共享线性区,如此新虚拟空间也能用那个线性区
             continue;//不往下走了,因为共享内存不需要重新映射,下面无非就是需要MMU映射虚拟地址<-->物理地址
@@ -286,34 +382,19 @@ STATUS_T LOS_VmSpaceClone(LosVmSpace *oldVmSpace, LosVmSpace *newVmSpace)
         }
 
         numPages = newRegion->range.size >> PAGE_SHIFT;//计算线性区页数
-        for (i = 0; i < numPages; i++) {//一页一页进行重新映射
-            vaddr = newRegion->range.base + (i << PAGE_SHIFT);
-            if (LOS_ArchMmuQuery(&oldVmSpace->archMmu, vaddr, &paddr, &flags) != LOS_OK) {//先查物理地址
-                continue;
-            }
-
-            page = LOS_VmPageGet(paddr);//通过物理页获取物理内存的页框
-            if (page != NULL) {
-                LOS_AtomicInc(&page->refCounts);//refCounts 自增
-            }
-            if (flags & VM_MAP_REGION_FLAG_PERM_WRITE) {//可写入区标签
-                LOS_ArchMmuUnmap(&oldVmSpace->archMmu, vaddr, 1);//取消老空间映射
-                LOS_ArchMmuMap(&oldVmSpace->archMmu, vaddr, paddr, 1, flags & ~VM_MAP_REGION_FLAG_PERM_WRITE);//老空间重新映射
-            }
-            LOS_ArchMmuMap(&newVmSpace->archMmu, vaddr, paddr, 1, flags & ~VM_MAP_REGION_FLAG_PERM_WRITE);//映射新空间
+        //整段复制页表项,父子两边可写页都改为只读,物理页引用计数加1
+        ret = LOS_ArchMmuCloneRange(&oldVmSpace->archMmu, &newVmSpace->archMmu, newRegion->range.base, numPages);
+        if (ret != LOS_OK) {
+            VM_ERR("clone region mapping failed, ret = %d", ret);
+            ret = LOS_ERRNO_VM_NO_MEMORY;
+            goto ERR_CLONE_ASPACE;
+        }
 
 #ifdef LOSCFG_FS_VFS //文件系统开关
-            if (LOS_IsRegionFileValid(oldRegion)) {//是都是一个文件映射线性区
-                LosFilePage *fpage = NULL;
-                LOS_SpinLockSave(&oldRegion->unTypeData.rf.file->f_mapping->list_lock, &intSave);
-                fpage = OsFindGetEntry(oldRegion->unTypeData.rf.file->f_mapping, newRegion->pgOff + i);
-                if ((fpage != NULL) && (fpage->vmPage == page)) { /* cow page no need map */
-                    OsAddMapInfo(fpage, &newVmSpace->archMmu, vaddr);//添加文件页映射,记录页面被进程映射过
-                }
-                LOS_SpinUnlockRestore(&oldRegion->unTypeData.rf.file->f_mapping->list_lock, intSave);
-            }
-#endif
+        if (LOS_IsRegionFileValid(oldRegion)) {//是都是一个文件映射线性区
+            OsFileRegionCloneMapInfo(newRegion, &newVmSpace->archMmu);//添加文件页映射,记录页面被进程映射过
         }
+#endif
     RB_SCAN_SAFE_END(&oldVmSpace->regionRbTree, pstRbNode, pstRbNodeNext)//红黑树循环结束
     goto OUT_CLONE_ASPACE;
 ERR_CLONE_ASPACE:
@@ -339,9 +420,34 @@ LosVmMapRegion *OsFindRegion(LosRbTree *regionRbTree, VADDR_T vaddr, size_t len)
     return regionRst;
 }
 
+/**************************************************************************************************
+ 通过地址查找线性区.查找缓存只在当前任务持有 regionMux 时使用和填写,
+ CheckRegion、异常打印等不持锁的调用者直接查红黑树,不会把并发释放的线性区留在缓存中.
+**************************************************************************************************/
 LosVmMapRegion *LOS_RegionFind(LosVmSpace *vmSpace, VADDR_T addr)
 {
-    return OsFindRegion(&vmSpace->regionRbTree, addr, 1);
+    LosVmMapRegion *region = NULL;
+    UINT32 index;
+
+    if (vmSpace->regionMux.owner != (VOID *)OsCurrTaskGet()) {
+        return OsFindRegion(&vmSpace->regionRbTree, addr, 1);
+    }
+
+    for (index = 0; index < VM_REGION_CACHE_SIZE; index++) {//缺页和系统调用的地址局部性很强,先查最近找到的线性区
+        region = vmSpace->regionCache[index];
+        if ((region != NULL) && (addr >= region->range.base) && (addr <= LOS_RegionEndAddr(region))) {
+            vmSpace->regionCacheHits++;
+            return region;
+        }
+    }
+
+    vmSpace->regionCacheMisses++;
+    region = OsFindRegion(&vmSpace->regionRbTree, addr, 1);
+    if (region != NULL) {
+        vmSpace->regionCache[vmSpace->regionCacheNext] = region;
+        vmSpace->regionCacheNext = (vmSpace->regionCacheNext + 1) % VM_REGION_CACHE_SIZE;
+    }
+    return region;
 }
 
 LosVmMapRegion *LOS_RegionRangeFind(LosVmSpace *vmSpace, VADDR_T addr, size_t len)
@@ -349,53 +455,68 @@ LosVmMapRegion *LOS_RegionRangeFind(LosVmSpace *vmSpace, VADDR_T addr, size_t le
     return OsFindRegion(&vmSpace->regionRbTree, addr, len);
 }
 
-VADDR_T OsAllocRange(LosVmSpace *vmSpace, size_t len)
+//[curEnd, nextStart) 空洞中按 align 对齐后能否放下 len,能则返回对齐后的起始地址
+STATIC INLINE VADDR_T OsRangeFit(VADDR_T curEnd, VADDR_T nextStart, size_t len, size_t align)
 {
-    LosVmMapRegion *curRegion = NULL;
-    LosRbNode *pstRbNode = NULL;
-    LosRbNode *pstRbNodeTmp = NULL;
-    LosRbTree *regionRbTree = &vmSpace->regionRbTree;
-    VADDR_T curEnd = vmSpace->mapBase;
-    VADDR_T nextStart;
-
-    curRegion = LOS_RegionFind(vmSpace, vmSpace->mapBase);
-    if (curRegion != NULL) {
-        pstRbNode = &curRegion->rbNode;
-        curEnd = curRegion->range.base + curRegion->range.size;
-        RB_MID_SCAN(regionRbTree, pstRbNode)
-            curRegion = (LosVmMapRegion *)pstRbNode;
-            nextStart = curRegion->range.base;
-            if (nextStart < curEnd) {
-                continue;
-            }
-            if ((nextStart - curEnd) >= len) {
-                return curEnd;
-            } else {
-                curEnd = curRegion->range.base + curRegion->range.size;
-            }
-        RB_MID_SCAN_END(regionRbTree, pstRbNode)
-    } else {//红黑树扫描排序，从小到大
-        /* rbtree scan is sorted, from small to big */
-        RB_SCAN_SAFE(regionRbTree, pstRbNode, pstRbNodeTmp)
-            curRegion = (LosVmMapRegion *)pstRbNode;
-            nextStart = curRegion->range.base;
-            if (nextStart < curEnd) {
-                continue;
-            }
-            if ((nextStart - curEnd) >= len) {
-                return curEnd;
-            } else {
-                curEnd = curRegion->range.base + curRegion->range.size;
-            }
-        RB_SCAN_SAFE_END(regionRbTree, pstRbNode, pstRbNodeTmp)
+    VADDR_T start = ROUNDUP(curEnd, align);
+
+    if ((start >= curEnd) && (nextStart >= start) && ((nextStart - start) >= len)) {
+        return start;
+    }
+    return 0;
+}
+/**************************************************************************
+ 按地址从小到大在子树中找第一个放得下 len 的空洞(first fit).
+ *freeStart 为子树之前最后一个线性区的结束地址+1(不低于mapBase),随扫描前移.
+ 子树内最大空洞和子树前的空洞都放不下时整棵子树跳过,所以只沿 O(log n) 条路径下降.
+**************************************************************************/
+STATIC VADDR_T OsRegionGapSearch(LosRbNode *pstNode, size_t len, size_t align, VADDR_T *freeStart)
+{
+    LosVmMapRegion *region = (LosVmMapRegion *)pstNode;
+    VADDR_T start;
+
+    if (!RB_IS_NOT_NILT(pstNode) || (region->subtreeLast < *freeStart)) {//空子树或整棵都在已扫描范围之下
+        return 0;
     }
 
-    nextStart = vmSpace->mapBase + vmSpace->mapSize;
-    if ((nextStart - curEnd) >= len) {
-        return curEnd;
+    if ((region->subtreeMaxGap < len) && (OsRangeFit(*freeStart, region->subtreeStart, len, align) == 0)) {
+        *freeStart = region->subtreeLast + 1;
+        return 0;
     }
 
-    return 0;
+    start = OsRegionGapSearch(pstNode->pstLeft, len, align, freeStart);
+    if (start != 0) {
+        return start;
+    }
+
+    start = OsRangeFit(*freeStart, region->range.base, len, align);
+    if (start != 0) {
+        return start;
+    }
+    if (LOS_RegionEndAddr(region) >= *freeStart) {
+        *freeStart = LOS_RegionEndAddr(region) + 1;
+    }
+
+    return OsRegionGapSearch(pstNode->pstRight, len, align, freeStart);
+}
+//在空间中找一段按 align 对齐的空闲虚拟地址,vmalloc用64K对齐好让arch层映射成大页
+VADDR_T OsAllocRangeAlign(LosVmSpace *vmSpace, size_t len, size_t align)
+{
+    VADDR_T freeStart = vmSpace->mapBase;
+    VADDR_T mapEnd = vmSpace->mapBase + vmSpace->mapSize;
+    VADDR_T start;
+
+    start = OsRegionGapSearch(vmSpace->regionRbTree.pstRoot, len, align, &freeStart);
+    if (start != 0) {
+        return ((len <= vmSpace->mapSize) && ((start - vmSpace->mapBase) <= (vmSpace->mapSize - len))) ? start : 0;
+    }
+
+    return OsRangeFit(freeStart, mapEnd, len, align);
+}
+
+VADDR_T OsAllocRange(LosVmSpace *vmSpace, size_t len)
+{
+    return OsAllocRangeAlign(vmSpace, len, PAGE_SIZE);
 }
 
 VADDR_T OsAllocSpecificRange(LosVmSpace *vmSpace, VADDR_T vaddr, size_t len)
@@ -439,6 +560,7 @@ BOOL OsInsertRegion(LosRbTree *regionRbTree, LosVmMapRegion *region)
         OsDumpAspace(region->space);
         return FALSE;
     }
+    OsRegionCacheFlush(region->space);
     return TRUE;
 }
 //创建一个线性区
@@ -538,7 +660,11 @@ OUT:
 STATIC VOID OsAnonPagesRemove(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 count)
 {
     status_t status;
-    paddr_t paddr;
+    paddr_t paddr[VM_MAP_LARGE_PAGES];
+    UINT32 mapped;
+    BOOL swapped = FALSE;
+    UINT32 batch;
+    UINT32 index;
     LosVmPage *page = NULL;
 
     if ((archMmu == NULL) || (vaddr == 0) || (count == 0)) {
@@ -546,23 +672,36 @@ STATIC VOID OsAnonPagesRemove(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 count)
         return;
     }
 
-    while (count > 0) {//一页页操作
-        count--;
-        status = LOS_ArchMmuQuery(archMmu, vaddr, &paddr, NULL);//通过虚拟地址拿到物理地址
-        if (status != LOS_OK) {//失败，拿下一页的物理地址
-            vaddr += PAGE_SIZE;
-            continue;
+    while (count > 0) {//按64K一批操作,整批一次解除映射,完整覆盖的大页不必先拆成小页
+        batch = MIN2(count, VM_MAP_LARGE_PAGES - ((vaddr >> PAGE_SHIFT) % VM_MAP_LARGE_PAGES));
+        mapped = 0;
+        swapped = FALSE;
+        for (index = 0; index < batch; index++) {
+            status = LOS_ArchMmuQuery(archMmu, vaddr + (index << PAGE_SHIFT), &paddr[index], NULL);//通过虚拟地址拿到物理地址
+            if (status == LOS_OK) {
+                mapped |= 1U << index;
+            }
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+            else if (LOS_ArchMmuSwapEntryGet(archMmu, vaddr + (index << PAGE_SHIFT), NULL) == LOS_OK) {
+                swapped = TRUE;//换出的页没有物理页,解除映射时释放其交换槽位
+            }
+#endif
         }
 
-        LOS_ArchMmuUnmap(archMmu, vaddr, 1);//解除一页的映射
-
-        page = LOS_VmPageGet(paddr);//通过物理地址获取所在物理页框的起始地址
-        if (page != NULL) {//获取成功
-            if (!OsIsPageShared(page)) {//不是共享页，共享页会有专门的共享标签，共享本质是有无多个进程对该页的引用
-                LOS_PhysPageFree(page);//释放物理页框
+        if ((mapped != 0) || swapped) {
+            LOS_ArchMmuUnmap(archMmu, vaddr, batch);//先解除整批的映射,再释放物理页
+            for (index = 0; index < batch; index++) {
+                if (!(mapped & (1U << index))) {
+                    continue;
+                }
+                page = LOS_VmPageGet(paddr[index]);//通过物理地址获取所在物理页框的起始地址
+                if ((page != NULL) && !OsIsPageShared(page)) {//不是共享页，共享页会有专门的共享标签，共享本质是有无多个进程对该页的引用
+                    LOS_PhysPageFree(page);//释放物理页框
+                }
             }
         }
-        vaddr += PAGE_SIZE;
+        vaddr += batch << PAGE_SHIFT;
+        count -= batch;
     }
 }
 
@@ -628,11 +767,55 @@ STATUS_T LOS_RegionFree(LosVmSpace *space, LosVmMapRegion *region)
 
     /* remove it from space */
     LOS_RbDelNode(&space->regionRbTree, &region->rbNode);
+    OsRegionCacheFlush(space);
     /* free it */
     LOS_MemFree(m_aucSysMem0, region);
     (VOID)LOS_MuxRelease(&space->regionMux);
     return LOS_OK;
 }
+/**************************************************************************************************
+ 释放线性区中 [vaddr, vaddr + size) 的页,线性区本身保留,madvise(MADV_DONTNEED) 使用
+ 匿名页直接释放,再次访问时缺页得到清0的新页;文件页只解除映射,脏页先回写,再次访问时从页高速缓存重新映射.
+ 共享内存和设备线性区的页不归本线性区所有,不能释放.
+**************************************************************************************************/
+STATUS_T OsRegionPagesRelease(LosVmSpace *space, LosVmMapRegion *region, VADDR_T vaddr, size_t size)
+{
+    STATUS_T ret = LOS_OK;
+#ifdef LOSCFG_FS_VFS
+    VM_OFFSET_T pgoff;
+#endif
+
+    if ((space == NULL) || (region == NULL) || !IS_ALIGNED(vaddr, PAGE_SIZE) || !IS_ALIGNED(size, PAGE_SIZE) ||
+        (vaddr < region->range.base) || ((vaddr + size) > (region->range.base + region->range.size))) {
+        return LOS_ERRNO_VM_INVALID_ARGS;
+    }
+
+    (VOID)LOS_MuxAcquire(&space->regionMux);
+#ifdef LOSCFG_FS_VFS
+    if (LOS_IsRegionFileValid(region)) {
+        if (region->unTypeData.rf.vmFOps == NULL) {
+            goto OUT;
+        }
+        pgoff = region->pgOff + ((vaddr - region->range.base) >> PAGE_SHIFT);
+        while (size >= PAGE_SIZE) {
+            region->unTypeData.rf.vmFOps->remove(region, &space->archMmu, pgoff);
+            pgoff++;
+            size -= PAGE_SIZE;
+        }
+    } else
+#endif
+    if (OsIsShmRegion(region) || LOS_IsRegionTypeDev(region)) {
+        ret = LOS_ERRNO_VM_INVALID_ARGS;
+    } else if (size != 0) {
+        OsAnonPagesRemove(&space->archMmu, vaddr, size >> PAGE_SHIFT);
+    }
+
+#ifdef LOSCFG_FS_VFS
+OUT:
+#endif
+    (VOID)LOS_MuxRelease(&space->regionMux);
+    return ret;
+}
 
 LosVmMapRegion *OsVmRegionDup(LosVmSpace *space, LosVmMapRegion *oldRegion, VADDR_T vaddr, size_t size)
 {
@@ -654,6 +837,7 @@ LosVmMapRegion *OsVmRegionDup(LosVmSpace *space, LosVmMapRegion *oldRegion, VADD
         newRegion->unTypeData.rf.vmFOps = oldRegion->unTypeData.rf.vmFOps;
         newRegion->unTypeData.rf.file = oldRegion->unTypeData.rf.file;
         newRegion->unTypeData.rf.fileMagic = oldRegion->unTypeData.rf.fileMagic;
+        newRegion->unTypeData.rf.readahead = oldRegion->unTypeData.rf.readahead;
     }
 #endif
 
@@ -669,6 +853,7 @@ STATIC LosVmMapRegion *OsVmRegionSplit(LosVmMapRegion *oldRegion, VADDR_T newReg
     size_t size = LOS_RegionSize(newRegionStart, LOS_RegionEndAddr(oldRegion));
 
     LOS_RbDelNode(&space->regionRbTree, &oldRegion->rbNode);
+    OsRegionCacheFlush(space);
     oldRegion->range.size = LOS_RegionSize(oldRegion->range.base, newRegionStart - 1);
     if (oldRegion->range.size != 0) {
         LOS_RbAddNode(&space->regionRbTree, &oldRegion->rbNode);
@@ -782,6 +967,11 @@ INT32 OsUserHeapFree(LosVmSpace *vmSpace, VADDR_T addr, size_t len)
                 vmPage = LOS_VmPageGet(paddr);//获取物理页面信息
                 LOS_PhysPageFree(vmPage);//释放页
             }
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+            else if (LOS_ArchMmuSwapEntryGet(&vmSpace->archMmu, vaddr, NULL) == LOS_OK) {
+                (VOID)LOS_ArchMmuUnmap(&vmSpace->archMmu, vaddr, 1);//已换出的页只需释放交换槽位
+            }
+#endif
             vaddr += PAGE_SIZE;
             len -= PAGE_SIZE;
         }
@@ -829,6 +1019,23 @@ ERR_REGION_SPLIT:
     (VOID)LOS_MuxRelease(&space->regionMux);
     return status;
 }
+//多一个进程在空间中运行,CLONE_VM/vfork 的子进程借用父进程空间时调用
+VOID OsVmSpaceGet(LosVmSpace *space)
+{
+    LOS_AtomicInc(&space->refCount);
+}
+//进程退出或 exec 时放下空间,最后一个进程放下时才释放
+STATUS_T OsVmSpacePut(LosVmSpace *space)
+{
+    if (space == NULL) {
+        return LOS_ERRNO_VM_INVALID_ARGS;
+    }
+
+    if (LOS_AtomicDecRet(&space->refCount) != 0) {
+        return LOS_OK;
+    }
+    return LOS_VmSpaceFree(space);
+}
 //释放虚拟空间,注意内核空间不能被释放掉,永驻内存
 STATUS_T LOS_VmSpaceFree(LosVmSpace *space)
 {
@@ -846,9 +1053,11 @@ STATUS_T LOS_VmSpaceFree(LosVmSpace *space)
         return LOS_OK;
     }
 
-    /* pop it out of the global aspace list */
-    (VOID)LOS_MuxAcquire(&space->regionMux);
+    /* pop it out of the global aspace list, walkers of the list hold g_vmSpaceListMux */
+    (VOID)LOS_MuxAcquire(&g_vmSpaceListMux);
     LOS_ListDelete(&space->node);//从g_vmSpaceList链表里删除，g_vmSpaceList记录了所有空间节点。
+    (VOID)LOS_MuxRelease(&g_vmSpaceListMux);
+    (VOID)LOS_MuxAcquire(&space->regionMux);
     /* free all of the regions */
     RB_SCAN_SAFE(&space->regionRbTree, pstRbNode, pstRbNodeNext)//释放空间中所有线性区 ，RB_SCAN_SAFE是个for循环宏
         region = (LosVmMapRegion *)pstRbNode;
@@ -876,6 +1085,11 @@ STATUS_T LOS_VmSpaceFree(LosVmSpace *space)
 
     (VOID)LOS_MuxRelease(&space->regionMux);
     (VOID)LOS_MuxDestroy(&space->regionMux);
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    /* pages still charged, e.g. page cache, keep the group until they are freed */
+    OsVmChargePut(space->charge);
+    space->charge = NULL;
+#endif
 
     /* free the aspace */
     LOS_MemFree(m_aucSysMem0, space);
@@ -1036,6 +1250,207 @@ VMM_ALLOC_SUCCEED:
     (VOID)LOS_MuxRelease(&space->regionMux);
     return err;
 }
+//vmalloc的物理页先按64K连续块申请(页框各自独立计数,可以单页释放),不够或失败时再一页页申请
+STATIC size_t OsVmallocPagesAlloc(size_t nPages, LOS_DL_LIST *list)
+{
+    size_t count = 0;
+    UINT32 index;
+    VOID *kvaddr = NULL;
+    LosVmPage *vmPage = NULL;
+
+    while ((nPages - count) >= VM_MAP_LARGE_PAGES) {
+        kvaddr = LOS_PhysPagesAllocContiguous(VM_MAP_LARGE_PAGES);
+        if (kvaddr == NULL) {
+            break;
+        }
+        vmPage = OsVmVaddrToPage(kvaddr);
+        for (index = 0; index < VM_MAP_LARGE_PAGES; index++) {
+            LOS_AtomicSet(&vmPage[index].refCounts, 0);
+            LOS_ListTailInsert(list, &vmPage[index].node);
+        }
+        count += VM_MAP_LARGE_PAGES;
+    }
+
+    return count + LOS_PhysPagesAlloc(nPages - count, list);
+}
+/**************************************************************************************************
+ vmalloc 的惰性清理:释放时只清页表项并归还物理页,线性区打上 PURGE 标签留在空间里占住地址,
+ 攒够 VM_VMAP_LAZY_PAGES_MAX 页或地址不够用时,一次TLB失效后统一归还,多次释放只付一次失效的代价.
+ 小的申请从每个CPU当前的 vmap 块里顺序切分,不必每次都分配线性区,插入和删除红黑树;
+ 块内的页全部释放后整块进入惰性清理.内核空间共用L1表,改页表仍需持有 g_vMallocSpace.regionMux,
+ 以下全局量都由它保护.
+**************************************************************************************************/
+typedef struct {
+    LOS_DL_LIST         node;           /**< vmap block dl list */	//挂在 g_vmapBlockList 上
+    LosVmMapRegion      *region;        /**< region reserving the va of the block */	//块占用的线性区
+    UINT32              used;           /**< pages handed out, only grows */	//已切出的页数,只增不减
+    UINT32              freed;          /**< pages given back */	//已释放的页数,等于块大小时整块清理
+    UINT8               nPages[VM_VMAP_BLOCK_PAGES];    /**< size of the allocation starting at each page */
+} VmVmapBlock;
+
+STATIC VmVmapBlock *g_vmapCpuBlock[LOSCFG_KERNEL_CORE_NUM];  //每个CPU正在切分的块
+STATIC LOS_DL_LIST_HEAD(g_vmapBlockList);                   //还有页没释放的块
+STATIC LOS_DL_LIST_HEAD(g_vmapLazyList);                    //等待清理的线性区,经 region->node 挂入
+STATIC UINT32 g_vmapLazyPages;                              //等待清理的页数
+
+//一次TLB失效后归还所有等待清理的线性区
+STATIC VOID OsVmallocLazyPurge(LosVmSpace *space)
+{
+    LosVmMapRegion *region = NULL;
+    LosVmMapRegion *next = NULL;
+
+    if (LOS_ListEmpty(&g_vmapLazyList)) {
+        return;
+    }
+
+    LOS_ArchMmuTlbFlush(&space->archMmu);
+    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(region, next, &g_vmapLazyList, LosVmMapRegion, node) {
+        LOS_ListDelete(&region->node);
+        LOS_RbDelNode(&space->regionRbTree, &region->rbNode);
+        LOS_MemFree(m_aucSysMem0, region);
+    }
+    OsRegionCacheFlush(space);
+    g_vmapLazyPages = 0;
+}
+//解除映射的线性区挂入惰性清理列表,攒够了就清理
+STATIC VOID OsVmallocLazyAdd(LosVmSpace *space, LosVmMapRegion *region)
+{
+    region->regionFlags |= VM_MAP_REGION_FLAG_PURGE;
+    LOS_ListTailInsert(&g_vmapLazyList, &region->node);
+    g_vmapLazyPages += region->range.size >> PAGE_SHIFT;
+    if (g_vmapLazyPages >= VM_VMAP_LAZY_PAGES_MAX) {
+        OsVmallocLazyPurge(space);
+    }
+}
+//分配 vmalloc 线性区,地址不够时先清理惰性列表再试一次
+STATIC LosVmMapRegion *OsVmallocRegionAlloc(LosVmSpace *space, size_t size)
+{
+    LosVmMapRegion *region = NULL;
+    VADDR_T va = 0;//注意 vaddr = 0 时由 LOS_RegionAlloc 自己挑地址
+    UINT32 retry;
+
+    for (retry = 0; retry < 2; retry++) {//第二次是清理惰性列表之后
+        if ((size >> PAGE_SHIFT) >= VM_MAP_LARGE_PAGES) {//够一个大页时尽量挑64K对齐的虚拟地址
+            va = OsAllocRangeAlign(space, size, VM_MAP_LARGE_PAGES << PAGE_SHIFT);
+        }
+        region = LOS_RegionAlloc(space, va, size, VM_MAP_REGION_FLAG_PERM_READ | VM_MAP_REGION_FLAG_PERM_WRITE, 0);
+        if ((region != NULL) || LOS_ListEmpty(&g_vmapLazyList)) {
+            break;
+        }
+        OsVmallocLazyPurge(space);
+    }
+    return region;
+}
+//块内的页释放了 nPages 页,全部释放后整块的地址进入惰性清理
+STATIC VOID OsVmapBlockPut(LosVmSpace *space, VmVmapBlock *block, UINT32 nPages)
+{
+    block->freed += nPages;
+    if (block->freed < VM_VMAP_BLOCK_PAGES) {
+        return;
+    }
+    LOS_ListDelete(&block->node);
+    OsVmallocLazyAdd(space, block->region);
+    LOS_MemFree(m_aucSysMem0, block);
+}
+//从当前CPU的块里切出 nPages 页地址,块不够时换一个新块,旧块剩下的页按已释放计
+STATIC VADDR_T OsVmapBlockAlloc(LosVmSpace *space, UINT32 nPages)
+{
+    UINT32 cpuid = ArchCurrCpuid();
+    VmVmapBlock *block = g_vmapCpuBlock[cpuid];
+    VADDR_T va;
+
+    if ((block != NULL) && ((block->used + nPages) > VM_VMAP_BLOCK_PAGES)) {
+        g_vmapCpuBlock[cpuid] = NULL;
+        OsVmapBlockPut(space, block, VM_VMAP_BLOCK_PAGES - block->used);
+        block = NULL;
+    }
+    if (block == NULL) {
+        block = (VmVmapBlock *)LOS_MemAlloc(m_aucSysMem0, sizeof(VmVmapBlock));
+        if (block == NULL) {
+            return 0;
+        }
+        (VOID)memset_s(block, sizeof(VmVmapBlock), 0, sizeof(VmVmapBlock));
+        block->region = OsVmallocRegionAlloc(space, VM_VMAP_BLOCK_PAGES << PAGE_SHIFT);
+        if (block->region == NULL) {
+            LOS_MemFree(m_aucSysMem0, block);
+            return 0;
+        }
+        LOS_ListAdd(&g_vmapBlockList, &block->node);
+        g_vmapCpuBlock[cpuid] = block;
+    }
+
+    va = block->region->range.base + (block->used << PAGE_SHIFT);
+    block->nPages[block->used] = (UINT8)nPages;
+    block->used += nPages;
+    if (block->used == VM_VMAP_BLOCK_PAGES) {//切完的块不再是当前块,释放完就可以清理
+        g_vmapCpuBlock[cpuid] = NULL;
+    }
+    return va;
+}
+//找到 va 所在的 vmap 块
+STATIC VmVmapBlock *OsVmapBlockFind(VADDR_T va)
+{
+    VmVmapBlock *block = NULL;
+
+    LOS_DL_LIST_FOR_EACH_ENTRY(block, &g_vmapBlockList, VmVmapBlock, node) {
+        if ((va >= block->region->range.base) &&
+            (va < (block->region->range.base + (VM_VMAP_BLOCK_PAGES << PAGE_SHIFT)))) {
+            return block;
+        }
+    }
+    return NULL;
+}
+//物理上连续的一段只map一次,对齐的段由arch层映射成64K大页或1M section
+STATIC VOID OsVmallocMap(LosVmSpace *space, VADDR_T va, LOS_DL_LIST *pageList)
+{
+    LosVmPage *vmPage = NULL;
+    PADDR_T pa = 0;
+    size_t count = 0;
+    STATUS_T ret;
+
+    while (TRUE) {
+        vmPage = LOS_ListRemoveHeadType(pageList, LosVmPage, node);//从pageList循环拿page
+        if ((vmPage != NULL) && (count != 0) && (vmPage->physAddr == pa + (count << PAGE_SHIFT))) {
+            LOS_AtomicInc(&vmPage->refCounts);//refCounts 自增
+            count++;
+            continue;
+        }
+        if (count != 0) {
+            ret = LOS_ArchMmuMap(&space->archMmu, va, pa, count,
+                                 VM_MAP_REGION_FLAG_PERM_READ | VM_MAP_REGION_FLAG_PERM_WRITE);
+            if (ret != (STATUS_T)count) {
+                VM_ERR("LOS_ArchMmuMap failed!, err;%d", ret);
+            }
+            va += count << PAGE_SHIFT;
+        }
+        if (vmPage == NULL) {
+            break;
+        }
+        LOS_AtomicInc(&vmPage->refCounts);
+        pa = vmPage->physAddr;
+        count = 1;
+    }//va 注意 region的虚拟地址页是连续的，但物理页可以不连续! 很重要！！！
+}
+//清掉 [va, va + count页) 的页表项并归还物理页,TLB留给惰性清理统一失效,这段地址在那之前不会被重新使用
+STATIC VOID OsVmallocUnmap(LosVmSpace *space, VADDR_T va, UINT32 count)
+{
+    LOS_DL_LIST_HEAD(pageList);
+    LosVmPage *vmPage = NULL;
+    PADDR_T pa;
+    UINT32 index;
+
+    for (index = 0; index < count; index++) {
+        if (LOS_ArchMmuQuery(&space->archMmu, va + (index << PAGE_SHIFT), &pa, NULL) != LOS_OK) {
+            continue;
+        }
+        vmPage = LOS_VmPageGet(pa);
+        if (vmPage != NULL) {
+            LOS_ListTailInsert(&pageList, &vmPage->node);
+        }
+    }
+    (VOID)LOS_ArchMmuUnmapNoFlush(&space->archMmu, va, count);
+    (VOID)LOS_PhysPagesFree(&pageList);
+}
 //对外接口|申请内核堆空间内存
 VOID *LOS_VMalloc(size_t size)//从g_vMallocSpace中申请物理内存
 {
@@ -1043,10 +1458,7 @@ VOID *LOS_VMalloc(size_t size)//从g_vMallocSpace中申请物理内存
     LosVmMapRegion *region = NULL;
     size_t sizeCount;
     size_t count;
-    LosVmPage *vmPage = NULL;
-    VADDR_T va;
-    PADDR_T pa;
-    STATUS_T ret;
+    VADDR_T va = 0;
 
     size = LOS_Align(size, PAGE_SIZE);//
     if ((size == 0) || (size > space->size)) {
@@ -1057,44 +1469,43 @@ VOID *LOS_VMalloc(size_t size)//从g_vMallocSpace中申请物理内存
     LOS_DL_LIST_HEAD(pageList);
     (VOID)LOS_MuxAcquire(&space->regionMux);//获得互斥锁
 
-    count = LOS_PhysPagesAlloc(sizeCount, &pageList);//一页一页申请，并从pageList尾部插入
+    count = OsVmallocPagesAlloc(sizeCount, &pageList);//先按64K连续块申请，不够再一页一页申请
     if (count < sizeCount) {
         VM_ERR("failed to allocate enough pages (ask %zu, got %zu)", sizeCount, count);
         goto ERROR;
     }
 
-    /* allocate a region and put it in the aspace list *///分配一个可读写的线性区，并挂在space
-    region = LOS_RegionAlloc(space, 0, size, VM_MAP_REGION_FLAG_PERM_READ | VM_MAP_REGION_FLAG_PERM_WRITE, 0);//注意第二个参数是 vaddr = 0 !!!
-    if (region == NULL) {
-        VM_ERR("alloc region failed, size = %x", size);
-        goto ERROR;
+    if (sizeCount <= VM_VMAP_BLOCK_ALLOC_MAX) {//小块从当前CPU的 vmap 块里切
+        va = OsVmapBlockAlloc(space, sizeCount);
     }
-
-    va = region->range.base;//va 该区范围基地址为虚拟地址的开始位置，理解va怎么来的是理解线性地址的关键！
-    while ((vmPage = LOS_ListRemoveHeadType(&pageList, LosVmPage, node))) {//从pageList循环拿page
-        pa = vmPage->physAddr;//获取page物理地址，因上面是通过LOS_PhysPagesAlloc分配
-        LOS_AtomicInc(&vmPage->refCounts);//refCounts 自增
-        ret = LOS_ArchMmuMap(&space->archMmu, va, pa, 1, region->regionFlags);//一页一页的map
-        if (ret != 1) {
-            VM_ERR("LOS_ArchMmuMap failed!, err;%d", ret);
+    if (va == 0) {
+        /* allocate a region and put it in the aspace list *///分配一个可读写的线性区，并挂在space
+        region = OsVmallocRegionAlloc(space, size);
+        if (region == NULL) {
+            VM_ERR("alloc region failed, size = %x", size);
+            goto ERROR;
         }
-        va += PAGE_SIZE;//一页映射完成，进入下一页
-    }//va 注意 region的虚拟地址页是连续的，但物理页可以不连续! 很重要！！！
+        va = region->range.base;//va 该区范围基地址为虚拟地址的开始位置，理解va怎么来的是理解线性地址的关键！
+    }
 
+    OsVmallocMap(space, va, &pageList);
     (VOID)LOS_MuxRelease(&space->regionMux);//释放互斥锁
-    return (VOID *)(UINTPTR)region->range.base;//返回虚拟基地址供应用使用
+    return (VOID *)(UINTPTR)va;//返回虚拟基地址供应用使用
 
 ERROR:
     (VOID)LOS_PhysPagesFree(&pageList);//释放物理内存页
     (VOID)LOS_MuxRelease(&space->regionMux);//释放互斥锁
     return NULL;
 }
-//对外接口|释放内核堆空间内存
+//对外接口|释放内核堆空间内存,只清页表项,TLB失效和地址归还攒到惰性清理时一起做
 VOID LOS_VFree(const VOID *addr)
 {
     LosVmSpace *space = &g_vMallocSpace;
     LosVmMapRegion *region = NULL;
-    STATUS_T ret;
+    VmVmapBlock *block = NULL;
+    VADDR_T va = (VADDR_T)(UINTPTR)addr;
+    UINT32 index;
+    UINT32 nPages;
 
     if (addr == NULL) {
         VM_ERR("addr is NULL!");
@@ -1103,17 +1514,29 @@ VOID LOS_VFree(const VOID *addr)
 
     (VOID)LOS_MuxAcquire(&space->regionMux);
 
-    region = LOS_RegionFind(space, (VADDR_T)(UINTPTR)addr);//先找到线性区
-    if (region == NULL) {
-        VM_ERR("find region failed");
+    block = OsVmapBlockFind(va);
+    if (block != NULL) {
+        index = (va - block->region->range.base) >> PAGE_SHIFT;
+        nPages = block->nPages[index];
+        if (nPages == 0) {
+            VM_ERR("free invalid vmap addr %#x", va);
+            goto DONE;
+        }
+        block->nPages[index] = 0;
+        OsVmallocUnmap(space, va, nPages);
+        OsVmapBlockPut(space, block, nPages);
         goto DONE;
     }
 
-    ret = LOS_RegionFree(space, region);//释放线性区
-    if (ret) {
-        VM_ERR("free region failed, ret = %d", ret);
+    region = LOS_RegionFind(space, va);//先找到线性区
+    if ((region == NULL) || (region->regionFlags & VM_MAP_REGION_FLAG_PURGE)) {//已释放过的区还在等待清理
+        VM_ERR("find region failed");
+        goto DONE;
     }
 
+    OsVmallocUnmap(space, region->range.base, region->range.size >> PAGE_SHIFT);
+    OsVmallocLazyAdd(space, region);
+
 DONE:
     (VOID)LOS_MuxRelease(&space->regionMux);
 }
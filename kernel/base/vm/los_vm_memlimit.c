@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**************************************************************************************************
+ 进程驻留内存上限
+ 以前没有按进程的约束,一个泄漏的进程吃光内存后,页高速缓存回收和 OOM 查杀都落到板子上其他进程头上.
+ 这里给每个用户空间一个计费组(LosVmCharge),分配物理页的地方把页记在当前空间名下,页框最后一次释放时退费.
+ 计费组用引用计数管理:空间持有一个,每个计费页各持一个,进程退出后留在页缓存里的文件页仍能正确退费.
+ 超限时回收只挑本组的页(OsTryShrinkChargeMemory),回收不够则本次分配失败,由缺页流程按无内存处理.
+ 页高速缓存的页在 mapping 自旋锁下分配,那里不能回收,允许超出上限至多 VM_MEMLIMIT_NORECLAIM_SLACK 页,
+ 超出的部分由本进程下一次可回收的记账还上,再多则分配失败.
+**************************************************************************************************/
+#include "los_vm_memlimit.h"
+#include "los_vm_common.h"
+#include "los_memory.h"
+#include "securec.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+//创建计费组,返回时带着调用者(虚拟空间)的引用
+LosVmCharge *OsVmChargeCreate(UINT32 limit)
+{
+    LosVmCharge *charge = (LosVmCharge *)LOS_MemAlloc(m_aucSysMem0, sizeof(LosVmCharge));
+    if (charge == NULL) {
+        return NULL;
+    }
+
+    (VOID)memset_s(charge, sizeof(LosVmCharge), 0, sizeof(LosVmCharge));
+    charge->limit = limit;
+    LOS_AtomicSet(&charge->refCount, 1);
+    return charge;
+}
+//放下一个引用,空间已释放且名下的页都退费后计费组随之释放
+VOID OsVmChargePut(LosVmCharge *charge)
+{
+    if ((charge != NULL) && (LOS_AtomicDecRet(&charge->refCount) == 0)) {
+        LOS_MemFree(m_aucSysMem0, charge);
+    }
+}
+//用量低于 max 时占用一页,检查和加一是一次比较交换,多个线程同时记账也不会越过 max; max 为0表示不限
+STATIC BOOL OsVmChargeTryReserve(LosVmCharge *charge, UINT32 max, UINT32 *usage)
+{
+    INT32 old;
+
+    do {
+        old = LOS_AtomicRead(&charge->usage);
+        if ((max != 0) && ((UINT32)old >= max)) {
+            return FALSE;
+        }
+    } while (LOS_AtomicCmpXchg32bits(&charge->usage, old + 1, old));
+
+    *usage = (UINT32)old + 1;
+    return TRUE;
+}
+/**************************************************************************************************
+ 把新分配的页记到 space 名下,超限时返回 LOS_ERRNO_VM_NO_MEMORY,页由调用者释放.内核空间没有计费组,直接返回成功
+ mayReclaim 为 TRUE 时超限先在本组内回收再试一次;为 FALSE 时(调用者持有自旋锁)不能回收,
+ 允许超出上限至多 VM_MEMLIMIT_NORECLAIM_SLACK 页.
+**************************************************************************************************/
+STATUS_T OsVmPageCharge(LosVmSpace *space, LosVmPage *page, BOOL mayReclaim)
+{
+    LosVmCharge *charge = NULL;
+    UINT32 limit;
+    UINT32 usage;
+
+    if ((space == NULL) || (page == NULL) || (space->charge == NULL) || (page->charge != NULL)) {
+        return LOS_OK;
+    }
+
+    charge = space->charge;
+    limit = charge->limit;
+    if (!mayReclaim) {
+        if (!OsVmChargeTryReserve(charge, (limit != 0) ? (limit + VM_MEMLIMIT_NORECLAIM_SLACK) : 0, &usage)) {
+            charge->failCnt++;
+            return LOS_ERRNO_VM_NO_MEMORY;
+        }
+    } else if (!OsVmChargeTryReserve(charge, limit, &usage)) {
+        usage = (UINT32)LOS_AtomicRead(&charge->usage);
+        charge->reclaimed += OsTryShrinkChargeMemory(space,
+            ((usage > limit) ? (usage - limit) : 0) + VM_MEMLIMIT_RECLAIM_BATCH);
+        if (!OsVmChargeTryReserve(charge, limit, &usage)) {
+            charge->failCnt++;
+            return LOS_ERRNO_VM_NO_MEMORY;
+        }
+    }
+
+    LOS_AtomicInc(&charge->refCount);
+    if (usage > charge->maxUsage) {
+        charge->maxUsage = usage;
+    }
+    page->charge = charge;
+    return LOS_OK;
+}
+//页框最后一次释放时调用,从所属计费组退费
+VOID OsVmPageUncharge(LosVmPage *page)
+{
+    LosVmCharge *charge = page->charge;
+
+    if (charge == NULL) {
+        return;
+    }
+
+    page->charge = NULL;
+    LOS_AtomicDec(&charge->usage);
+    OsVmChargePut(charge);
+}
+//fork 和 exec 后新空间沿用原进程的上限,用量从0开始
+VOID OsVmChargeLimitInherit(LosVmSpace *dst, const LosVmSpace *src)
+{
+    if ((dst == NULL) || (src == NULL) || (dst->charge == NULL) || (src->charge == NULL)) {
+        return;
+    }
+    dst->charge->limit = src->charge->limit;
+}
+//对外接口|设置进程驻留页数上限,0表示不限;新上限低于当前用量时立刻在本组内回收
+STATUS_T LOS_VmSpaceMemLimitSet(LosVmSpace *space, UINT32 limit)
+{
+    UINT32 usage;
+
+    if ((space == NULL) || (space->charge == NULL)) {
+        return LOS_ERRNO_VM_INVALID_ARGS;
+    }
+
+    space->charge->limit = limit;
+    usage = (UINT32)LOS_AtomicRead(&space->charge->usage);
+    if ((limit != 0) && (usage > limit)) {
+        space->charge->reclaimed += OsTryShrinkChargeMemory(space, usage - limit);
+    }
+    return LOS_OK;
+}
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
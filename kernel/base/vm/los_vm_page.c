@@ -52,6 +52,9 @@ STATIC VOID OsVmPageInit(LosVmPage *page, paddr_t pa, UINT8 segID)
     page->physAddr = pa;				//物理地址
     page->segID = segID;				//物理地址使用段管理，段ID
     page->order = VM_LIST_ORDER_MAX;	//初始化值,不属于任何块组
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    page->charge = NULL;
+#endif
 }
 //伙伴算法初始化
 STATIC INLINE VOID OsVmPageOrderListInit(LosVmPage *page, size_t nPages)
@@ -34,7 +34,18 @@
 #include "los_vm_common.h"
 #include "los_vm_map.h"
 #include "los_vm_dump.h"
+#include "los_vm_event.h"
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+#include "los_vm_compact.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_PSI
+#include "los_vm_psi.h"
+#endif
 #include "los_process_pri.h"
+#include "arm_page.h"
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -74,6 +85,12 @@ STATIC VOID OsVmPhysLruInit(struct VmPhysSeg *seg)
         seg->lruSize[i] = 0;			//记录链表节点数
         LOS_ListInit(&seg->lruList[i]);	//初始化LRU链表
     }
+    seg->minSeq = 0;
+    seg->maxSeq = 0;
+    for (i = 0; i < VM_LRU_NR_GENS; i++) {//文件页的各代链表
+        seg->genSize[i] = 0;
+        LOS_ListInit(&seg->genList[i]);
+    }
     LOS_SpinUnlockRestore(&seg->lruLock, intSave);
 }
 //创建物理段,由区划分转成段管理
@@ -378,6 +395,58 @@ VOID OsVmPhysPagesFreeContiguous(LosVmPage *page, size_t nPages)
     }
 }
 
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+/**************************************************************************************************
+ 整理时把 [page, page + nPages) 里的空闲块从伙伴链表上摘下来挂到 list 上,page->nPages 记下块的页数.
+ 整理期间迁移用的新页就不会再分到这个块里,搬空的旧页也先挂在 list 上,最后一起还回去才合并成大块.
+ page 须按 nPages 对齐,这样块内的空闲块都从块内起始,返回摘下的页数
+**************************************************************************************************/
+size_t OsVmPhysRangeIsolate(LosVmPage *page, size_t nPages, LOS_DL_LIST *list)
+{
+    UINT32 intSave;
+    struct VmPhysSeg *seg = &g_vmPhysSeg[page->segID];
+    LosVmPage *cur = NULL;
+    size_t index = 0;
+    size_t count = 0;
+    size_t n;
+
+    LOS_SpinLockSave(&seg->freeListLock, &intSave);
+    while (index < nPages) {
+        cur = &page[index];
+        if (cur->order >= VM_LIST_ORDER_MAX) {//已分配的页
+            index++;
+            continue;
+        }
+        n = VM_ORDER_TO_PAGES(cur->order);
+        OsVmPhysFreeListDelUnsafe(cur);
+        cur->nPages = n;
+        LOS_ListTailInsert(list, &cur->node);
+        count += n;
+        index += n;
+    }
+    LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+
+    return count;
+}
+//把摘下的空闲块和搬空的旧页还给伙伴算法,相邻的块在这里合并
+VOID OsVmPhysRangePutback(LOS_DL_LIST *list)
+{
+    UINT32 intSave;
+    struct VmPhysSeg *seg = NULL;
+    LosVmPage *page = NULL;
+    LosVmPage *next = NULL;
+
+    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(page, next, list, LosVmPage, node) {
+        LOS_ListDelete(&page->node);
+        seg = &g_vmPhysSeg[page->segID];
+        LOS_SpinLockSave(&seg->freeListLock, &intSave);
+        OsVmPhysPagesFree(page, OsVmPagesToOrder(page->nPages));
+        page->nPages = 0;
+        LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+    }
+}
+#endif
+
 /******************************************************************************
  获取一定数量的页框 LosVmPage实体是放在全局大数组中的,
  LosVmPage->nPages 标记了分配页数
@@ -402,6 +471,7 @@ STATIC LosVmPage *OsVmPhysPagesGet(size_t nPages)
             LOS_AtomicSet(&page->refCounts, 0);//设置引用次数为0
             page->nPages = nPages;//页数
             LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+            OsVmEventAdd(VM_EVENT_PAGE_ALLOC, nPages);
             return page;
         }
         LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
@@ -412,12 +482,29 @@ STATIC LosVmPage *OsVmPhysPagesGet(size_t nPages)
 VOID *LOS_PhysPagesAllocContiguous(size_t nPages)
 {
     LosVmPage *page = NULL;
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+    BOOL compacted = FALSE;
+#endif
 
     if (nPages == 0) {
         return NULL;
     }
 	//鸿蒙 nPages 不能大于 2^8 次方,即256个页,1M内存,仅限于内核态,用户态不限制分配大小.
     page = OsVmPhysPagesGet(nPages);//通过伙伴算法获取物理上连续的页
+#ifdef LOSCFG_KERNEL_VM_COMPACT
+    if ((page == NULL) && (nPages > 1)) {//碎片导致失败时整理出大块再试一次,调用者等整理结束,计入内存压力停顿
+#ifdef LOSCFG_KERNEL_VM_PSI
+        OsVmPsiStallEnter();
+#endif
+        compacted = OsVmPhysCompact(OsVmPagesToOrder(nPages));
+#ifdef LOSCFG_KERNEL_VM_PSI
+        OsVmPsiStallLeave();
+#endif
+        if (compacted) {
+            page = OsVmPhysPagesGet(nPages);
+        }
+    }
+#endif
     if (page == NULL) {
         return NULL;
     }
@@ -428,6 +515,9 @@ VOID *LOS_PhysPagesAllocContiguous(size_t nPages)
 VOID LOS_PhysPagesFreeContiguous(VOID *ptr, size_t nPages)
 {
     UINT32 intSave;
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    size_t index;
+#endif
     struct VmPhysSeg *seg = NULL;
     LosVmPage *page = NULL;
 
@@ -441,6 +531,11 @@ VOID LOS_PhysPagesFreeContiguous(VOID *ptr, size_t nPages)
         return;
     }
     page->nPages = 0;//被分配的页数置为0,表示不被分配
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    for (index = 0; index < nPages; index++) {//预先缺页的64K块逐页记过账
+        OsVmPageUncharge(&page[index]);
+    }
+#endif
 
     seg = &g_vmPhysSeg[page->segID];
     LOS_SpinLockSave(&seg->freeListLock, &intSave);
@@ -448,6 +543,7 @@ VOID LOS_PhysPagesFreeContiguous(VOID *ptr, size_t nPages)
     OsVmPhysPagesFreeContiguous(page, nPages);//具体释放实现
 
     LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+    OsVmEventAdd(VM_EVENT_PAGE_FREE, nPages);
 }
 /******************************************************************************
  通过物理地址获取内核虚拟地址,内核静态映射,减少虚实地址的转换
@@ -477,6 +573,9 @@ VOID LOS_PhysPageFree(LosVmPage *page)
     }
 
     if (LOS_AtomicDecRet(&page->refCounts) <= 0) {
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+        OsVmPageUncharge(page);//最后一个引用,从所属进程的计费组退费
+#endif
         seg = &g_vmPhysSeg[page->segID];
         LOS_SpinLockSave(&seg->freeListLock, &intSave);
 
@@ -484,6 +583,7 @@ VOID LOS_PhysPageFree(LosVmPage *page)
         LOS_AtomicSet(&page->refCounts, 0);
 
         LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
+        OsVmEventInc(VM_EVENT_PAGE_FREE);
     }
 }
 //供外部调用
@@ -512,6 +612,16 @@ size_t LOS_PhysPagesAlloc(size_t nPages, LOS_DL_LIST *list)
 
     return count;
 }
+//整页清0,kvaddr 须按页对齐
+VOID OsPhysPageZero(VOID *kvaddr)
+{
+    _arm_page_zero(kvaddr);
+}
+//整页拷贝,dst/src 须按页对齐
+VOID OsPhysPageCopy(VOID *dst, const VOID *src)
+{
+    _arm_page_copy(dst, src);
+}
 //拷贝共享页面
 VOID OsPhysSharePageCopy(PADDR_T oldPaddr, PADDR_T *newPaddr, LosVmPage *newPage)
 {
@@ -543,9 +653,7 @@ VOID OsPhysSharePageCopy(PADDR_T oldPaddr, PADDR_T *newPaddr, LosVmPage *newPage
             LOS_SpinUnlockRestore(&seg->freeListLock, intSave);
             return;
         }//请记住,在保护模式下,物理地址只能用于计算,操作(包括拷贝)需要虚拟地址! 
-        if (memcpy_s(newMem, PAGE_SIZE, oldMem, PAGE_SIZE) != EOK) {//老页内容复制给新页,需操作虚拟地址,拷贝一页数据
-            VM_ERR("memcpy_s failed");
-        }
+        OsPhysPageCopy(newMem, oldMem);//老页内容复制给新页,需操作虚拟地址,拷贝一页数据
 
         LOS_AtomicInc(&newPage->refCounts);//新页引用次数以原子方式自动减量 
         LOS_AtomicDec(&oldPage->refCounts);//老页引用次数以原子方式自动减量
@@ -587,11 +695,15 @@ size_t LOS_PhysPagesFree(LOS_DL_LIST *list)
     LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(page, nPage, list, LosVmPage, node) {//宏循环
         LOS_ListDelete(&page->node);//先把自己摘出去
         if (LOS_AtomicDecRet(&page->refCounts) <= 0) {//无引用
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+            OsVmPageUncharge(page);
+#endif
             seg = &g_vmPhysSeg[page->segID];//获取物理段
             LOS_SpinLockSave(&seg->freeListLock, &intSave);//锁住freeList
             OsVmPhysPagesFreeContiguous(page, ONE_PAGE);//连续释放,注意这里的ONE_PAGE其实有误导,让人以为是释放4K,其实是指连续的物理页框,如果3页连在一块是一起释放的.
             LOS_AtomicSet(&page->refCounts, 0);//引用重置为0
             LOS_SpinUnlockRestore(&seg->freeListLock, intSave);//恢复锁
+            OsVmEventInc(VM_EVENT_PAGE_FREE);
         }
         count++;//继续取下一个node
     }
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**************************************************************************************************
+ 内存压力停顿统计(PSI)
+ 以前内存紧张时只有 OomCheckProcess 打一行日志,用户进程毫无感知,等发现时延迟已经崩了.
+ 这里把任务卡在页高速缓存回收,换出,低内存检查里的时间累计起来("some":至少有一个任务在停顿的时间),
+ 用户进程通过 /dev/mempsi 设置 "some <停顿us> <窗口us>" 触发条件,后台任务周期检查,
+ 窗口内停顿超过阈值就唤醒 poll 该文件的进程(POLLPRI),每个窗口最多通知一次.
+**************************************************************************************************/
+#include "los_vm_psi.h"
+#include "los_vm_map.h"
+#include "los_atomic.h"
+#include "los_event.h"
+#include "los_memory.h"
+#include "los_mux.h"
+#include "los_spinlock.h"
+#include "los_task.h"
+#include "los_tick.h"
+#include "los_sys.h"
+#include "securec.h"
+#include "user_copy.h"
+#include "fs/fs.h"
+#include "linux/wait.h"
+#include "fs_poll_pri.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_PSI
+
+#define VM_PSI_EVENT_TRIGGER    0x1
+#define VM_PSI_DRIVER_MODE      0666
+#define VM_PSI_BUF_LEN          64
+#define VM_PSI_NS_PER_US        1000
+
+typedef struct {
+    LOS_DL_LIST         node;
+    UINT64              threshold;  /* us of stall within one window that fires the trigger */
+    UINT64              window;     /* us */
+    UINT64              winStart;   /* us, start of the current window */
+    UINT64              winBase;    /* total stall at winStart */
+    UINT64              prevGrowth; /* stall of the previous window */
+    BOOL                fired;      /* already fired in the current window */
+    BOOL                pending;    /* fired and not yet reported by poll */
+    wait_queue_head_t   wait;
+} VmPsiTrigger;
+
+STATIC SPIN_LOCK_INIT(g_psiSpin);   /* stall counters below */
+STATIC UINT32 g_psiStalled;         /* tasks stalled right now */
+STATIC UINT64 g_psiStallStart;      /* ns, when g_psiStalled went from 0 to 1 */
+STATIC UINT64 g_psiStallTotal;      /* ns */
+STATIC Atomic g_psiLowMemory = 0;   /* allocations refused by the low memory check */
+
+STATIC LosMux g_psiMux;             /* trigger list */
+STATIC LOS_DL_LIST g_psiTriggers;
+STATIC EVENT_CB_S g_psiEvent;
+
+//进入可能停顿的内存回收,可以嵌套,持有自旋锁时也能调用
+VOID OsVmPsiStallEnter(VOID)
+{
+    UINT32 intSave;
+
+    LOS_SpinLockSave(&g_psiSpin, &intSave);
+    if (g_psiStalled++ == 0) {
+        g_psiStallStart = LOS_CurrNanosec();
+    }
+    LOS_SpinUnlockRestore(&g_psiSpin, intSave);
+}
+//离开内存回收,最后一个停顿的任务离开时把这段时间记入总数
+VOID OsVmPsiStallLeave(VOID)
+{
+    UINT32 intSave;
+
+    LOS_SpinLockSave(&g_psiSpin, &intSave);
+    if ((g_psiStalled > 0) && (--g_psiStalled == 0)) {
+        g_psiStallTotal += LOS_CurrNanosec() - g_psiStallStart;
+    }
+    LOS_SpinUnlockRestore(&g_psiSpin, intSave);
+}
+//低内存检查拒绝了一次分配
+VOID OsVmPsiLowMemory(VOID)
+{
+    LOS_AtomicInc(&g_psiLowMemory);
+}
+//累计停顿时间(us),包括正在进行中的停顿
+UINT64 OsVmPsiStallTotalGet(VOID)
+{
+    UINT64 total;
+    UINT32 intSave;
+
+    LOS_SpinLockSave(&g_psiSpin, &intSave);
+    total = g_psiStallTotal;
+    if (g_psiStalled > 0) {
+        total += LOS_CurrNanosec() - g_psiStallStart;
+    }
+    LOS_SpinUnlockRestore(&g_psiSpin, intSave);
+    return total / VM_PSI_NS_PER_US;
+}
+/**************************************************************************************************
+ 按滑动窗口估算最近一个窗口内的停顿:当前窗口的增量,加上上一窗口按还没滑出去的比例折算的部分.
+ 每个窗口最多触发一次,调用者持有 g_psiMux
+**************************************************************************************************/
+STATIC VOID OsVmPsiTriggerCheck(VmPsiTrigger *trigger, UINT64 now, UINT64 total)
+{
+    UINT64 elapsed = now - trigger->winStart;
+    UINT64 growth;
+
+    if (elapsed >= trigger->window) {//开始新的窗口
+        trigger->prevGrowth = (elapsed < (trigger->window << 1)) ? (total - trigger->winBase) : 0;
+        trigger->winStart = now;
+        trigger->winBase = total;
+        trigger->fired = FALSE;
+        elapsed = 0;
+    }
+
+    growth = (total - trigger->winBase) + trigger->prevGrowth * (trigger->window - elapsed) / trigger->window;
+    if (!trigger->fired && (growth >= trigger->threshold)) {
+        trigger->fired = TRUE;
+        trigger->pending = TRUE;
+        notify_poll(&trigger->wait);
+    }
+}
+//检查任务:没有触发器时睡在事件上,有触发器时每 VM_PSI_POLL_MS 检查一次
+STATIC VOID OsVmPsiTask(VOID)
+{
+    VmPsiTrigger *trigger = NULL;
+    UINT64 total;
+    UINT64 now;
+
+    while (1) {
+        if (LOS_ListEmpty(&g_psiTriggers)) {
+            (VOID)LOS_EventRead(&g_psiEvent, VM_PSI_EVENT_TRIGGER, LOS_WAITMODE_OR | LOS_WAITMODE_CLR,
+                                LOS_WAIT_FOREVER);
+        } else {
+            (VOID)LOS_TaskDelay(LOS_MS2Tick(VM_PSI_POLL_MS));
+        }
+
+        total = OsVmPsiStallTotalGet();
+        now = LOS_CurrNanosec() / VM_PSI_NS_PER_US;
+        (VOID)LOS_MuxAcquire(&g_psiMux);
+        LOS_DL_LIST_FOR_EACH_ENTRY(trigger, &g_psiTriggers, VmPsiTrigger, node) {
+            OsVmPsiTriggerCheck(trigger, now, total);
+        }
+        (VOID)LOS_MuxRelease(&g_psiMux);
+    }
+}
+
+STATIC INT32 OsVmPsiCopy(VOID *dst, const VOID *src, size_t len)
+{
+    if (LOS_IsUserAddressRange((VADDR_T)(UINTPTR)dst, len)) {
+        return (INT32)LOS_ArchCopyToUser(dst, src, len);
+    }
+    if (LOS_IsUserAddressRange((VADDR_T)(UINTPTR)src, len)) {
+        return (INT32)LOS_ArchCopyFromUser(dst, src, len);
+    }
+    return memcpy_s(dst, len, src, len);
+}
+
+STATIC INT32 OsVmPsiOpen(struct file *filep)
+{
+    filep->f_priv = NULL;
+    return 0;
+}
+
+//poll_wait 挂进来的等待者先唤醒再摘掉,检查任务和 poll 都在 g_psiMux 下碰 wait,之后才能释放
+STATIC INT32 OsVmPsiClose(struct file *filep)
+{
+    VmPsiTrigger *trigger = NULL;
+
+    (VOID)LOS_MuxAcquire(&g_psiMux);
+    trigger = (VmPsiTrigger *)filep->f_priv;
+    if (trigger == NULL) {
+        (VOID)LOS_MuxRelease(&g_psiMux);
+        return 0;
+    }
+    LOS_ListDelete(&trigger->node);
+    filep->f_priv = NULL;
+    notify_poll(&trigger->wait);
+    LOS_ListDelete(&trigger->wait.poll_queue);
+    (VOID)LOS_MuxRelease(&g_psiMux);
+    (VOID)LOS_MemFree(m_aucSysMem0, trigger);
+    return 0;
+}
+//读出累计停顿时间(us)和低内存拒绝分配的次数
+STATIC ssize_t OsVmPsiRead(struct file *filep, char *buffer, size_t bufLen)
+{
+    CHAR buf[VM_PSI_BUF_LEN];
+    INT32 len;
+
+    len = snprintf_s(buf, sizeof(buf), sizeof(buf) - 1, "some total=%llu\nlowmem %d\n",
+                     OsVmPsiStallTotalGet(), LOS_AtomicRead(&g_psiLowMemory));
+    if (len < 0) {
+        return -EINVAL;
+    }
+    if (filep->f_pos >= len) {
+        return 0;
+    }
+
+    len = MIN2((size_t)(len - filep->f_pos), bufLen);
+    if (OsVmPsiCopy(buffer, buf + filep->f_pos, len) != 0) {
+        return -EFAULT;
+    }
+    filep->f_pos += len;
+    return len;
+}
+//写入 "some <停顿us> <窗口us>" 设置触发条件,一个打开的文件只能设一个
+STATIC ssize_t OsVmPsiWrite(struct file *filep, const char *buffer, size_t bufLen)
+{
+    CHAR buf[VM_PSI_BUF_LEN] = {0};
+    UINT32 stallUs = 0;
+    UINT32 windowUs = 0;
+    VmPsiTrigger *trigger = NULL;
+
+    if ((bufLen == 0) || (bufLen >= sizeof(buf))) {
+        return -EINVAL;
+    }
+    if (OsVmPsiCopy(buf, buffer, bufLen) != 0) {
+        return -EFAULT;
+    }
+    if (sscanf_s(buf, "some %u %u", &stallUs, &windowUs) != 2) { /* 2: stall and window */
+        return -EINVAL;
+    }
+    if ((windowUs < VM_PSI_WINDOW_MIN_US) || (windowUs > VM_PSI_WINDOW_MAX_US) ||
+        (stallUs == 0) || (stallUs > windowUs)) {
+        return -EINVAL;
+    }
+
+    trigger = (VmPsiTrigger *)LOS_MemAlloc(m_aucSysMem0, sizeof(VmPsiTrigger));
+    if (trigger == NULL) {
+        return -ENOMEM;
+    }
+    (VOID)memset_s(trigger, sizeof(VmPsiTrigger), 0, sizeof(VmPsiTrigger));
+    trigger->threshold = stallUs;
+    trigger->window = windowUs;
+    trigger->winStart = LOS_CurrNanosec() / VM_PSI_NS_PER_US;
+    trigger->winBase = OsVmPsiStallTotalGet();
+    init_waitqueue_head(&trigger->wait);
+
+    (VOID)LOS_MuxAcquire(&g_psiMux);
+    if (filep->f_priv != NULL) {
+        (VOID)LOS_MuxRelease(&g_psiMux);
+        (VOID)LOS_MemFree(m_aucSysMem0, trigger);
+        return -EBUSY;
+    }
+    LOS_ListTailInsert(&g_psiTriggers, &trigger->node);
+    filep->f_priv = trigger;
+    (VOID)LOS_MuxRelease(&g_psiMux);
+
+    (VOID)LOS_EventWrite(&g_psiEvent, VM_PSI_EVENT_TRIGGER);//唤醒检查任务
+    return bufLen;
+}
+//触发后返回 POLLPRI,读一次清一次;没设触发条件或已关闭的文件返回 POLLERR
+STATIC INT32 OsVmPsiPoll(struct file *filep, poll_table *table)
+{
+    VmPsiTrigger *trigger = NULL;
+    INT32 ret = 0;
+
+    (VOID)LOS_MuxAcquire(&g_psiMux);
+    trigger = (VmPsiTrigger *)filep->f_priv;
+    if (trigger == NULL) {
+        (VOID)LOS_MuxRelease(&g_psiMux);
+        return POLLERR;
+    }
+
+    poll_wait(filep, &trigger->wait, table);//挂等待队列和关闭,通知互斥
+    if (trigger->pending) {
+        trigger->pending = FALSE;
+        ret = POLLPRI;
+    }
+    (VOID)LOS_MuxRelease(&g_psiMux);
+    return ret;
+}
+
+STATIC const struct file_operations_vfs g_psiFops = {
+    OsVmPsiOpen,    /* open */
+    OsVmPsiClose,   /* close */
+    OsVmPsiRead,    /* read */
+    OsVmPsiWrite,   /* write */
+    NULL,           /* seek */
+    NULL,           /* ioctl */
+    NULL,           /* mmap */
+#ifndef CONFIG_DISABLE_POLL
+    OsVmPsiPoll,    /* poll */
+#endif
+    NULL,           /* unlink */
+};
+//创建触发器检查任务并注册 /dev/mempsi
+UINT32 OsVmPsiInit(VOID)
+{
+    UINT32 ret;
+    UINT32 taskID;
+    TSK_INIT_PARAM_S taskInitParam;
+
+    ret = LOS_MuxInit(&g_psiMux, NULL);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+    LOS_ListInit(&g_psiTriggers);
+    ret = LOS_EventInit(&g_psiEvent);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    (VOID)memset_s((VOID *)(&taskInitParam), sizeof(TSK_INIT_PARAM_S), 0, sizeof(TSK_INIT_PARAM_S));
+    taskInitParam.pfnTaskEntry = (TSK_ENTRY_FUNC)OsVmPsiTask;
+    taskInitParam.uwStackSize = LOSCFG_BASE_CORE_TSK_DEFAULT_STACK_SIZE;
+    taskInitParam.pcName = "MemPsiTask";
+    taskInitParam.usTaskPrio = LOSCFG_BASE_CORE_TSK_DEFAULT_PRIO;
+    ret = LOS_TaskCreate(&taskID, &taskInitParam);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    return (register_driver(VM_PSI_DRIVER, &g_psiFops, VM_PSI_DRIVER_MODE, NULL) == 0) ? LOS_OK : LOS_NOK;
+}
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
@@ -30,10 +30,21 @@
  */
 
 #include "menuconfig.h"
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+#include "los_vm_zram.h"
+#include "los_vm_lock.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_PSI
+#include "los_vm_psi.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
 #ifdef LOSCFG_FS_VFS
 
 #include "fs/file.h"
 #include "los_vm_filemap.h"
+#include "los_vm_event.h"
 
 /* unmap a lru page by map record info caller need lru lock */
 /**************************************************************************************************
@@ -47,6 +58,9 @@ VOID OsUnmapPageLocked(LosFilePage *page, LosMapInfo *info)
         return;
     }
     page->n_maps--;
+    if (page->n_maps == 0) {//最后一个映射解除,mlock 锁定随之失效
+        page->flags &= ~VM_MAP_REGION_FLAG_LOCKED;
+    }
     LOS_ListDelete(&info->node);
     LOS_AtomicDec(&page->vmPage->refCounts);
     LOS_ArchMmuUnmap(info->archMmu, info->vaddr, 1);
@@ -64,18 +78,38 @@ VOID OsUnmapAllLocked(LosFilePage *page)
     }
 }
 
-/* add a new lru node to lru list, lruType can be file or anon */
-VOID OsLruCacheAdd(LosFilePage *fpage, enum OsLruList lruType)//在lru列表中添加一个新的lru节点，lruType可以是文件或匿名
+/**************************************************************************************************
+ 文件页按代老化(multi-generation LRU)
+ 每个物理段维护 minSeq..maxSeq 最多 VM_LRU_NR_GENS 代,新加入的页挂在最年轻一代.
+ 读/缺页/映射时只给页打上访问标记,不挪链表;回收只扫最老一代:
+ 有访问标记的页清掉标记后提到最年轻一代,其余能回收的页直接回收,暂时动不了的页挪到下一代,
+ 这样一轮扫描不会反复碰到同一批页.最老一代扫空后 minSeq++,不足 VM_LRU_NR_GENS 代时 maxSeq++ 开新的一代.
+ ARMv7 短描述符页表没有硬件访问位,访问信息只能取自 OsPageRefIncLocked 打的软件标记.
+**************************************************************************************************/
+/* move a lru node to generation seq, caller need hold lru_lock */
+STATIC INLINE VOID OsLruGenMove(LosFilePage *fpage, UINT32 seq)
+{
+    LosVmPhysSeg *physSeg = fpage->physSeg;
+
+    physSeg->genSize[VM_LRU_GEN(fpage->genSeq)]--;
+    physSeg->genSize[VM_LRU_GEN(seq)]++;
+    fpage->genSeq = seq;
+    LOS_ListDelete(&fpage->lru);
+    LOS_ListTailInsert(&physSeg->genList[VM_LRU_GEN(seq)], &fpage->lru);
+}
+
+/* add a new lru node to the youngest generation */
+VOID OsLruCacheAdd(LosFilePage *fpage)//新页挂到最年轻一代
 {
     UINT32 intSave;
     LosVmPhysSeg *physSeg = fpage->physSeg;	//得到页面对应段
     LosVmPage *page = fpage->vmPage;		//得到物理页面
 
-    LOS_SpinLockSave(&physSeg->lruLock, &intSave);//自旋锁:最多只能被一个内核持有，CPU内核 互斥锁
-    OsSetPageActive(page);	//设置页面为活动页
+    LOS_SpinLockSave(&physSeg->lruLock, &intSave);
     OsCleanPageReferenced(page);//清除页面被引用位
-    physSeg->lruSize[lruType]++;	//lruType页总size++
-    LOS_ListTailInsert(&physSeg->lruList[lruType], &fpage->lru);//加入lruType页双循环链表中
+    fpage->genSeq = physSeg->maxSeq;
+    physSeg->genSize[VM_LRU_GEN(fpage->genSeq)]++;
+    LOS_ListTailInsert(&physSeg->genList[VM_LRU_GEN(fpage->genSeq)], &fpage->lru);
 
     LOS_SpinUnlockRestore(&physSeg->lruLock, intSave);//解锁
 }
@@ -84,188 +118,110 @@ VOID OsLruCacheAdd(LosFilePage *fpage, enum OsLruList lruType)//在lru列表中
 VOID OsLruCacheDel(LosFilePage *fpage)//删除lru节点，调用者需要拿到lru锁
 {
     LosVmPhysSeg *physSeg = fpage->physSeg;	//得到页面对应段
-    int type = OsIsPageActive(fpage->vmPage) ? VM_LRU_ACTIVE_FILE : VM_LRU_INACTIVE_FILE;//得到页面LRU类型
 
-    physSeg->lruSize[type]--;	//type页总size--
+    physSeg->genSize[VM_LRU_GEN(fpage->genSeq)]--;
     LOS_ListDelete(&fpage->lru);//将自己从lru链表中摘出来
 }
-//非活动文件页低于活动文件页吗
-BOOL OsInactiveListIsLow(LosVmPhysSeg *physSeg)
-{
-    return (physSeg->lruSize[VM_LRU_ACTIVE_FILE] >
-            physSeg->lruSize[VM_LRU_INACTIVE_FILE]) ? TRUE : FALSE;//直接对比size，效率杠杠的
-}
-
-/* move a page from inactive list to active list  head */
-STATIC INLINE VOID OsMoveToActiveList(LosFilePage *fpage)//将页面从非活动列表移动到活动列表
-{
-    LosVmPhysSeg *physSeg = fpage->physSeg;		//得到页面对应段
-
-    physSeg->lruSize[VM_LRU_ACTIVE_FILE]++; 	//活动页总size++
-    physSeg->lruSize[VM_LRU_INACTIVE_FILE]--;	//不活动页总size--
-    LOS_ListDelete(&fpage->lru);				//将自己从lru链表中摘出来
-    LOS_ListTailInsert(&physSeg->lruList[VM_LRU_ACTIVE_FILE], &fpage->lru);//加入活动页双循环链表中
-}
-
-/* move a page from active list to inactive list  head */
-STATIC INLINE VOID OsMoveToInactiveList(LosFilePage *fpage)//将页面从活动列表移动到非活动列表
-{
-    LosVmPhysSeg *physSeg = fpage->physSeg;		//得到页面对应段
-
-    physSeg->lruSize[VM_LRU_ACTIVE_FILE]--;		//活动页总size--
-    physSeg->lruSize[VM_LRU_INACTIVE_FILE]++;	//不活动页总size++
-    LOS_ListDelete(&fpage->lru);				//将自己从lru链表中摘出来
-    LOS_ListTailInsert(&physSeg->lruList[VM_LRU_INACTIVE_FILE], &fpage->lru);//加入不活动页双循环链表中
-}
 
-/* move a page to the most active pos in lru list(active head) *///将页面移至lru列表中最活跃的位置
-STATIC INLINE VOID OsMoveToActiveHead(LosFilePage *fpage)
-{
-    LosVmPhysSeg *physSeg = fpage->physSeg;	//得到页面对应段
-    LOS_ListDelete(&fpage->lru);			//将自己从lru链表中摘出来
-    LOS_ListTailInsert(&physSeg->lruList[VM_LRU_ACTIVE_FILE], &fpage->lru);//加入活动页双循环链表中
-}
-
-/* move a page to the most active pos in lru list(inactive head) */
-STATIC INLINE VOID OsMoveToInactiveHead(LosFilePage *fpage)//鸿蒙会从inactive链表的尾部开始进行回收,跟linux一样
-{
-    LosVmPhysSeg *physSeg = fpage->physSeg;	//得到页面对应段
-    LOS_ListDelete(&fpage->lru);			//将自己从lru链表中摘出来
-    LOS_ListTailInsert(&physSeg->lruList[VM_LRU_INACTIVE_FILE], &fpage->lru);//加入不活动页双循环链表中
-}
-
-/* page referced add: (call by page cache get)
-----------inactive----------|----------active------------
-[ref:0,act:0], [ref:1,act:0]|[ref:0,act:1], [ref:1,act:1]
-ref:0, act:0 --> ref:1, act:0
-ref:1, act:0 --> ref:0, act:1
-ref:0, act:1 --> ref:1, act:1
-*/
+/* page referenced add: (call by page cache get), only mark it, the shrinker promotes it */
 VOID OsPageRefIncLocked(LosFilePage *fpage)
 {
-    BOOL isOrgActive;
     UINT32 intSave;
-    LosVmPage *page = NULL;
 
     if (fpage == NULL) {
         return;
     }
 
     LOS_SpinLockSave(&fpage->physSeg->lruLock, &intSave);
-
-    page = fpage->vmPage;
-    isOrgActive = OsIsPageActive(page);
-
-    if (OsIsPageReferenced(page) && !OsIsPageActive(page)) {
-        OsCleanPageReferenced(page);
-        OsSetPageActive(page);
-    } else if (!OsIsPageReferenced(page)) {
-        OsSetPageReferenced(page);
-    }
-
-    if (!isOrgActive && OsIsPageActive(page)) {
-        /* move inactive to active */
-        OsMoveToActiveList(fpage);
-    /* no change, move head */
-    } else {
-        if (OsIsPageActive(page)) {
-            OsMoveToActiveHead(fpage);
-        } else {
-            OsMoveToInactiveHead(fpage);
-        }
-    }
-
+    OsSetPageReferenced(fpage->vmPage);
     LOS_SpinUnlockRestore(&fpage->physSeg->lruLock, intSave);
 }
 
-/* page referced dec: (call by thrinker)
-----------inactive----------|----------active------------
-[ref:0,act:0], [ref:1,act:0]|[ref:0,act:1], [ref:1,act:1]
-ref:1, act:1 --> ref:0, act:1
-ref:0, act:1 --> ref:1, act:0
-ref:1, act:0 --> ref:0, act:0
-*/
+/* page referenced dec: (call by unmap), the page ages out with its generation */
 VOID OsPageRefDecNoLock(LosFilePage *fpage)
 {
-    BOOL isOrgActive;
-    LosVmPage *page = NULL;
-
     if (fpage == NULL) {
         return;
     }
 
-    page = fpage->vmPage;
-    isOrgActive = OsIsPageActive(page);
+    OsCleanPageReferenced(fpage->vmPage);
+}
+//文件页总数
+STATIC size_t OsLruGenPages(const LosVmPhysSeg *physSeg)
+{
+    size_t nPages = 0;
+    UINT32 gen;
 
-    if (!OsIsPageReferenced(page) && OsIsPageActive(page)) {//[ref:0,act:1]的情况
-        OsCleanPageActive(page);
-        OsSetPageReferenced(page);
-    } else if (OsIsPageReferenced(page)) {
-        OsCleanPageReferenced(page);
+    for (gen = 0; gen < VM_LRU_NR_GENS; gen++) {
+        nPages += physSeg->genSize[gen];
     }
-
-    if (isOrgActive && !OsIsPageActive(page)) {
-        OsMoveToInactiveList(fpage);
+    return nPages;
+}
+//丢掉已扫空的老一代,代数不够时开出新的一代,保证最老一代之后至少还有一代可挪
+STATIC VOID OsLruGenAge(LosVmPhysSeg *physSeg)
+{
+    while ((physSeg->minSeq != physSeg->maxSeq) && (physSeg->genSize[VM_LRU_GEN(physSeg->minSeq)] == 0)) {
+        physSeg->minSeq++;
+    }
+    if ((physSeg->maxSeq - physSeg->minSeq + 1) < VM_LRU_NR_GENS) {
+        physSeg->maxSeq++;
     }
 }
-//缩小活动页链表
-VOID OsShrinkActiveList(LosVmPhysSeg *physSeg, int nScan)
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#define OS_PAGE_CHARGE_MATCH(page, group)   (((group) == NULL) || ((page)->charge == (group)))
+#else
+#define OS_PAGE_CHARGE_MATCH(page, group)   TRUE
+#endif
+/**************************************************************************************************
+ 扫描第 seq 代,回收至多 nReclaim 页,每看一页 *nScan 减一.调用者持有 lruLock
+ group 不为 NULL 时只回收记在该计费组名下的页,其他页原地不动
+ 拿不到 mapping 锁的页只能尝试,锁的顺序与 OsPageRefIncLocked 相反
+**************************************************************************************************/
+STATIC UINT32 OsShrinkGen(LosVmPhysSeg *physSeg, UINT32 seq, const VOID *group,
+                          INT32 *nScan, UINT32 nReclaim, LOS_DL_LIST *list)
 {
+    UINT32 nrReclaimed = 0;
+    UINT32 nextSeq = (seq == physSeg->maxSeq) ? seq : (seq + 1);
+    INT32 budget = *nScan;
+    LosVmPage *page = NULL;
+    SPIN_LOCK_S *flock = NULL;
     LosFilePage *fpage = NULL;
     LosFilePage *fnext = NULL;
-    LOS_DL_LIST *activeFile = &physSeg->lruList[VM_LRU_ACTIVE_FILE];
+    LosFilePage *ftemp = NULL;
+    LOS_DL_LIST *gen = &physSeg->genList[VM_LRU_GEN(seq)];
 
-    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(fpage, fnext, activeFile, LosFilePage, lru) {
-        if (LOS_SpinTrylock(&fpage->mapping->list_lock) != LOS_OK) {
-            continue;
+    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(fpage, fnext, gen, LosFilePage, lru) {
+        if ((nrReclaimed >= nReclaim) || (*nScan <= 0)) {
+            break;
         }
+        (*nScan)--;
 
-        /* happend when caller hold cache lock and try reclaim this page */
-        if (OsIsPageLocked(fpage->vmPage)) {
-            LOS_SpinUnlock(&fpage->mapping->list_lock);
+        page = fpage->vmPage;
+        if (!OS_PAGE_CHARGE_MATCH(page, group)) {
             continue;
         }
-
-        if (OsIsPageMapped(fpage) && (fpage->flags & VM_MAP_REGION_FLAG_PERM_EXECUTE)) {
-            LOS_SpinUnlock(&fpage->mapping->list_lock);
+        if (OsIsPageReferenced(page)) {//上一代里被访问过,提到最年轻一代
+            OsCleanPageReferenced(page);
+            OsLruGenMove(fpage, physSeg->maxSeq);
             continue;
         }
 
-        OsPageRefDecNoLock(fpage);
-
-        LOS_SpinUnlock(&fpage->mapping->list_lock);
-
-        if (--nScan <= 0) {
-            break;
-        }
-    }
-}
-//缩小未活动页链表
-int OsShrinkInactiveList(LosVmPhysSeg *physSeg, int nScan, LOS_DL_LIST *list)
-{
-    UINT32 nrReclaimed = 0;
-    LosVmPage *page = NULL;
-    SPIN_LOCK_S *flock = NULL;
-    LosFilePage *fpage = NULL;
-    LosFilePage *fnext = NULL;
-    LosFilePage *ftemp = NULL;
-    LOS_DL_LIST *inactive_file = &physSeg->lruList[VM_LRU_INACTIVE_FILE];
-
-    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(fpage, fnext, inactive_file, LosFilePage, lru) {
         flock = &fpage->mapping->list_lock;
-
         if (LOS_SpinTrylock(flock) != LOS_OK) {
+            OsLruGenMove(fpage, nextSeq);
             continue;
         }
 
-        page = fpage->vmPage;
-        if (OsIsPageLocked(page)) {
-            LOS_SpinUnlock(flock);
+        if (OsIsPageMlocked(fpage) || (OsIsPageMapped(fpage) && (fpage->flags & VM_MAP_REGION_FLAG_PERM_EXECUTE))) {
+            LOS_SpinUnlock(flock);//mlock 锁定的页和正在执行的代码页不回收
+            OsLruGenMove(fpage, physSeg->maxSeq);
             continue;
         }
 
-        if (OsIsPageMapped(fpage) && (OsIsPageDirty(page) || (fpage->flags & VM_MAP_REGION_FLAG_PERM_EXECUTE))) {
-            LOS_SpinUnlock(flock);
+        /* happend when caller hold cache lock and try reclaim this page */
+        if (OsIsPageLocked(page) || (OsIsPageMapped(fpage) && OsIsPageDirty(page))) {
+            LOS_SpinUnlock(flock);//映射着的脏页等回写任务写回后再回收
+            OsLruGenMove(fpage, nextSeq);
             continue;
         }
 
@@ -279,19 +235,28 @@ int OsShrinkInactiveList(LosVmPhysSeg *physSeg, int nScan, LOS_DL_LIST *list)
         OsDeletePageCacheLru(fpage);
         LOS_SpinUnlock(flock);
         nrReclaimed++;
+    }
 
-        if (--nScan <= 0) {
+    OsVmEventAdd(VM_EVENT_RECLAIM_SCAN, (UINT32)(budget - *nScan));
+    OsVmEventAdd(VM_EVENT_RECLAIM_STEAL, nrReclaimed);
+    return nrReclaimed;
+}
+//从老到新逐代回收,扫描的页数按要回收的页数封顶
+STATIC UINT32 OsShrinkGenerations(LosVmPhysSeg *physSeg, UINT32 nReclaim, LOS_DL_LIST *list)
+{
+    UINT32 nrReclaimed = 0;
+    INT32 nScan = (INT32)(nReclaim * VM_FILEMAP_SCAN_RATIO);
+
+    while ((nrReclaimed < nReclaim) && (nScan > 0)) {
+        OsLruGenAge(physSeg);
+        if (physSeg->genSize[VM_LRU_GEN(physSeg->minSeq)] == 0) {
             break;
         }
+        nrReclaimed += OsShrinkGen(physSeg, physSeg->minSeq, NULL, &nScan, nReclaim - nrReclaimed, list);
     }
 
     return nrReclaimed;
 }
-//是否 未活动文件页少于活动文件页
-bool InactiveListIsLow(LosVmPhysSeg *physSeg)
-{
-    return (physSeg->lruSize[VM_LRU_ACTIVE_FILE] > physSeg->lruSize[VM_LRU_INACTIVE_FILE]) ? TRUE : FALSE;
-}
 
 #ifdef LOSCFG_FS_VFS
 int OsTryShrinkMemory(size_t nPage)
@@ -312,21 +277,20 @@ int OsTryShrinkMemory(size_t nPage)
     if (nPage > VM_FILEMAP_MAX_SCAN) {
         nPage = VM_FILEMAP_MAX_SCAN;
     }
+#ifdef LOSCFG_KERNEL_VM_PSI
+    OsVmPsiStallEnter();//调用者要等回收结束,计入内存压力停顿
+#endif
 
     for (index = 0; index < g_vmPhysSegNum; index++) {
         physSeg = &g_vmPhysSeg[index];
         LOS_SpinLockSave(&physSeg->lruLock, &intSave);
-        totalPages = physSeg->lruSize[VM_LRU_ACTIVE_FILE] + physSeg->lruSize[VM_LRU_INACTIVE_FILE];
+        totalPages = OsLruGenPages(physSeg);
         if (totalPages < VM_FILEMAP_MIN_SCAN) {
             LOS_SpinUnlockRestore(&physSeg->lruLock, intSave);
             continue;
         }
 
-        if (InactiveListIsLow(physSeg)) {
-            OsShrinkActiveList(physSeg, (nPage < VM_FILEMAP_MIN_SCAN) ? VM_FILEMAP_MIN_SCAN : nPage);
-        }
-
-        nReclaimed += OsShrinkInactiveList(physSeg, nPage, &dirtyList);
+        nReclaimed += OsShrinkGenerations(physSeg, nPage - nReclaimed, &dirtyList);
         LOS_SpinUnlockRestore(&physSeg->lruLock, intSave);
 
         if (nReclaimed >= nPage) {
@@ -337,6 +301,9 @@ int OsTryShrinkMemory(size_t nPage)
     LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(fpage, fnext, &dirtyList, LosFilePage, node) {
         OsDoFlushDirtyPage(fpage);
     }
+#ifdef LOSCFG_KERNEL_VM_PSI
+    OsVmPsiStallLeave();
+#endif
 
     return nReclaimed;
 }
@@ -348,3 +315,153 @@ int TryShrinkMemory(size_t nPage)
 #endif
 
 #endif
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+//可以换出的线性区:进程私有的匿名映射,栈和堆.共享内存,mlock,vdso 等不动
+STATIC BOOL OsIsRegionSwappable(const LosVmSpace *space, const LosVmMapRegion *region)
+{
+    if ((region->regionFlags & (VM_MAP_REGION_FLAG_SHM | VM_MAP_REGION_FLAG_LOCKED |
+        VM_MAP_REGION_FLAG_VDSO | VM_MAP_REGION_FLAG_SHARED)) != 0) {
+        return FALSE;
+    }
+    if ((region->regionFlags & VM_MAP_REGION_FLAG_PERM_USER) == 0) {
+        return FALSE;
+    }
+    return LOS_IsRegionTypeAnon((LosVmMapRegion *)region) || (region == space->heap);
+}
+/**************************************************************************************************
+ 从 space->swapCursor 开始换出匿名页,调用者持有 regionMux.
+ ARMv7 页表没有访问位,无法挑出最近没用过的页,这里像时钟算法的指针一样在地址空间里转圈,
+ 每次接着上次停下的地方往后换,一轮扫完再从头开始,这样刚换回的页要等一整圈才会再被换出.
+**************************************************************************************************/
+STATIC size_t OsSwapSpaceAnon(LosVmSpace *space, size_t nPage, UINT32 *budget)
+{
+    LosVmMapRegion *region = NULL;
+    LosRbNode *pstRbNode = NULL;
+    LosRbNode *pstRbNodeNext = NULL;
+    VADDR_T vaddr;
+    VADDR_T end;
+    size_t nSwapped = 0;
+
+    RB_SCAN_SAFE(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+        region = (LosVmMapRegion *)pstRbNode;
+        end = region->range.base + region->range.size;
+        if ((end <= space->swapCursor) || !OsIsRegionSwappable(space, region)) {
+            continue;
+        }
+
+        vaddr = (region->range.base > space->swapCursor) ? region->range.base : space->swapCursor;
+        for (; (vaddr < end) && (nSwapped < nPage) && (*budget > 0); vaddr += PAGE_SIZE) {
+            (*budget)--;
+            if (OsVmZramSwapOut(space, region, vaddr) == LOS_OK) {
+                nSwapped++;
+            }
+        }
+        space->swapCursor = vaddr;
+        if ((nSwapped >= nPage) || (*budget == 0)) {
+            return nSwapped;
+        }
+    RB_SCAN_SAFE_END(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+
+    space->swapCursor = 0;//一轮扫完,下次从头开始
+    return nSwapped;
+}
+/**************************************************************************************************
+ 页高速缓存回收不出内存时,把用户进程的匿名页换出到压缩交换区.
+ 进程间轮流进行,扫过的空间排到队尾;拿不到锁的空间直接跳过,所以可以在低内存检查中调用.
+**************************************************************************************************/
+size_t OsTrySwapAnonMemory(size_t nPage)
+{
+    LOS_DL_LIST *spaceList = LOS_GetVmSpaceList();
+    LosMux *spaceMux = OsGVmSpaceMuxGet();
+    LosVmSpace *space = NULL;
+    UINT32 budget = VM_ZRAM_SCAN_PAGES_MAX;
+    UINT32 spaces = 0;
+    size_t nSwapped = 0;
+
+    if (LOS_MuxTrylock(spaceMux) != LOS_OK) {
+        return 0;
+    }
+
+    LOS_DL_LIST_FOR_EACH_ENTRY(space, spaceList, LosVmSpace, node) {
+        spaces++;
+    }
+    while ((spaces > 0) && (nSwapped < nPage) && (budget > 0)) {
+        spaces--;
+        space = LOS_DL_LIST_ENTRY(spaceList->pstNext, LosVmSpace, node);
+        LOS_ListDelete(&space->node);
+        LOS_ListTailInsert(spaceList, &space->node);//扫过的空间排到队尾,下次从别的进程开始
+        if (!LOS_IsUserAddress(space->base)) {
+            continue;
+        }
+        if (LOS_MuxTrylock(&space->regionMux) != LOS_OK) {
+            continue;
+        }
+        nSwapped += OsSwapSpaceAnon(space, nPage - nSwapped, &budget);
+        (VOID)LOS_MuxUnlock(&space->regionMux);
+    }
+
+    (VOID)LOS_MuxUnlock(spaceMux);
+    return nSwapped;
+}
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+/**************************************************************************************************
+ 计费组超限时只回收组内的页,不碰其他进程的页缓存和匿名页.
+ 先从老到新逐代挑出记在该组名下的文件页,不推进代数;开启压缩交换时再按时钟指针换出本空间的匿名页.
+ 调用者不能持有 lruLock 和 mapping 锁,regionMux 是递归锁,持有与否都可以
+**************************************************************************************************/
+size_t OsTryShrinkChargeMemory(LosVmSpace *space, size_t nPage)
+{
+    size_t nReclaimed = 0;
+#ifdef LOSCFG_FS_VFS
+    UINT32 intSave;
+    UINT32 index;
+    UINT32 seq;
+    INT32 nScan;
+    LosVmPhysSeg *physSeg = NULL;
+    LOS_DL_LIST_HEAD(dirtyList);
+    LosFilePage *fpage = NULL;
+    LosFilePage *fnext = NULL;
+#endif
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    UINT32 budget = VM_ZRAM_SCAN_PAGES_MAX;
+#endif
+
+    if ((space == NULL) || (space->charge == NULL) || (nPage == 0)) {
+        return 0;
+    }
+#ifdef LOSCFG_KERNEL_VM_PSI
+    OsVmPsiStallEnter();
+#endif
+
+#ifdef LOSCFG_FS_VFS
+    for (index = 0; (index < g_vmPhysSegNum) && (nReclaimed < nPage); index++) {
+        physSeg = &g_vmPhysSeg[index];
+        LOS_SpinLockSave(&physSeg->lruLock, &intSave);
+        nScan = (INT32)MIN2(OsLruGenPages(physSeg), VM_MEMLIMIT_SCAN_MAX);
+        for (seq = physSeg->minSeq; (seq <= physSeg->maxSeq) && (nScan > 0) && (nReclaimed < nPage); seq++) {
+            nReclaimed += OsShrinkGen(physSeg, seq, space->charge, &nScan, nPage - nReclaimed, &dirtyList);
+        }
+        LOS_SpinUnlockRestore(&physSeg->lruLock, intSave);
+    }
+
+    LOS_DL_LIST_FOR_EACH_ENTRY_SAFE(fpage, fnext, &dirtyList, LosFilePage, node) {
+        OsDoFlushDirtyPage(fpage);
+    }
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    if ((nReclaimed < nPage) && (LOS_MuxTrylock(&space->regionMux) == LOS_OK)) {
+        nReclaimed += OsSwapSpaceAnon(space, nPage - nReclaimed, &budget);
+        (VOID)LOS_MuxUnlock(&space->regionMux);
+    }
+#endif
+#ifdef LOSCFG_KERNEL_VM_PSI
+    OsVmPsiStallLeave();
+#endif
+
+    return nReclaimed;
+}
+#endif
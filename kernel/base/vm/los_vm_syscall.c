@@ -42,6 +42,10 @@
 #include "los_vm_dump.h"
 #include "los_vm_lock.h"
 #include "los_vm_filemap.h"
+#include "los_vm_fault.h"
+#ifdef LOSCFG_KERNEL_VM_KSM
+#include "los_vm_ksm.h"
+#endif
 #include "los_process_pri.h"
 
 #ifdef __cplusplus
@@ -107,6 +111,7 @@ VADDR_T LOS_MMap(VADDR_T vaddr, size_t len, unsigned prot, unsigned long flags,
     STATUS_T status;
     VADDR_T resultVaddr;
     UINT32 regionFlags;
+    BOOL populate = FALSE;
     LosVmMapRegion *newRegion = NULL;//应用的内存分配对应到内核就是分配一个线性区
     struct file *filep = NULL;// inode : file = 1:N ,一对多关系,一个inode可以被多个进程打开,返回不同的file但都指向同一个inode 
     LosVmSpace *vmSpace = OsCurrProcessGet()->vmSpace;
@@ -134,6 +139,7 @@ VADDR_T LOS_MMap(VADDR_T vaddr, size_t len, unsigned prot, unsigned long flags,
     }
 
     regionFlags = OsCvtProtFlagsToRegionFlags(prot, flags);//将参数flag转换Region的flag
+    regionFlags |= vmSpace->defRegionFlags;//mlockall(MCL_FUTURE) 之后的映射默认锁定
     newRegion = LOS_RegionAlloc(vmSpace, vaddr, len, regionFlags, pgoff);//分配一个线性区
     if (newRegion == NULL) {
         resultVaddr = (VADDR_T)-ENOMEM;//ENOMEM:内存溢出
@@ -150,13 +156,18 @@ VADDR_T LOS_MMap(VADDR_T vaddr, size_t len, unsigned prot, unsigned long flags,
 
     if (status != LOS_OK) {
         LOS_RbDelNode(&vmSpace->regionRbTree, &newRegion->rbNode);//从红黑树和双循环链表中删除
+        OsRegionCacheFlush(vmSpace);
         LOS_RegionFree(vmSpace, newRegion);//释放
         resultVaddr = (VADDR_T)-ENOMEM;//linux错误代码含义 ENOMEM:内存溢出
         goto MMAP_DONE;
     }
+    populate = ((flags & MAP_POPULATE) != 0) || ((newRegion->regionFlags & VM_MAP_REGION_FLAG_LOCKED) != 0);
 
 MMAP_DONE:
     (VOID)LOS_MuxRelease(&vmSpace->regionMux);
+    if (populate) {//预先缺页只是优化,失败时留给以后的缺页处理
+        (VOID)OsVmPopulate(vmSpace, resultVaddr, len);
+    }
     return resultVaddr;
 }
 //解除映射关系
@@ -229,6 +240,7 @@ VOID *LOS_DoBrk(VOID *addr)
 
     space->heapNow = (VADDR_T)(UINTPTR)alignAddr;//更新线性区结束地址
     space->heap->range.size = size;	//更新堆区大小,经此操作线性区变大或缩小了
+    LOS_RbAugmentPropagate(&space->regionRbTree, &space->heap->rbNode);//大小原地改变,刷新到根的空洞信息
     ret = (VOID *)(UINTPTR)space->heapNow;//返回线性区最新的地址
 
 REGION_ALLOC_FAILED:
@@ -270,6 +282,7 @@ int LOS_DoMprotect(VADDR_T vaddr, size_t len, unsigned long prot)
 
     vmFlags = OsCvtProtFlagsToRegionFlags(prot, 0);//转换FLAGS
     vmFlags |= (region->regionFlags & VM_MAP_REGION_FLAG_SHARED) ? VM_MAP_REGION_FLAG_SHARED : 0;
+    vmFlags |= (region->regionFlags & (VM_MAP_REGION_FLAG_LOCKED | VM_MAP_REGION_FLAG_MERGEABLE));
     region = LOS_RegionFind(space, vaddr);
     if (region == NULL) {
         ret = -ENOMEM;
@@ -282,6 +295,11 @@ int LOS_DoMprotect(VADDR_T vaddr, size_t len, unsigned long prot)
         ret = -ENOMEM;
         goto OUT_MPROTECT;
     }
+#ifdef LOSCFG_KERNEL_VM_KSM
+    if (region->regionFlags & VM_MAP_REGION_FLAG_MERGEABLE) {//合并页不能随线性区恢复可写
+        OsVmKsmProtect(space, vaddr, count);
+    }
+#endif
     ret = LOS_OK;
 
 OUT_MPROTECT:
@@ -295,6 +313,229 @@ OUT_MPROTECT:
     (VOID)LOS_MuxRelease(&space->regionMux);
     return ret;
 }
+//对单个线性区中的 [vaddr, vaddr + len) 执行访问建议,调用者持有 regionMux
+STATIC int OsMadviseRegion(LosVmSpace *space, LosVmMapRegion *region, VADDR_T vaddr, size_t len, int advice)
+{
+#ifdef LOSCFG_FS_VFS
+    UINT32 mode;
+#endif
+
+    switch (advice) {
+        case MADV_NORMAL:
+        case MADV_SEQUENTIAL:
+        case MADV_RANDOM:
+#ifdef LOSCFG_FS_VFS
+            if (LOS_IsRegionFileValid(region)) {//预读窗口挂在线性区上,对整个线性区生效
+                mode = (advice == MADV_SEQUENTIAL) ? FILE_RA_SEQUENTIAL :
+                       ((advice == MADV_RANDOM) ? FILE_RA_RANDOM : FILE_RA_NORMAL);
+                OsFileReadaheadInit(&region->unTypeData.rf.readahead, mode);
+            }
+#endif
+            return LOS_OK;
+        case MADV_FREE://只对匿名页有意义,没有延迟回收,和 MADV_DONTNEED 一样立即释放
+#ifdef LOSCFG_FS_VFS
+            if (LOS_IsRegionFileValid(region)) {
+                return -EINVAL;
+            }
+#endif
+            /* fall-through */
+        case MADV_DONTNEED:
+            return (OsRegionPagesRelease(space, region, vaddr, len) == LOS_OK) ? LOS_OK : -EINVAL;
+#ifdef LOSCFG_KERNEL_VM_KSM
+        case MADV_MERGEABLE://和预读策略一样对整个线性区生效,只有私有匿名线性区会被扫描
+            if (LOS_IsRegionTypeAnon(region) || (region == space->heap)) {
+                region->regionFlags |= VM_MAP_REGION_FLAG_MERGEABLE;
+            }
+            return LOS_OK;
+        case MADV_UNMERGEABLE://已合并的页不拆开,写的时候照常写时拷贝
+            region->regionFlags &= ~VM_MAP_REGION_FLAG_MERGEABLE;
+            return LOS_OK;
+#endif
+        default:
+            return LOS_OK;
+    }
+}
+/**************************************************************************************************
+ 给内核的内存访问建议
+ MADV_WILLNEED:  文件映射提前读入页高速缓存,单个线性区一次最多一个最大预读窗口
+ MADV_DONTNEED/MADV_FREE: 释放区间内的页但保留映射区间,再次访问时重新缺页
+ MADV_SEQUENTIAL/MADV_RANDOM/MADV_NORMAL: 调整文件线性区的缺页预读策略
+ MADV_MERGEABLE/MADV_UNMERGEABLE: 匿名线性区参与或退出相同页合并
+ 区间可以跨多个线性区,遇到未映射的空洞时返回 -ENOMEM
+**************************************************************************************************/
+int LOS_DoMadvise(VADDR_T vaddr, size_t len, int advice)
+{
+    LosVmSpace *space = OsCurrProcessGet()->vmSpace;
+    LosVmMapRegion *region = NULL;
+    VADDR_T end;
+    VADDR_T next;
+    int ret;
+#ifdef LOSCFG_FS_VFS
+    struct file *filp = NULL;
+    VM_OFFSET_T pgoff = 0;
+    UINT32 nPages;
+    LosFilePin pin = { 0 };
+#endif
+
+    switch (advice) {
+        case MADV_NORMAL:
+        case MADV_RANDOM:
+        case MADV_SEQUENTIAL:
+        case MADV_WILLNEED:
+        case MADV_DONTNEED:
+        case MADV_FREE:
+#ifdef LOSCFG_KERNEL_VM_KSM
+        case MADV_MERGEABLE:
+        case MADV_UNMERGEABLE:
+#endif
+            break;
+        default:
+            return -EINVAL;
+    }
+
+    len = LOS_Align(len, PAGE_SIZE);
+    if (!IS_ALIGNED(vaddr, PAGE_SIZE) || (vaddr > vaddr + len)) {
+        return -EINVAL;
+    }
+    if (len == 0) {
+        return LOS_OK;
+    }
+    if (!LOS_IsUserAddressRange(vaddr, len)) {
+        return -EINVAL;
+    }
+
+    end = vaddr + len;
+    while (vaddr < end) {
+        (VOID)LOS_MuxAcquire(&space->regionMux);
+        region = LOS_RegionFind(space, vaddr);
+        if (region == NULL) {
+            (VOID)LOS_MuxRelease(&space->regionMux);
+            return -ENOMEM;
+        }
+        next = MIN2(region->range.base + region->range.size, end);
+        ret = OsMadviseRegion(space, region, vaddr, next - vaddr, advice);
+#ifdef LOSCFG_FS_VFS
+        nPages = 0;
+        if ((ret == LOS_OK) && (advice == MADV_WILLNEED) && LOS_IsRegionFileValid(region) &&
+            (region->unTypeData.rf.file->f_mapping != NULL)) {
+            filp = region->unTypeData.rf.file;
+            pgoff = ((vaddr - region->range.base) >> PAGE_SHIFT) + region->pgOff;
+            nPages = MIN2((next - vaddr) >> PAGE_SHIFT, VM_FILEMAP_RA_MAX_PAGES);
+            OsFileMappingPin(filp, &pin);//锁外读设备期间映射不能被释放
+        }
+#endif
+        (VOID)LOS_MuxRelease(&space->regionMux);
+        if (ret != LOS_OK) {
+            return ret;
+        }
+#ifdef LOSCFG_FS_VFS
+        if (nPages != 0) {//和缺页慢路径一样,放开 regionMux 后再读设备
+            OsPageCacheReadaheadPinned(&pin, pgoff, nPages);
+        }
+#endif
+        vaddr = next;
+    }
+
+    return LOS_OK;
+}
+//设置或清除线性区的锁定标签,调用者持有 regionMux
+STATIC VOID OsRegionMlockSet(LosVmMapRegion *region, BOOL lock)
+{
+    if (lock) {
+        region->regionFlags |= VM_MAP_REGION_FLAG_LOCKED;
+        return;
+    }
+
+    region->regionFlags &= ~VM_MAP_REGION_FLAG_LOCKED;
+#ifdef LOSCFG_FS_VFS
+    OsFilePagesUnlock(region);
+#endif
+}
+/**************************************************************************************************
+ 锁定/解锁内存段,锁定时预先缺页,映射的文件页不会被页高速缓存回收,匿名页本来就不会被回收
+ 锁定以线性区为单位,不拆分线性区,区间碰到的线性区整个被锁定,但只为区间内的页预先缺页.
+ 区间中有未映射的空洞时返回 -ENOMEM
+**************************************************************************************************/
+int LOS_DoMlock(VADDR_T vaddr, size_t len, BOOL lock)
+{
+    LosVmSpace *space = OsCurrProcessGet()->vmSpace;
+    LosVmMapRegion *region = NULL;
+    VADDR_T end;
+    VADDR_T next;
+
+    len = LOS_Align(len + (vaddr & (PAGE_SIZE - 1)), PAGE_SIZE);
+    vaddr = ROUNDDOWN(vaddr, PAGE_SIZE);
+    if (vaddr > vaddr + len) {
+        return -EINVAL;
+    }
+    if (len == 0) {
+        return LOS_OK;
+    }
+    if (!LOS_IsUserAddressRange(vaddr, len)) {
+        return -ENOMEM;
+    }
+
+    end = vaddr + len;
+    (VOID)LOS_MuxAcquire(&space->regionMux);
+    for (next = vaddr; next < end; next = region->range.base + region->range.size) {
+        region = LOS_RegionFind(space, next);
+        if (region == NULL) {
+            (VOID)LOS_MuxRelease(&space->regionMux);
+            return -ENOMEM;
+        }
+        OsRegionMlockSet(region, lock);
+    }
+    (VOID)LOS_MuxRelease(&space->regionMux);
+
+    if (lock && (OsVmPopulate(space, vaddr, len) != LOS_OK)) {
+        return -EAGAIN;
+    }
+    return LOS_OK;
+}
+//锁定进程全部内存, MCL_CURRENT:已有的线性区 MCL_FUTURE:以后新映射的线性区
+int LOS_DoMlockAll(int flags)
+{
+    LosVmSpace *space = OsCurrProcessGet()->vmSpace;
+    LosRbNode *pstRbNode = NULL;
+    LosRbNode *pstRbNodeNext = NULL;
+
+    if ((flags == 0) || ((flags & ~(MCL_CURRENT | MCL_FUTURE)) != 0)) {
+        return -EINVAL;
+    }
+
+    (VOID)LOS_MuxAcquire(&space->regionMux);
+    if (flags & MCL_FUTURE) {
+        space->defRegionFlags |= VM_MAP_REGION_FLAG_LOCKED;
+    }
+    if (flags & MCL_CURRENT) {
+        RB_SCAN_SAFE(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+            OsRegionMlockSet((LosVmMapRegion *)pstRbNode, TRUE);
+        RB_SCAN_SAFE_END(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+    }
+    (VOID)LOS_MuxRelease(&space->regionMux);
+
+    if ((flags & MCL_CURRENT) && (OsVmPopulate(space, space->base, space->size) != LOS_OK)) {
+        return -ENOMEM;
+    }
+    return LOS_OK;
+}
+//解除进程全部内存的锁定,以后新映射的线性区也不再默认锁定
+int LOS_DoMunlockAll(VOID)
+{
+    LosVmSpace *space = OsCurrProcessGet()->vmSpace;
+    LosRbNode *pstRbNode = NULL;
+    LosRbNode *pstRbNodeNext = NULL;
+
+    (VOID)LOS_MuxAcquire(&space->regionMux);
+    space->defRegionFlags &= ~VM_MAP_REGION_FLAG_LOCKED;
+    RB_SCAN_SAFE(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+        if (((LosVmMapRegion *)pstRbNode)->regionFlags & VM_MAP_REGION_FLAG_LOCKED) {
+            OsRegionMlockSet((LosVmMapRegion *)pstRbNode, FALSE);
+        }
+    RB_SCAN_SAFE_END(&space->regionRbTree, pstRbNode, pstRbNodeNext)
+    (VOID)LOS_MuxRelease(&space->regionMux);
+    return LOS_OK;
+}
 
 STATUS_T OsMremapCheck(VADDR_T addr, size_t oldLen, VADDR_T newAddr, size_t newLen, unsigned int flags)
 {
@@ -405,6 +646,7 @@ VADDR_T LOS_DoMremap(VADDR_T oldAddress, size_t oldSize, size_t newSize, int fla
     // we can expand directly.
     if (!status) {
         regionOld->range.size = newSize;
+        LOS_RbAugmentPropagate(&space->regionRbTree, &regionOld->rbNode);
         ret = oldAddress;
         goto OUT_MREMAP;
     }
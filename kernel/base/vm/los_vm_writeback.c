@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**************************************************************************************************
+ 后台脏页回写
+ 文件页被写脏后只是留在页高速缓存里,以前要等到 sync/close/回收时才会写回磁盘.
+ 这里用一个内核任务周期性地把过期的脏页收集起来,按 <mapping,pgoff> 排序,
+ 把同一文件内连续的整页合并成一次大块写,减少存储设备的零碎写;
+ 脏页占比过高时写者会被短暂拦住,等回写任务追上来.
+**************************************************************************************************/
+#include "fs/file.h"
+#include "inode/inode.h"
+#include "fs/fs_operation.h"
+#include "los_vm_filemap.h"
+#include "los_vm_phys.h"
+#include "los_event.h"
+#include "los_task.h"
+#include "los_sys.h"
+#include "los_hw.h"
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#define VM_WRITEBACK_THROTTLE_STEP_MS   10
+
+STATIC EVENT_CB_S g_writebackEvent;
+STATIC UINT32 g_writebackTaskID = OS_INVALID_VALUE;
+STATIC Atomic g_writebackDirty = 0;     /* dirty page cache pages, resynced every pass */
+STATIC UINT32 g_writebackBgPages;       /* background threshold in pages */
+STATIC UINT32 g_writebackLimitPages;    /* throttle threshold in pages */
+
+/* a dirty page cache page taken by one pass, the page frame and the mapping are pinned until written */
+typedef struct {
+    LosVmPage               *vmPage;
+    struct page_mapping     *mapping;
+    VM_OFFSET_T             pgoff;
+    UINT16                  dirtyOff;
+    UINT16                  dirtyEnd;
+} WritebackItem;
+
+STATIC WritebackItem g_writebackItems[VM_WRITEBACK_BATCH_PAGES];   /* only the writeback task uses it */
+
+STATIC INLINE UINT32 OsWritebackDirtyGet(VOID)
+{
+    INT32 dirty = LOS_AtomicRead(&g_writebackDirty);
+
+    return (dirty > 0) ? (UINT32)dirty : 0;
+}
+//页由干净变脏
+VOID OsWritebackDirtyInc(VOID)
+{
+    LOS_AtomicInc(&g_writebackDirty);
+}
+//脏页被取走回写或被丢弃
+VOID OsWritebackDirtyDec(VOID)
+{
+    LOS_AtomicDec(&g_writebackDirty);
+}
+//整页都脏,可以和相邻页合并写
+STATIC INLINE BOOL OsWritebackItemWhole(const WritebackItem *item)
+{
+    return (item->dirtyOff == 0) && ((item->dirtyEnd == 0) || (item->dirtyEnd == PAGE_SIZE));
+}
+/**************************************************************************************************
+ 从一条文件LRU链表上收集待回写的脏页,调用者持有 lruLock,关着中断
+ force 为假时只收集已过期的脏页.锁内只记下页框,映射,页号和脏的范围:页框和映射各钉一个引用,
+ 原页随即变干净,拷贝和写设备都放到锁外;之后的写操作会重新标脏,不会丢数据.
+ *dirty 累计链表上仍然是脏的页数,用来校准计数.
+**************************************************************************************************/
+STATIC UINT32 OsWritebackCollect(LOS_DL_LIST *lruList, WritebackItem *items, UINT32 budget,
+                                 BOOL force, UINT32 *dirty)
+{
+    UINT32 collected = 0;
+    UINT32 now = (UINT32)LOS_TickCountGet();
+    UINT32 expire = LOS_MS2Tick(VM_WRITEBACK_EXPIRE_MS);
+    SPIN_LOCK_S *flock = NULL;
+    LosFilePage *fpage = NULL;
+    WritebackItem *item = NULL;
+
+    LOS_DL_LIST_FOR_EACH_ENTRY(fpage, lruList, LosFilePage, lru) {
+        if (!OsIsPageDirty(fpage->vmPage)) {
+            continue;
+        }
+        (*dirty)++;
+        if ((collected >= budget) || (!force && ((now - fpage->dirtyTick) < expire))) {
+            continue;
+        }
+
+        flock = &fpage->mapping->list_lock;
+        if (LOS_SpinTrylock(flock) != LOS_OK) {//锁的顺序与 OsFileCacheFlush 相反,只能尝试
+            continue;
+        }
+        if (OsIsPageLocked(fpage->vmPage) || !OsIsPageDirty(fpage->vmPage)) {//正在被 write() 写入
+            LOS_SpinUnlock(flock);
+            continue;
+        }
+        item = &items[collected];
+        item->vmPage = fpage->vmPage;
+        item->mapping = fpage->mapping;
+        item->pgoff = fpage->pgoff;
+        item->dirtyOff = fpage->dirtyOff;
+        item->dirtyEnd = fpage->dirtyEnd;
+        OsWritebackDirtyDec();
+        OsCleanPageDirty(fpage->vmPage);
+        LOS_AtomicInc(&fpage->vmPage->refCounts);//和 OsDumpDirtyPage 一样钉住页框,写完由 LOS_PhysPageFree 放开
+        if (LOS_AtomicRead(&fpage->vmPage->refCounts) == 1) {//no map page cache
+            LOS_AtomicInc(&fpage->vmPage->refCounts);
+        }
+        LOS_AtomicInc(&fpage->mapping->ref);//钉住映射直到写完,锁外写回期间 close + unlink 不能释放它
+        LOS_SpinUnlock(flock);
+        collected++;
+        (*dirty)--;
+    }
+
+    return collected;
+}
+//按 <mapping,pgoff> 升序排好,同一文件连续的页排在一起;在锁外做,一批最多 VM_WRITEBACK_BATCH_PAGES 项
+STATIC VOID OsWritebackSort(WritebackItem *items, UINT32 count)
+{
+    WritebackItem key;
+    UINT32 i;
+    UINT32 j;
+
+    for (i = 1; i < count; i++) {
+        key = items[i];
+        for (j = i; j > 0; j--) {
+            if (((UINTPTR)items[j - 1].mapping < (UINTPTR)key.mapping) ||
+                ((items[j - 1].mapping == key.mapping) && (items[j - 1].pgoff < key.pgoff))) {
+                break;
+            }
+            items[j] = items[j - 1];
+        }
+        items[j] = key;
+    }
+}
+/**************************************************************************************************
+ 把 buf 写到文件的 [pos, pos + len),超出文件长度的部分不写,调用者钉住了 mapping
+ 回写任务和用户的 read/write/lseek 并发,不能借用户文件的 f_pos 定位,
+ 在文件的一份私有副本上按 pos 写,用户看到的读写位置不受影响.文件已被删除时不写.
+**************************************************************************************************/
+STATIC VOID OsWritebackWrite(struct page_mapping *mapping, UINT32 pos, char *buf, UINT32 len)
+{
+    struct stat bufStat;
+    struct file wbFile;
+    ssize_t ret;
+
+    if ((mapping->host == NULL) ||
+        (memcpy_s(&wbFile, sizeof(struct file), mapping->host, sizeof(struct file)) != EOK) ||
+        (wbFile.f_inode == NULL) || (wbFile.f_mapping != mapping)) {
+        return;
+    }
+    if (stat(wbFile.f_path, &bufStat) != OK) {
+        VM_ERR("Writeback get file size failed. (filepath=%s)", wbFile.f_path);
+        return;
+    }
+    if (pos >= (UINT32)bufStat.st_size) {
+        return;
+    }
+    len = MIN2(len, (UINT32)bufStat.st_size - pos);
+
+    wbFile.f_pos = pos;
+    if (wbFile.f_inode->u.i_mops->writepage) {
+        ret = wbFile.f_inode->u.i_mops->writepage(&wbFile, buf, len);
+    } else {
+        ret = file_write(&wbFile, (VOID *)buf, len);
+    }
+    if (ret <= 0) {
+        VM_ERR("Writeback error ret %d", ret);
+    }
+}
+//放开收集时钉住的页框和映射
+STATIC VOID OsWritebackItemPut(WritebackItem *item)
+{
+    LOS_PhysPageFree(item->vmPage);
+    dec_mapping(item->mapping);
+}
+//直接从页高速缓存的页写回脏的那段,不经过中间缓冲区
+STATIC VOID OsWritebackItemFlush(WritebackItem *item)
+{
+    UINT32 off = item->dirtyOff;
+    UINT32 end = item->dirtyEnd;
+
+    if (OsWritebackItemWhole(item) || (end <= off)) {//没记下脏的范围时和 OsFlushDirtyPage 一样写整页
+        off = 0;
+        end = PAGE_SIZE;
+    }
+    OsWritebackWrite(item->mapping, ((UINT32)item->pgoff << PAGE_SHIFT) + off,
+                     (char *)OsVmPageToVaddr(item->vmPage) + off, end - off);
+    OsWritebackItemPut(item);
+}
+//一段文件内连续的整页拼进一块连续缓冲区一次写回,这是数据唯一的一次拷贝;拿不到缓冲区时逐页直接写
+STATIC VOID OsWritebackRunFlush(WritebackItem *run, UINT32 nRun)
+{
+    UINT32 index;
+    char *buf = NULL;
+
+    if (nRun > 1) {
+        buf = (char *)LOS_PhysPagesAllocContiguous(nRun);
+    }
+    if (buf == NULL) {
+        for (index = 0; index < nRun; index++) {
+            OsWritebackItemFlush(&run[index]);
+        }
+        return;
+    }
+
+    for (index = 0; index < nRun; index++) {
+        OsPhysPageCopy(buf + (index << PAGE_SHIFT), OsVmPageToVaddr(run[index].vmPage));
+    }
+    OsWritebackWrite(run[0].mapping, (UINT32)run[0].pgoff << PAGE_SHIFT, buf, nRun << PAGE_SHIFT);
+    LOS_PhysPagesFreeContiguous(buf, nRun);
+
+    for (index = 0; index < nRun; index++) {
+        OsWritebackItemPut(&run[index]);
+    }
+}
+//items 已排好序,同一文件内连续的整页合并成最多 VM_FILEMAP_RA_CHUNK_PAGES 页的一次写
+STATIC VOID OsWritebackFlush(WritebackItem *items, UINT32 count)
+{
+    UINT32 index = 0;
+    UINT32 nRun;
+
+    while (index < count) {
+        if (!OsWritebackItemWhole(&items[index])) {//只脏了一部分,只写脏的那段
+            OsWritebackItemFlush(&items[index]);
+            index++;
+            continue;
+        }
+
+        nRun = 1;
+        while ((nRun < VM_FILEMAP_RA_CHUNK_PAGES) && ((index + nRun) < count) &&
+               (items[index + nRun].mapping == items[index].mapping) &&
+               (items[index + nRun].pgoff == (items[index].pgoff + nRun)) &&
+               OsWritebackItemWhole(&items[index + nRun])) {
+            nRun++;
+        }
+        OsWritebackRunFlush(&items[index], nRun);
+        index += nRun;
+    }
+}
+//一轮回写,返回本轮取走的脏页数
+STATIC UINT32 OsWritebackPass(BOOL force)
+{
+    LosVmPhysSeg *physSeg = NULL;
+    UINT32 collected = 0;
+    UINT32 dirty = 0;
+    UINT32 intSave;
+    UINT32 seq;
+    INT32 index;
+
+    for (index = 0; index < g_vmPhysSegNum; index++) {
+        physSeg = &g_vmPhysSeg[index];
+        LOS_SpinLockSave(&physSeg->lruLock, &intSave);
+        for (seq = physSeg->minSeq; seq != physSeg->maxSeq + 1; seq++) {//从最老一代开始,先写回快被回收的页
+            collected += OsWritebackCollect(&physSeg->genList[VM_LRU_GEN(seq)], &g_writebackItems[collected],
+                                            VM_WRITEBACK_BATCH_PAGES - collected, force, &dirty);
+        }
+        LOS_SpinUnlockRestore(&physSeg->lruLock, intSave);
+    }
+    LOS_AtomicSet(&g_writebackDirty, (INT32)dirty);//增减散落在各处,每轮按实际数目校准一次
+
+    OsWritebackSort(g_writebackItems, collected);
+    OsWritebackFlush(g_writebackItems, collected);
+    return collected;
+}
+//回写任务,周期醒来写过期脏页;被写者唤醒或脏页超过后台阈值时不看是否过期,一直写到阈值以下
+STATIC VOID OsWritebackTask(VOID)
+{
+    UINT32 ret;
+    UINT32 collected;
+    BOOL force = FALSE;
+
+    while (1) {
+        ret = LOS_EventRead(&g_writebackEvent, VM_WRITEBACK_EVENT_WAKE, LOS_WAITMODE_OR | LOS_WAITMODE_CLR,
+                            LOS_MS2Tick(VM_WRITEBACK_INTERVAL_MS));
+        force = (ret == VM_WRITEBACK_EVENT_WAKE);
+        do {
+            collected = OsWritebackPass(force || (OsWritebackDirtyGet() > g_writebackBgPages));
+        } while ((collected != 0) && (OsWritebackDirtyGet() > g_writebackBgPages));
+    }
+}
+/**************************************************************************************************
+ 写者节流,在 write() 或写缺页之后调用,调用处不能持有自旋锁
+ 脏页超过后台阈值时唤醒回写任务;超过上限时让写者分几次睡一会,最多 VM_WRITEBACK_THROTTLE_MS,
+ 给回写任务让出存储带宽,而不是一直等到内存回收时才同步写.
+**************************************************************************************************/
+VOID OsWritebackThrottle(VOID)
+{
+    UINT32 waited = 0;
+
+    if ((g_writebackTaskID == OS_INVALID_VALUE) || !LOS_CHECK_SCHEDULE ||
+        (LOS_CurTaskIDGet() == g_writebackTaskID)) {
+        return;
+    }
+    if (OsWritebackDirtyGet() <= g_writebackBgPages) {
+        return;
+    }
+
+    (VOID)LOS_EventWrite(&g_writebackEvent, VM_WRITEBACK_EVENT_WAKE);
+    while ((OsWritebackDirtyGet() > g_writebackLimitPages) && (waited < VM_WRITEBACK_THROTTLE_MS)) {
+        (VOID)LOS_TaskDelay(LOS_MS2Tick(VM_WRITEBACK_THROTTLE_STEP_MS));
+        waited += VM_WRITEBACK_THROTTLE_STEP_MS;
+    }
+}
+//创建回写任务,阈值按物理页总数折算
+UINT32 OsWritebackTaskInit(VOID)
+{
+    UINT32 ret;
+    UINT32 taskID;
+    UINT32 totalPages = 0;
+    INT32 index;
+    TSK_INIT_PARAM_S taskInitParam;
+
+    for (index = 0; index < g_vmPhysSegNum; index++) {
+        totalPages += g_vmPhysSeg[index].size >> PAGE_SHIFT;
+    }
+    g_writebackBgPages = totalPages * VM_WRITEBACK_BG_RATIO / 100; /* 100: percent */
+    g_writebackLimitPages = totalPages * VM_WRITEBACK_DIRTY_RATIO / 100; /* 100: percent */
+
+    ret = LOS_EventInit(&g_writebackEvent);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    (VOID)memset_s((VOID *)(&taskInitParam), sizeof(TSK_INIT_PARAM_S), 0, sizeof(TSK_INIT_PARAM_S));
+    taskInitParam.pfnTaskEntry = (TSK_ENTRY_FUNC)OsWritebackTask;
+    taskInitParam.uwStackSize = LOSCFG_BASE_CORE_TSK_DEFAULT_STACK_SIZE;
+    taskInitParam.pcName = "WritebackTask";
+    taskInitParam.usTaskPrio = LOSCFG_BASE_CORE_TSK_DEFAULT_PRIO;
+    ret = LOS_TaskCreate(&taskID, &taskInitParam);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+    g_writebackTaskID = taskID;
+
+    return LOS_OK;
+}
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
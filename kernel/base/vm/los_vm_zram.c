@@ -0,0 +1,621 @@
+/*
+ * Copyright (c) 2013-2019, Huawei Technologies Co., Ltd. All rights reserved.
+ * Copyright (c) 2020, Huawei Device Co., Ltd. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of
+ *    conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *    of conditions and the following disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**************************************************************************************************
+ 压缩交换区(zram)
+ 没有外部交换设备时,把不常用的匿名页压缩后存进内核堆,释放原物理页;页表项换成记录槽位号的无效项.
+ 再访问时缺页,解压到新页重新映射.全0等同值填充的页只记一个值,压缩后仍超过3/4页的页不换出.
+ 默认用内置的LZ4风格块格式,打开 LOSCFG_KERNEL_VM_ZRAM_ZLIB 时改用zlib的raw deflate.
+**************************************************************************************************/
+#include "los_vm_zram.h"
+#include "los_vm_phys.h"
+#include "los_vm_page.h"
+#include "los_vm_dump.h"
+#include "los_vm_filemap.h"
+#include "los_memory.h"
+#include "los_spinlock.h"
+#include "los_atomic.h"
+#include "los_printf.h"
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_ZRAM_ZLIB
+#include "zlib.h"
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+#endif /* __cplusplus */
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+
+#define VM_ZRAM_COMP_MAX        (PAGE_SIZE * 3 / 4) /* worse than this the page stays in ram */
+#define VM_ZRAM_SLOT_RATIO      2   /* at most one slot per two physical pages */
+#define VM_ZRAM_BYTES_RATIO     4   /* compressed data takes at most a quarter of ram */
+
+typedef struct {
+    VOID    *data;      /* compressed bytes, NULL for a same-filled page */
+    UINT32  value;      /* fill word of a same-filled page, next free entry while unused */
+    UINT16  size;       /* compressed length */
+    UINT16  ref;        /* page table entries pointing here, 0 when free */
+} LosVmZramSlot;
+
+STATIC LosVmZramSlot *g_zramSlots = NULL;
+STATIC UINT32 g_zramSlotCount;
+STATIC UINT32 g_zramFreeHead;       /* first free entry, 0 when the table is full */
+STATIC UINT32 g_zramUsedSlots;
+STATIC UINT32 g_zramSameFilled;
+STATIC UINT32 g_zramBytes;
+STATIC UINT32 g_zramBytesMax;
+STATIC UINT32 g_zramSwapOuts;
+STATIC UINT32 g_zramSwapIns;
+STATIC UINT32 g_zramRejects;
+LITE_OS_SEC_BSS SPIN_LOCK_INIT(g_zramSpin);       /* slot table and counters */
+LITE_OS_SEC_BSS SPIN_LOCK_INIT(g_zramCompSpin);   /* compression buffers below */
+STATIC UINT8 g_zramCompBuf[VM_ZRAM_COMP_MAX];
+
+#ifndef LOSCFG_KERNEL_VM_ZRAM_ZLIB
+/**************************************************************************************************
+ LZ4风格的块格式,每个序列:
+ token(高4位字面量长度,低4位匹配长度-4) [长度扩展字节] 字面量 [2字节小端偏移] [长度扩展字节]
+ 长度为15时后跟扩展字节,逐个累加直到遇到非255的字节;最后一个序列只有字面量.
+**************************************************************************************************/
+#define VM_ZRAM_LZ_HASH_BITS    10
+#define VM_ZRAM_LZ_HASH_EMPTY   0xFFFF
+#define VM_ZRAM_LZ_MIN_MATCH    4
+#define VM_ZRAM_LZ_LAST_LITERALS 5  /* the tail is always emitted as literals */
+#define VM_ZRAM_LZ_MATCH_LIMIT  12  /* no match starts this close to the end */
+#define VM_ZRAM_LZ_LEN_MASK     0xF
+
+STATIC UINT16 g_zramLzHash[1 << VM_ZRAM_LZ_HASH_BITS];
+
+STATIC INLINE UINT32 OsVmZramLzRead32(const UINT8 *ptr)
+{
+    return (UINT32)ptr[0] | ((UINT32)ptr[1] << 8) | ((UINT32)ptr[2] << 16) | ((UINT32)ptr[3] << 24);
+}
+
+STATIC INLINE UINT32 OsVmZramLzHash(UINT32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - VM_ZRAM_LZ_HASH_BITS);
+}
+
+STATIC UINT8 *OsVmZramLzLengthPut(UINT8 *op, const UINT8 *oend, UINT32 len)
+{
+    while (len >= 0xFF) {
+        if (op >= oend) {
+            return NULL;
+        }
+        *op++ = 0xFF;
+        len -= 0xFF;
+    }
+    if (op >= oend) {
+        return NULL;
+    }
+    *op++ = (UINT8)len;
+    return op;
+}
+//写出一个序列,matchLen 为0时是只有字面量的最后一个序列
+STATIC UINT8 *OsVmZramLzSequencePut(UINT8 *op, const UINT8 *oend, const UINT8 *literal, UINT32 literals,
+                                    UINT32 offset, UINT32 matchLen)
+{
+    UINT8 *token = op;
+
+    if (op >= oend) {
+        return NULL;
+    }
+    op++;
+    *token = (UINT8)(MIN2(literals, VM_ZRAM_LZ_LEN_MASK) << 4);
+    if (literals >= VM_ZRAM_LZ_LEN_MASK) {
+        op = OsVmZramLzLengthPut(op, oend, literals - VM_ZRAM_LZ_LEN_MASK);
+        if (op == NULL) {
+            return NULL;
+        }
+    }
+    if (literals > (UINT32)(oend - op)) {
+        return NULL;
+    }
+    if (literals != 0) {
+        (VOID)memcpy_s(op, oend - op, literal, literals);
+        op += literals;
+    }
+    if (matchLen == 0) {
+        return op;
+    }
+
+    if ((UINT32)(oend - op) < sizeof(UINT16)) {
+        return NULL;
+    }
+    *op++ = (UINT8)(offset & 0xFF);
+    *op++ = (UINT8)(offset >> 8);
+    matchLen -= VM_ZRAM_LZ_MIN_MATCH;
+    *token |= (UINT8)MIN2(matchLen, VM_ZRAM_LZ_LEN_MASK);
+    if (matchLen >= VM_ZRAM_LZ_LEN_MASK) {
+        op = OsVmZramLzLengthPut(op, oend, matchLen - VM_ZRAM_LZ_LEN_MASK);
+    }
+    return op;
+}
+//压缩一页,返回压缩后的长度,放不进 dstMax 时返回0.调用者持有 g_zramCompSpin
+STATIC UINT32 OsVmZramCompress(const UINT8 *src, UINT8 *dst, UINT32 dstMax)
+{
+    const UINT8 *ip = src;
+    const UINT8 *anchor = src;
+    const UINT8 *iend = src + PAGE_SIZE;
+    const UINT8 *mflimit = iend - VM_ZRAM_LZ_MATCH_LIMIT;
+    const UINT8 *matchEnd = iend - VM_ZRAM_LZ_LAST_LITERALS;
+    const UINT8 *ref = NULL;
+    const UINT8 *oend = dst + dstMax;
+    UINT8 *op = dst;
+    UINT32 sequence;
+    UINT32 matchLen;
+    UINT32 hash;
+
+    (VOID)memset_s(g_zramLzHash, sizeof(g_zramLzHash), 0xFF, sizeof(g_zramLzHash));
+    while (ip < mflimit) {
+        sequence = OsVmZramLzRead32(ip);
+        hash = OsVmZramLzHash(sequence);
+        ref = (g_zramLzHash[hash] == VM_ZRAM_LZ_HASH_EMPTY) ? NULL : (src + g_zramLzHash[hash]);
+        g_zramLzHash[hash] = (UINT16)(ip - src);
+        if ((ref == NULL) || (OsVmZramLzRead32(ref) != sequence)) {
+            ip++;
+            continue;
+        }
+
+        matchLen = VM_ZRAM_LZ_MIN_MATCH;
+        while (((ip + matchLen) < matchEnd) && (ref[matchLen] == ip[matchLen])) {
+            matchLen++;
+        }
+        op = OsVmZramLzSequencePut(op, oend, anchor, (UINT32)(ip - anchor), (UINT32)(ip - ref), matchLen);
+        if (op == NULL) {
+            return 0;
+        }
+        ip += matchLen;
+        anchor = ip;
+    }
+
+    op = OsVmZramLzSequencePut(op, oend, anchor, (UINT32)(iend - anchor), 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+    return (UINT32)(op - dst);
+}
+
+STATIC BOOL OsVmZramLzLengthGet(const UINT8 **ipPtr, const UINT8 *iend, UINT32 *len)
+{
+    const UINT8 *ip = *ipPtr;
+    UINT8 byte;
+
+    do {
+        if (ip >= iend) {
+            return FALSE;
+        }
+        byte = *ip++;
+        *len += byte;
+    } while (byte == 0xFF);
+
+    *ipPtr = ip;
+    return TRUE;
+}
+//解压到一整页,数据损坏时返回 FALSE,不会越界读写
+STATIC BOOL OsVmZramDecompress(const UINT8 *src, UINT32 srcSize, UINT8 *dst)
+{
+    const UINT8 *ip = src;
+    const UINT8 *iend = src + srcSize;
+    const UINT8 *ref = NULL;
+    UINT8 *op = dst;
+    UINT8 *oend = dst + PAGE_SIZE;
+    UINT32 token;
+    UINT32 offset;
+    UINT32 len;
+
+    while (ip < iend) {
+        token = *ip++;
+        len = token >> 4;
+        if ((len == VM_ZRAM_LZ_LEN_MASK) && !OsVmZramLzLengthGet(&ip, iend, &len)) {
+            return FALSE;
+        }
+        if ((len > (UINT32)(iend - ip)) || (len > (UINT32)(oend - op))) {
+            return FALSE;
+        }
+        if (len != 0) {
+            (VOID)memcpy_s(op, oend - op, ip, len);
+            ip += len;
+            op += len;
+        }
+        if (ip == iend) {//最后一个序列只有字面量
+            break;
+        }
+
+        if ((UINT32)(iend - ip) < sizeof(UINT16)) {
+            return FALSE;
+        }
+        offset = (UINT32)ip[0] | ((UINT32)ip[1] << 8);
+        ip += sizeof(UINT16);
+        if ((offset == 0) || (offset > (UINT32)(op - dst))) {
+            return FALSE;
+        }
+        len = token & VM_ZRAM_LZ_LEN_MASK;
+        if ((len == VM_ZRAM_LZ_LEN_MASK) && !OsVmZramLzLengthGet(&ip, iend, &len)) {
+            return FALSE;
+        }
+        len += VM_ZRAM_LZ_MIN_MATCH;
+        if (len > (UINT32)(oend - op)) {
+            return FALSE;
+        }
+        ref = op - offset;
+        while (len > 0) {//匹配可以和输出重叠,只能逐字节拷贝
+            *op++ = *ref++;
+            len--;
+        }
+    }
+
+    return (op == oend);
+}
+#else
+#define VM_ZRAM_ZLIB_WINDOW_BITS    12  /* 4K window covers a whole page */
+#define VM_ZRAM_ZLIB_MEM_LEVEL      1
+
+//raw deflate 压缩一页,放不进 dstMax 时返回0.调用者持有 g_zramCompSpin
+STATIC UINT32 OsVmZramCompress(const UINT8 *src, UINT8 *dst, UINT32 dstMax)
+{
+    z_stream stream;
+    UINT32 size = 0;
+
+    (VOID)memset_s(&stream, sizeof(stream), 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -VM_ZRAM_ZLIB_WINDOW_BITS,
+                     VM_ZRAM_ZLIB_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    stream.next_in = (Bytef *)src;
+    stream.avail_in = PAGE_SIZE;
+    stream.next_out = dst;
+    stream.avail_out = dstMax;
+    if (deflate(&stream, Z_FINISH) == Z_STREAM_END) {
+        size = dstMax - stream.avail_out;
+    }
+    (VOID)deflateEnd(&stream);
+    return size;
+}
+
+STATIC BOOL OsVmZramDecompress(const UINT8 *src, UINT32 srcSize, UINT8 *dst)
+{
+    z_stream stream;
+    BOOL ret = FALSE;
+
+    (VOID)memset_s(&stream, sizeof(stream), 0, sizeof(stream));
+    if (inflateInit2(&stream, -VM_ZRAM_ZLIB_WINDOW_BITS) != Z_OK) {
+        return FALSE;
+    }
+    stream.next_in = (Bytef *)src;
+    stream.avail_in = srcSize;
+    stream.next_out = dst;
+    stream.avail_out = PAGE_SIZE;
+    if ((inflate(&stream, Z_FINISH) == Z_STREAM_END) && (stream.total_out == PAGE_SIZE)) {
+        ret = TRUE;
+    }
+    (VOID)inflateEnd(&stream);
+    return ret;
+}
+#endif
+
+//整页是否由同一个字填满,最常见的是换出从未写过的0页
+STATIC BOOL OsVmZramSameFilled(const UINT32 *word, UINT32 *value)
+{
+    UINT32 index;
+
+    for (index = 1; index < (PAGE_SIZE / sizeof(UINT32)); index++) {
+        if (word[index] != word[0]) {
+            return FALSE;
+        }
+    }
+    *value = word[0];
+    return TRUE;
+}
+
+STATIC UINT32 OsVmZramSlotAlloc(VOID)
+{
+    LosVmZramSlot *slot = NULL;
+    UINT32 intSave;
+    UINT32 entry;
+
+    LOS_SpinLockSave(&g_zramSpin, &intSave);
+    entry = g_zramFreeHead;
+    if (entry != 0) {
+        slot = &g_zramSlots[entry - 1];
+        g_zramFreeHead = slot->value;
+        slot->data = NULL;
+        slot->value = 0;
+        slot->size = 0;
+        slot->ref = 1;
+        g_zramUsedSlots++;
+    }
+    LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+    return entry;
+}
+//页表项复制给子进程时,槽位多一个引用
+VOID OsVmZramEntryDup(UINT32 entry)
+{
+    UINT32 intSave;
+
+    if ((entry == 0) || (entry > g_zramSlotCount)) {
+        return;
+    }
+
+    LOS_SpinLockSave(&g_zramSpin, &intSave);
+    g_zramSlots[entry - 1].ref++;
+    LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+}
+//页表项被清除或换回时释放引用,最后一个引用带走压缩数据
+VOID OsVmZramEntryPut(UINT32 entry)
+{
+    LosVmZramSlot *slot = NULL;
+    VOID *data = NULL;
+    UINT32 intSave;
+
+    if ((entry == 0) || (entry > g_zramSlotCount)) {
+        VM_ERR("invalid zram entry %u", entry);
+        return;
+    }
+
+    LOS_SpinLockSave(&g_zramSpin, &intSave);
+    slot = &g_zramSlots[entry - 1];
+    if (slot->ref == 0) {
+        LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+        VM_ERR("zram entry %u already free", entry);
+        return;
+    }
+    slot->ref--;
+    if (slot->ref == 0) {
+        data = slot->data;
+        if (data == NULL) {
+            g_zramSameFilled--;
+        }
+        g_zramBytes -= slot->size;
+        slot->data = NULL;
+        slot->size = 0;
+        slot->value = g_zramFreeHead;
+        g_zramFreeHead = entry;
+        g_zramUsedSlots--;
+    }
+    LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+
+    if (data != NULL) {
+        (VOID)LOS_MemFree(m_aucSysMem0, data);
+    }
+}
+
+STATIC STATUS_T OsVmZramStore(UINT32 entry, const VOID *kvaddr)
+{
+    LosVmZramSlot *slot = &g_zramSlots[entry - 1];
+    VOID *data = NULL;
+    UINT32 value = 0;
+    UINT32 size = 0;
+    UINT32 intSave;
+
+    if (OsVmZramSameFilled(kvaddr, &value)) {
+        LOS_SpinLockSave(&g_zramSpin, &intSave);
+        slot->value = value;
+        g_zramSameFilled++;
+        g_zramSwapOuts++;
+        LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+        return LOS_OK;
+    }
+
+    if (g_zramBytes < g_zramBytesMax) {
+        LOS_SpinLock(&g_zramCompSpin);
+        size = OsVmZramCompress(kvaddr, g_zramCompBuf, VM_ZRAM_COMP_MAX);
+        if (size != 0) {
+            data = LOS_MemAlloc(m_aucSysMem0, size);
+            if (data != NULL) {
+                (VOID)memcpy_s(data, size, g_zramCompBuf, size);
+            }
+        }
+        LOS_SpinUnlock(&g_zramCompSpin);
+    }
+
+    LOS_SpinLockSave(&g_zramSpin, &intSave);
+    if (data == NULL) {
+        g_zramRejects++;
+    } else {
+        slot->data = data;
+        slot->size = (UINT16)size;
+        g_zramBytes += size;
+        g_zramSwapOuts++;
+    }
+    LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+    return (data == NULL) ? LOS_ERRNO_VM_NO_MEMORY : LOS_OK;
+}
+/**************************************************************************************************
+ 换出 vaddr 处的匿名页,调用者持有 space->regionMux.
+ 只换出仅被这一个页表项引用的小页;先撤掉映射再压缩,其他线程此时访问会缺页并等在 regionMux 上,
+ 不会在压缩过程中改写页内容.压不下去时恢复原映射.
+**************************************************************************************************/
+STATUS_T OsVmZramSwapOut(LosVmSpace *space, LosVmMapRegion *region, VADDR_T vaddr)
+{
+    LosArchMmu *archMmu = &space->archMmu;
+    LosVmPage *page = NULL;
+    PADDR_T paddr = 0;
+    UINT32 entry;
+    STATUS_T ret;
+
+    if (g_zramSlots == NULL) {
+        return LOS_ERRNO_VM_NOT_READY;
+    }
+    if (LOS_ArchMmuQuery(archMmu, vaddr, &paddr, NULL) != LOS_OK) {
+        return LOS_ERRNO_VM_NOT_FOUND;
+    }
+    page = LOS_VmPageGet(paddr);
+    if ((page == NULL) || OsIsPageShared(page) || (LOS_AtomicRead(&page->refCounts) != 1)) {
+        return LOS_ERRNO_VM_BUSY;
+    }
+
+    entry = OsVmZramSlotAlloc();
+    if (entry == 0) {
+        return LOS_ERRNO_VM_NO_MEMORY;
+    }
+    ret = LOS_ArchMmuSwapOut(archMmu, vaddr, entry);
+    if (ret != LOS_OK) {
+        OsVmZramEntryPut(entry);
+        return ret;
+    }
+
+    ret = OsVmZramStore(entry, OsVmPageToVaddr(page));
+    if (ret != LOS_OK) {
+        (VOID)LOS_ArchMmuMap(archMmu, vaddr, paddr, 1, region->regionFlags);
+        OsVmZramEntryPut(entry);
+        return ret;
+    }
+
+    LOS_PhysPageFree(page);
+    return LOS_OK;
+}
+//缺页时把 vaddr 处换出的页解压到新页并重新映射,调用者持有 regionMux
+STATUS_T OsVmZramSwapIn(LosArchMmu *archMmu, VADDR_T vaddr, UINT32 regionFlags)
+{
+    LosVmZramSlot *slot = NULL;
+    LosVmPage *page = NULL;
+    UINT32 *word = NULL;
+    UINT32 entry = 0;
+    UINT32 intSave;
+    UINT32 index;
+    STATUS_T ret;
+
+    ret = LOS_ArchMmuSwapEntryGet(archMmu, vaddr, &entry);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+    if ((entry == 0) || (entry > g_zramSlotCount)) {
+        VM_ERR("bad swap entry %u at %#x", entry, vaddr);
+        return LOS_ERRNO_VM_FAULT;
+    }
+
+    page = LOS_PhysPageAlloc();
+    if (page == NULL) {
+        return LOS_ERRNO_VM_NO_MEMORY;
+    }
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    if (OsVmPageCharge(LOS_DL_LIST_ENTRY(archMmu, LosVmSpace, archMmu), page, TRUE) != LOS_OK) {//换回的页重新记账
+        LOS_PhysPageFree(page);
+        return LOS_ERRNO_VM_NO_MEMORY;
+    }
+#endif
+
+    /* the entry keeps the slot alive, its content does not change until the last put */
+    slot = &g_zramSlots[entry - 1];
+    word = OsVmPageToVaddr(page);
+    if (slot->data == NULL) {
+        for (index = 0; index < (PAGE_SIZE / sizeof(UINT32)); index++) {
+            word[index] = slot->value;
+        }
+    } else if (!OsVmZramDecompress(slot->data, slot->size, (UINT8 *)word)) {
+        VM_ERR("zram entry %u corrupted at %#x", entry, vaddr);
+        LOS_PhysPageFree(page);
+        return LOS_ERRNO_VM_FAULT;
+    }
+
+    LOS_AtomicInc(&page->refCounts);
+    if (LOS_ArchMmuMap(archMmu, vaddr, page->physAddr, 1, regionFlags) < 0) {
+        LOS_PhysPageFree(page);
+        return LOS_ERRNO_VM_MAP_FAILED;
+    }
+    OsVmZramEntryPut(entry);
+
+    LOS_SpinLockSave(&g_zramSpin, &intSave);
+    g_zramSwapIns++;
+    LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+    return LOS_OK;
+}
+
+VOID OsVmZramDump(VOID)
+{
+    UINT32 intSave;
+    UINT32 used;
+    UINT32 sameFilled;
+    UINT32 bytes;
+    UINT32 swapOuts;
+    UINT32 swapIns;
+    UINT32 rejects;
+
+    if (g_zramSlots == NULL) {
+        return;
+    }
+
+    LOS_SpinLockSave(&g_zramSpin, &intSave);
+    used = g_zramUsedSlots;
+    sameFilled = g_zramSameFilled;
+    bytes = g_zramBytes;
+    swapOuts = g_zramSwapOuts;
+    swapIns = g_zramSwapIns;
+    rejects = g_zramRejects;
+    LOS_SpinUnlockRestore(&g_zramSpin, intSave);
+
+    PRINTK("\r\n zram: slots %u/%u, same-filled %u, compressed %u/%u bytes\n",
+           used, g_zramSlotCount, sameFilled, bytes, g_zramBytesMax);
+    PRINTK(" zram: swap out %u, swap in %u, rejected %u\n", swapOuts, swapIns, rejects);
+}
+//按物理内存大小建立槽位表
+UINT32 OsVmZramInit(VOID)
+{
+    UINT32 usedCount = 0;
+    UINT32 totalCount = 0;
+    UINT32 index;
+
+    OsVmPhysUsedInfoGet(&usedCount, &totalCount);
+    g_zramSlotCount = totalCount / VM_ZRAM_SLOT_RATIO;
+    if (g_zramSlotCount == 0) {
+        return LOS_NOK;
+    }
+
+    g_zramSlots = LOS_MemAlloc(m_aucSysMem0, g_zramSlotCount * sizeof(LosVmZramSlot));
+    if (g_zramSlots == NULL) {
+        VM_ERR("zram slot table alloc failed, %u slots", g_zramSlotCount);
+        g_zramSlotCount = 0;
+        return LOS_NOK;
+    }
+
+    for (index = 0; index < g_zramSlotCount; index++) {//空闲槽位按顺序串成链,value 存下一个空闲的编号
+        g_zramSlots[index].data = NULL;
+        g_zramSlots[index].value = (index + 1 < g_zramSlotCount) ? (index + 2) : 0;
+        g_zramSlots[index].size = 0;
+        g_zramSlots[index].ref = 0;
+    }
+    g_zramFreeHead = 1;
+    g_zramBytesMax = (totalCount / VM_ZRAM_BYTES_RATIO) << PAGE_SHIFT;
+    return LOS_OK;
+}
+#endif
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __cplusplus */
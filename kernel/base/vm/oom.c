@@ -35,6 +35,12 @@
 #include "los_vm_lock.h"
 #include "los_vm_phys.h"
 #include "los_vm_filemap.h"
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+#include "los_vm_zram.h"
+#endif
+#ifdef LOSCFG_KERNEL_VM_PSI
+#include "los_vm_psi.h"
+#endif
 #include "los_process_pri.h"
 #if (LOSCFG_BASE_CORE_SWTMR == YES)
 #include "los_swtmr_pri.h"
@@ -86,6 +92,11 @@ LITE_OS_SEC_TEXT_MINOR STATIC UINT32 OomForceShrinkMemory(VOID)
     for (i = 0; i < MAX_SHRINK_PAGECACHE_TRY; i++) {
         reclaimMemPages += OsTryShrinkMemory(0);
     }
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    if (reclaimMemPages == 0) {//页高速缓存已经挤不出内存,再把匿名页压缩换出
+        reclaimMemPages = OsTrySwapAnonMemory(VM_ZRAM_SWAP_BATCH);
+    }
+#endif
 
     return reclaimMemPages;
 }
@@ -107,7 +118,13 @@ LITE_OS_SEC_TEXT_MINOR STATIC BOOL OomReclaimPageCache(VOID)
              * if we get memory, we will reclaim pagecache memory again.
              * if there is no memory to reclaim, we will return.
              */
+#ifdef LOSCFG_KERNEL_VM_PSI
+            OsVmPsiStallEnter();
+#endif
             reclaimMemPages = OomForceShrinkMemory();
+#ifdef LOSCFG_KERNEL_VM_PSI
+            OsVmPsiStallLeave();
+#endif
             if (reclaimMemPages > 0) {
                 continue;
             }
@@ -143,6 +160,9 @@ LITE_OS_SEC_TEXT_MINOR BOOL OomCheckProcess(VOID)
     OsVmPhysUsedInfoGet(&usedPm, &totalPm);
     isLowMemory = ((totalPm - usedPm) << PAGE_SHIFT) < g_oomCB->lowMemThreshold;
     if (isLowMemory) {
+#ifdef LOSCFG_KERNEL_VM_PSI
+        OsVmPsiLowMemory();
+#endif
         PRINTK("[oom] OS is in low memory state\n"
                "total physical memory: %#x(byte), used: %#x(byte),"
                "free: %#x(byte), low memory threshold: %#x(byte)\n",
@@ -171,6 +191,9 @@ LITE_OS_SEC_TEXT_MINOR VOID OomInfodump(VOID) //打印内存溢出信息
            g_oomCB->enabled ? "enabled" : "disabled",
            g_oomCB->lowMemThreshold, g_oomCB->reclaimMemThreshold,
            g_oomCB->checkInterval);
+#ifdef LOSCFG_KERNEL_VM_PSI
+    PRINTK("      memory stall total: %llu(us)\n", OsVmPsiStallTotalGet());
+#endif
 }
 
 LITE_OS_SEC_TEXT_MINOR VOID OomSetLowMemThreashold(UINT32 lowMemThreshold)
@@ -40,6 +40,7 @@
 #include "los_vm_filemap.h"
 #include "los_vm_phys.h"
 #include "los_arch_mmu.h"
+#include "los_mmu_descriptor_v6.h"
 #include "los_vm_page.h"
 #include "los_vm_lock.h"
 #include "los_process.h"
@@ -65,6 +66,11 @@ STATIC LosMux g_sysvShmMux;
 #define SHM_SEG 128
 #define SHM_ALL (SHM_MAX_PAGES)
 
+#define SHM_KEY_HASH_BITS   6
+#define SHM_KEY_HASH_SIZE   (1 << SHM_KEY_HASH_BITS)	//key 哈希桶数
+#define SHM_SECTION_PAGES   (MMU_DESCRIPTOR_L1_SMALL_SIZE >> PAGE_SHIFT)	//1M section 的页数
+#define SHM_LARGE_PAGES     16	//64K 大页的页数
+
 #define SHM_SEG_FREE    0x2000	//空闲未使用
 #define SHM_SEG_USED    0x4000	//已使用
 #define SHM_SEG_REMOVE  0x8000	//删除
@@ -90,6 +96,7 @@ struct shmIDSource {//共享存储结构体
     struct shmid_ds ds; //是内核为每一个共享内存段维护的数据结构,包含权限,各进程最后操作的时间,进程ID等信息
     UINT32 status;	//状态 SHM_SEG_FREE ...
     LOS_DL_LIST node; //节点,挂vmPage
+    LOS_DL_LIST hashNode; //挂到 g_shmKeyHash 上,IPC_PRIVATE 和已删除的段不挂
 };
 
 /* private data */
@@ -102,6 +109,7 @@ STATIC struct shminfo g_shmInfo = {
 };
 
 STATIC struct shmIDSource *g_shmSegs = NULL;
+STATIC LOS_DL_LIST g_shmKeyHash[SHM_KEY_HASH_SIZE];	//按 key 散列的段,shmget 不用再扫整个数组
 //共享内存初始化
 INT32 ShmInit(VOID)
 {
@@ -125,6 +133,10 @@ INT32 ShmInit(VOID)
         g_shmSegs[i].status = SHM_SEG_FREE;//节点初始状态为空闲
         g_shmSegs[i].ds.shm_perm.seq = i + 1;//struct ipc_perm shm_perm;系统为每一个IPC对象保存一个ipc_perm结构体,结构说明了IPC对象的权限和所有者
         LOS_ListInit(&g_shmSegs[i].node);//初始化节点
+        LOS_ListInit(&g_shmSegs[i].hashNode);
+    }
+    for (i = 0; i < SHM_KEY_HASH_SIZE; i++) {
+        LOS_ListInit(&g_shmKeyHash[i]);
     }
 
     return 0;
@@ -171,6 +183,50 @@ STATIC VOID ShmPagesRefDec(struct shmIDSource *seg)
         LOS_AtomicDec(&page->refCounts);
     }
 }
+//ftok 生成的 key 低位常常相同,乘黄金分割数后取高位
+STATIC INLINE LOS_DL_LIST *ShmKeyHashHead(key_t key)
+{
+    return &g_shmKeyHash[((UINT32)key * 0x9E3779B1U) >> (32 - SHM_KEY_HASH_BITS)];
+}
+//段不能再按 key 找到,删除标记和释放时调用,重复调用无害
+STATIC INLINE VOID ShmKeyUnhash(struct shmIDSource *seg)
+{
+    LOS_ListDelete(&seg->hashNode);
+    LOS_ListInit(&seg->hashNode);
+}
+/**************************************************************************************************
+ 共享段的物理页先按 1M 连续块申请,arch 层映射时虚实地址都按 1M 对齐的就用 section,
+ 剩下的按 64K 块申请映射成大页,不够或失败时再一页页申请.页框各自独立计数,释放时仍逐页归还
+**************************************************************************************************/
+STATIC size_t ShmPagesAlloc(size_t nPages, LOS_DL_LIST *list)
+{
+    size_t count = 0;
+    size_t chunk = SHM_SECTION_PAGES;
+    UINT32 index;
+    VOID *kvaddr = NULL;
+    LosVmPage *vmPage = NULL;
+
+    while (chunk >= SHM_LARGE_PAGES) {
+        if ((nPages - count) < chunk) {
+            chunk = (chunk == SHM_SECTION_PAGES) ? SHM_LARGE_PAGES : 0;
+            continue;
+        }
+        kvaddr = LOS_PhysPagesAllocContiguous(chunk);
+        if (kvaddr == NULL) {
+            chunk = (chunk == SHM_SECTION_PAGES) ? SHM_LARGE_PAGES : 0;
+            continue;
+        }
+        vmPage = OsVmVaddrToPage(kvaddr);
+        vmPage->nPages = 0;
+        for (index = 0; index < chunk; index++) {
+            LOS_AtomicSet(&vmPage[index].refCounts, 0);
+            LOS_ListTailInsert(list, &vmPage[index].node);
+        }
+        count += chunk;
+    }
+
+    return count + LOS_PhysPagesAlloc(nPages - count, list);
+}
 //分配共享页
 STATIC INT32 ShmAllocSeg(key_t key, size_t size, int shmflg)
 {
@@ -198,7 +254,7 @@ STATIC INT32 ShmAllocSeg(key_t key, size_t size, int shmflg)
     }
 
     seg = &g_shmSegs[segNum];
-    count = LOS_PhysPagesAlloc(size >> PAGE_SHIFT, &seg->node);//分配共享页面,函数内部把node都挂好了.
+    count = ShmPagesAlloc(size >> PAGE_SHIFT, &seg->node);//分配共享页面,函数内部把node都挂好了.
     if (count != (size >> PAGE_SHIFT)) {//异常释放
         (VOID)LOS_PhysPagesFree(&seg->node);//
         seg->status = SHM_SEG_FREE;//回归seg池
@@ -220,6 +276,9 @@ STATIC INT32 ShmAllocSeg(key_t key, size_t size, int shmflg)
     seg->ds.shm_atime = 0;
     seg->ds.shm_dtime = 0;
     seg->ds.shm_ctime = time(NULL);
+    if (key != IPC_PRIVATE) {
+        LOS_ListAdd(ShmKeyHashHead(key), &seg->hashNode);
+    }
 
     return segNum;
 }
@@ -228,6 +287,7 @@ STATIC INLINE VOID ShmFreeSeg(struct shmIDSource *seg)
 {
     UINT32 count;
 
+    ShmKeyUnhash(seg);
     ShmClearSharedFlag(seg);//先撕掉 seg->node 中vmpage的共享标签
     count = LOS_PhysPagesFree(&seg->node);//再挨个删除物理页框
     if (count != (seg->ds.shm_segsz >> PAGE_SHIFT)) {//异常,必须要一样
@@ -241,14 +301,11 @@ STATIC INLINE VOID ShmFreeSeg(struct shmIDSource *seg)
 //通过key查找 shmId
 STATIC INT32 ShmFindSegByKey(key_t key)
 {
-    INT32 i;
     struct shmIDSource *seg = NULL;
 
-    for (i = 0; i < g_shmInfo.shmmni; i++) {
-        seg = &g_shmSegs[i];
-        if ((seg->status & SHM_SEG_USED) &&
-            (seg->ds.shm_perm.key == key)) {
-            return i;
+    LOS_DL_LIST_FOR_EACH_ENTRY(seg, ShmKeyHashHead(key), struct shmIDSource, hashNode) {
+        if (seg->ds.shm_perm.key == key) {
+            return (INT32)(seg - g_shmSegs);
         }
     }
 
@@ -293,17 +350,31 @@ STATIC VOID ShmVmmMapping(LosVmSpace *space, LOS_DL_LIST *pageList, VADDR_T vadd
 {
     LosVmPage *vmPage = NULL;
     VADDR_T va = vaddr;
-    PADDR_T pa;
+    PADDR_T pa = 0;
+    UINT32 count = 0;
     STATUS_T ret;
 
     LOS_DL_LIST_FOR_EACH_ENTRY(vmPage, pageList, LosVmPage, node) {
-        pa = VM_PAGE_TO_PHYS(vmPage);//拿到物理地址
         LOS_AtomicInc(&vmPage->refCounts);//自增
-        ret = LOS_ArchMmuMap(&space->archMmu, va, pa, 1, regionFlags);//虚实映射
-        if (ret != 1) {
+        if ((count != 0) && (VM_PAGE_TO_PHYS(vmPage) == pa + (count << PAGE_SHIFT))) {//物理上连续,并入同一段
+            count++;
+            continue;
+        }
+        if (count != 0) {
+            ret = LOS_ArchMmuMap(&space->archMmu, va, pa, count, regionFlags);//一段只映射一次,对齐的段用大页
+            if (ret != (STATUS_T)count) {
+                VM_ERR("LOS_ArchMmuMap failed, ret = %d", ret);
+            }
+            va += count << PAGE_SHIFT;
+        }
+        pa = VM_PAGE_TO_PHYS(vmPage);//拿到物理地址
+        count = 1;
+    }
+    if (count != 0) {
+        ret = LOS_ArchMmuMap(&space->archMmu, va, pa, count, regionFlags);//虚实映射
+        if (ret != (STATUS_T)count) {
             VM_ERR("LOS_ArchMmuMap failed, ret = %d", ret);
         }
-        va += PAGE_SIZE;
     }
 }
 //fork 一个共享线性区
@@ -491,7 +562,13 @@ LosVmMapRegion *ShmatVmmAlloc(struct shmIDSource *seg, const VOID *shmaddr,
     regionFlags = OsCvtProtFlagsToRegionFlags(prot, MAP_ANONYMOUS | MAP_SHARED);//映射方式:共享或匿名
     (VOID)LOS_MuxAcquire(&space->regionMux);
     if (shmaddr == NULL) {//shm_segsz:段的大小（以字节为单位）
-        region = LOS_RegionAlloc(space, 0, seg->ds.shm_segsz, regionFlags, 0);//分配一个区,注意这里的虚拟地址传的是0,
+        vaddr = 0;
+        if ((seg->ds.shm_segsz >> PAGE_SHIFT) >= SHM_SECTION_PAGES) {//虚拟地址和物理块一样对齐,才能映射成 section/大页
+            vaddr = OsAllocRangeAlign(space, seg->ds.shm_segsz, MMU_DESCRIPTOR_L1_SMALL_SIZE);
+        } else if ((seg->ds.shm_segsz >> PAGE_SHIFT) >= SHM_LARGE_PAGES) {
+            vaddr = OsAllocRangeAlign(space, seg->ds.shm_segsz, SHM_LARGE_PAGES << PAGE_SHIFT);
+        }
+        region = LOS_RegionAlloc(space, vaddr, seg->ds.shm_segsz, regionFlags, 0);//vaddr 为0时由 LOS_RegionAlloc 自己挑地址
     } else {//如果地址虚拟地址传入是0，则由内核选择创建映射的虚拟地址，    这是创建新映射的最便捷的方法。
         if (shmflg & SHM_RND) {
             vaddr = ROUNDDOWN((VADDR_T)(UINTPTR)shmaddr, SHMLBA);
@@ -647,6 +724,7 @@ INT32 ShmCtl(INT32 shmid, INT32 cmd, struct shmid_ds *buf)
             }
 
             seg->status |= SHM_SEG_REMOVE;
+            ShmKeyUnhash(seg);//删除后同一个 key 再 shmget 得到的是新段
             if (seg->ds.shm_nattch <= 0) {//没有任何进程在使用了
                 ShmFreeSeg(seg);//释放 归还内存
             }
@@ -721,6 +799,7 @@ INT32 ShmDt(const VOID *shmaddr)
 
     /* remove it from aspace */
     LOS_RbDelNode(&space->regionRbTree, &region->rbNode);//从红黑树和链表中摘除节点
+    OsRegionCacheFlush(space);
     LOS_ArchMmuUnmap(&space->archMmu, region->range.base, region->range.size >> PAGE_SHIFT);//解除线性区的映射
     /* free it */
     free(region);//规划线性区所占内存池中的内存
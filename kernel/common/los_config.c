@@ -60,6 +60,19 @@
 #ifdef LOSCFG_FS_VFS
 #include "fs/fs.h"
 #include "fs/fs_operation.h"
+#include "los_vm_filemap.h"
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+#include "los_vm_zram.h"
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_KSM
+#include "los_vm_ksm.h"
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_PSI
+#include "los_vm_psi.h"
 #endif
 
 #if (LOSCFG_KERNEL_TRACE == YES)
@@ -378,6 +391,33 @@ LITE_OS_SEC_TEXT_INIT INT32 OsMain(VOID)
         return ret;
     }
 
+#ifdef LOSCFG_FS_VFS
+    ret = OsWritebackTaskInit();//后台脏页回写任务
+    if (ret != LOS_OK) {
+        return ret;
+    }
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_ZRAM
+    if (OsVmZramInit() != LOS_OK) {//压缩交换区建不起来只是少了换出能力,不影响启动
+        PRINT_ERR("zram init failed\n");
+    }
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_KSM
+    ret = OsVmKsmInit();//相同页合并扫描任务
+    if (ret != LOS_OK) {
+        return ret;
+    }
+#endif
+
+#ifdef LOSCFG_KERNEL_VM_PSI
+    ret = OsVmPsiInit();//内存压力停顿统计,注册 /dev/mempsi
+    if (ret != LOS_OK) {
+        return ret;
+    }
+#endif
+
     return LOS_OK;
 }
 //创建系统初始化任务
@@ -36,6 +36,9 @@
 #include "los_vm_phys.h"
 #include "los_vm_map.h"
 #include "los_vm_dump.h"
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+#include "los_vm_memlimit.h"
+#endif
 //进程开始执行,参数为加载完ELF后的信息
 STATIC INT32 OsExecve(const ELFLoadInfo *loadInfo)
 {
@@ -166,6 +169,9 @@ INT32 LOS_DoExecveFile(const CHAR *fileName, CHAR * const *argv, CHAR * const *e
         return -ENOMEM;
     }
     LOS_ListAdd(&loadInfo.newSpace->archMmu.ptList, &(vmPage->node));//用vmPage->node挂到  ptlist, vmPage 就是 L1表
+#ifdef LOSCFG_KERNEL_VM_MEMLIMIT
+    OsVmChargeLimitInherit(loadInfo.newSpace, OsCurrProcessGet()->vmSpace);//exec 不解除内存上限
+#endif
 
     loadInfo.argv = argv;//
     loadInfo.envp = envp;
@@ -174,10 +180,12 @@ INT32 LOS_DoExecveFile(const CHAR *fileName, CHAR * const *argv, CHAR * const *e
     if (ret != LOS_OK) {
         return ret;
     }
+
+    OsVforkDone(OsCurrProcessGet());//vfork子进程已换上新空间,放父进程继续运行
 	//对当前进程回收再利用,用当前进程去跑elf
     ret = OsExecRecycleAndInit(OsCurrProcessGet(), loadInfo.fileName, loadInfo.oldSpace, loadInfo.oldFiles);
     if (ret != LOS_OK) {
-        (VOID)LOS_VmSpaceFree(loadInfo.oldSpace);
+        (VOID)OsVmSpacePut(loadInfo.oldSpace);
         goto OUT;
     }
 
@@ -488,7 +488,7 @@ STATIC INT32 OsSetBss(const LD_ELF_PHDR *elfPhdr, INT32 fd, UINTPTR bssStart, UI
         PRINT_ERR("%s[%d]\n", __FUNCTION__, __LINE__);
         return -EFAULT;
     }
-    (VOID)memset_s((VOID *)(UINTPTR)kvaddr, PAGE_SIZE, 0, PAGE_SIZE);
+    OsPhysPageZero((VOID *)(UINTPTR)kvaddr);
 
     offset = ROUNDDOWN(elfPhdr->offset + elfPhdr->fileSize, PAGE_SIZE);
     size = ROUNDOFFSET(elfPhdr->offset + elfPhdr->fileSize, PAGE_SIZE);
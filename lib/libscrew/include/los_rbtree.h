@@ -58,6 +58,8 @@ typedef struct TagRbNode {
 typedef ULONG_T (*pfRBCmpKeyFn)(VOID *, VOID *);
 typedef ULONG_T (*pfRBFreeFn)(LosRbNode *);
 typedef VOID *(*pfRBGetKeyFn)(LosRbNode *);
+/* recompute the augmented data of a node from the node itself and its two children */
+typedef VOID (*pfRBAugmentFn)(LosRbNode *);
 
 typedef struct TagRbTree {
     LosRbNode *pstRoot;
@@ -68,6 +70,7 @@ typedef struct TagRbTree {
     pfRBCmpKeyFn pfCmpKey;
     pfRBFreeFn pfFree;
     pfRBGetKeyFn pfGetKey;
+    pfRBAugmentFn pfAugment;
 } LosRbTree;
 
 typedef struct TagRbWalk {
@@ -128,6 +131,10 @@ ULONG_T LOS_RbGetNode(LosRbTree *pstTree, VOID *pKey, LosRbNode **ppstNode);
 VOID LOS_RbDelNode(LosRbTree *pstTree, LosRbNode *pstNode);
 ULONG_T LOS_RbAddNode(LosRbTree *pstTree, LosRbNode *pstNew);
 
+/* Following 2 functions support subtree augmentation, pfAugment is NULL by default. */
+VOID LOS_RbSetAugment(LosRbTree *pstTree, pfRBAugmentFn pfAugment);
+VOID LOS_RbAugmentPropagate(LosRbTree *pstTree, LosRbNode *pstNode);
+
 /* Following 3 functions support protection walk. */
 LosRbWalk *LOS_RbCreateWalk(LosRbTree *pstTree);
 VOID *LOS_RbWalkNext(LosRbWalk *pstWalk);
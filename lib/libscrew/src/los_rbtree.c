@@ -51,6 +51,13 @@ STATIC VOID OsRbDeleteNode(LosRbTree *pstTree, VOID *pstData);
 STATIC VOID OsRbInitTree(LosRbTree *pstTree);
 STATIC VOID OsRbClearTree(LosRbTree *pstTree);
 
+STATIC INLINE VOID OsRbAugmentNode(LosRbTree *pstTree, LosRbNode *pstNode)
+{
+    if (NULL != pstTree->pfAugment) {
+        pstTree->pfAugment(pstNode);
+    }
+}
+
 STATIC VOID OsRbLeftRotateNode(LosRbTree *pstTree, LosRbNode *pstX)
 {
     LosRbNode *pstY = NULL;
@@ -87,6 +94,9 @@ STATIC VOID OsRbLeftRotateNode(LosRbTree *pstTree, LosRbNode *pstX)
     pstX->pstParent = pstY;
     pstY->pstLeft = pstX;
     pstNilT->pstParent = pstParent;
+    /* pstX is now below pstY, the subtree of pstY covers what pstX covered before */
+    OsRbAugmentNode(pstTree, pstX);
+    OsRbAugmentNode(pstTree, pstY);
     return;
 }
 
@@ -127,6 +137,8 @@ STATIC VOID OsRbRightRotateNode(LosRbTree *pstTree, LosRbNode *pstY)
     pstY->pstParent = pstX;
     pstX->pstRight = pstY;
     pstNilT->pstParent = pstParent;
+    OsRbAugmentNode(pstTree, pstY);
+    OsRbAugmentNode(pstTree, pstX);
     return;
 }
 
@@ -274,6 +286,7 @@ STATIC VOID OsRbDeleteNode(LosRbTree *pstTree, VOID *pstData)
     LosRbWalk *pstWalk = NULL;
     LosRbNode *pstNilT = NULL;
     LosRbNode *pstZ = NULL;
+    LosRbNode *pstFrom = NULL;
     LOS_DL_LIST *pstNode = NULL;
 
     /* begin: for earse pc-lint warning */
@@ -334,6 +347,8 @@ STATIC VOID OsRbDeleteNode(LosRbTree *pstTree, VOID *pstData)
             }
         }
 
+        /* the old parent lost a node, fix augmented data before rotations */
+        LOS_RbAugmentPropagate(pstTree, pstZ->pstParent);
         if (LOS_RB_BLACK == pstZ->lColor) {
             OsRbDeleteNodeFixup(pstTree, pstChild);
         }
@@ -365,6 +380,8 @@ STATIC VOID OsRbDeleteNode(LosRbTree *pstTree, VOID *pstData)
     }
 
     lColor = pstZ->lColor;
+    /* lowest node whose subtree changes: successor's old parent, or successor itself in pstDel's place */
+    pstFrom = (pstZ->pstParent == pstDel) ? pstZ : pstZ->pstParent;
 
     /* Remove successor node out of tree. */
     pstChild->pstParent = pstZ->pstParent;
@@ -409,6 +426,7 @@ STATIC VOID OsRbDeleteNode(LosRbTree *pstTree, VOID *pstData)
     pstDel->pstLeft->pstParent = pstZ;
     pstDel->pstRight->pstParent = pstZ;
 
+    LOS_RbAugmentPropagate(pstTree, pstFrom);
     if (LOS_RB_BLACK == lColor) {
         OsRbDeleteNodeFixup(pstTree, pstChild);
     }
@@ -437,6 +455,7 @@ STATIC VOID OsRbInitTree(LosRbTree *pstTree)
     pstTree->pfCmpKey = NULL;
     pstTree->pfFree = NULL;
     pstTree->pfGetKey = NULL;
+    pstTree->pfAugment = NULL;
 
     return;
 }
@@ -547,6 +566,7 @@ VOID LOS_RbInsertOneNodeProcess(LosRbTree *pstTree, LosRbNode *pstParent, LosRbN
         }
     }
 
+    LOS_RbAugmentPropagate(pstTree, pstNew);
     OsRbInsertNodeFixup(pstTree, pstNew);
 
     return;
@@ -567,6 +587,35 @@ VOID LOS_RbInitTree(LosRbTree *pstTree, pfRBCmpKeyFn pfCmpKey, pfRBFreeFn pfFree
     return;
 }
 
+VOID LOS_RbSetAugment(LosRbTree *pstTree, pfRBAugmentFn pfAugment)
+{
+    if (NULL == pstTree) {
+        return;
+    }
+
+    pstTree->pfAugment = pfAugment;
+
+    return;
+}
+
+/* recompute augmented data from pstNode up to the root, call it after a key changes in place */
+VOID LOS_RbAugmentPropagate(LosRbTree *pstTree, LosRbNode *pstNode)
+{
+    LosRbNode *pstNilT = NULL;
+
+    if ((NULL == pstTree) || (NULL == pstTree->pfAugment)) {
+        return;
+    }
+
+    pstNilT = &(pstTree->stNilT);
+    while ((NULL != pstNode) && (pstNilT != pstNode)) {
+        pstTree->pfAugment(pstNode);
+        pstNode = pstNode->pstParent;
+    }
+
+    return;
+}
+
 VOID LOS_RbDestroyTree(LosRbTree *pstTree)
 {
     LosRbNode *pstNode = NULL;
@@ -48,6 +48,7 @@
 #include "dirent.h"
 #include "user_copy.h"
 #include "los_vm_map.h"
+#include "los_vm_filemap.h"
 #include "los_memory.h"
 #include "los_strncpy_from_user.h"
 #include "fs_other.h"
@@ -210,6 +211,9 @@ int SysClose(int fd)
     /* Process fd convert to system global fd */
     int sysfd = DisassociateProcessFd(fd);//先解除关联
 
+    if ((sysfd >= 0) && (sysfd < CONFIG_NFILE_DESCRIPTORS)) {
+        OsFileReadaheadReset(&tg_filelist.fl_files[sysfd]);//预读状态不留给该表项的下一个打开者
+    }
     ret = close(sysfd);//关闭文件,个人认为应该先 close - > DisassociateProcessFd 
     if (ret < 0) {//关闭失败时
         AssociateSystemFd(fd, sysfd);//继续关联
@@ -1724,6 +1728,56 @@ int SysFallocate64(int fd, int mode, off64_t offset, off64_t len)
     }
     return ret;
 }
+//文件访问模式建议,用于调整页高速缓存的预读策略
+int SysFadvise64(int fd, int advice, off64_t offset, off64_t len)
+{
+    int ret;
+    UINT32 nPages;
+    struct file *filep = NULL;
+
+    /* Process fd convert to system global fd */
+    fd = GetAssociatedSystemFd(fd);
+
+    ret = fs_getfilep(fd, &filep);
+    if (ret < 0) {
+        return -get_errno();
+    }
+    if ((offset < 0) || (len < 0)) {
+        return -EINVAL;
+    }
+
+    switch (advice) {
+        case POSIX_FADV_NORMAL:
+        case POSIX_FADV_SEQUENTIAL:
+        case POSIX_FADV_RANDOM:
+        case POSIX_FADV_WILLNEED:
+        case POSIX_FADV_DONTNEED:
+        case POSIX_FADV_NOREUSE:
+            break;
+        default:
+            return -EINVAL;
+    }
+
+    /* advice only tunes the page cache, nothing to do without it */
+    if (filep->f_mapping == NULL) {
+        return 0;
+    }
+
+    if (advice == POSIX_FADV_NORMAL) {
+        OsFileReadaheadModeSet(filep, FILE_RA_NORMAL);
+    } else if (advice == POSIX_FADV_SEQUENTIAL) {
+        OsFileReadaheadModeSet(filep, FILE_RA_SEQUENTIAL);
+    } else if (advice == POSIX_FADV_RANDOM) {
+        OsFileReadaheadModeSet(filep, FILE_RA_RANDOM);
+    } else if (advice == POSIX_FADV_WILLNEED) {//提前把指定范围读入缓存,单次最多一个最大预读窗口
+        nPages = VM_FILEMAP_RA_MAX_PAGES;
+        if ((len != 0) && (((len + PAGE_SIZE - 1) >> PAGE_SHIFT) < nPages)) {
+            nPages = (len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+        }
+        OsPageCacheReadahead(filep, offset >> PAGE_SHIFT, nPages);
+    }
+    return 0;
+}
 //对文件随机读
 ssize_t SysPreadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
 {
@@ -66,7 +66,10 @@
 #include "sys/shm.h"
 
 //500以后是LiteOS自定义的系统调用，与ARM EABI不兼容
-#define SYS_CALL_NUM    (__NR_syscallend + 1) // __NR_syscallend = 500 + customized syscalls
+#if (__NR_vm_events_get <= __NR_syscallend)
+#error "__NR_vm_events_get collides with the libc customized syscalls"
+#endif
+#define SYS_CALL_NUM    (__NR_vm_events_get + 1) // __NR_syscallend = 500 + customized syscalls, 内核自己的调用号排在其后
 #define NARG_BITS       4	//参数占用位,这里可以看出系统调用的最大参数个数为 2^4 = 16个参数.
 #define NARG_MASK       0x0F//参数掩码
 #define NARG_PER_BYTE   2	//每个字节两个参数
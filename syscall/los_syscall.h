@@ -48,6 +48,8 @@
 #include "time.h"
 #include "sys/time.h"
 #include "sys/stat.h"
+
+#include "los_vm_event.h"
 #ifdef LOSCFG_FS_VFS
 #include "sys/socket.h"
 #include "dirent.h"
@@ -92,6 +94,7 @@ extern int SysSchedGetPriorityMax(int policy);
 extern int SysSchedRRGetInterval(int pid, struct timespec *tp);
 extern int SysWait(int pid, USER int *status, int options, void *rusage);
 extern int SysFork(void);
+extern int SysVfork(void);
 extern unsigned int SysGetPID(void);
 extern unsigned int SysGetPPID(void);
 extern int SysSetGroupID(unsigned int gid);
@@ -169,6 +172,12 @@ extern ssize_t SysRecvMsg(int s, struct msghdr *message, int flags);
 extern void *SysMmap(void *addr, size_t size, int prot, int flags, int fd, size_t offset);
 extern int SysMunmap(void *addr, size_t size);
 extern int SysMprotect(vaddr_t vaddr, size_t len, int prot);
+extern int SysMadvise(void *addr, size_t len, int advice);
+extern int SysMlock(const void *addr, size_t len);
+extern int SysMunlock(const void *addr, size_t len);
+extern int SysMlockAll(int flags);
+extern int SysMunlockAll(void);
+extern int SysVmEventsGet(unsigned int *events, unsigned int count);
 extern vaddr_t SysMremap(vaddr_t old_address, size_t old_size, size_t new_size, int flags, vaddr_t new_addr);
 extern void *SysBrk(void *addr);
 extern int SysShmGet(key_t key, size_t size, int shmflg);
@@ -274,6 +283,7 @@ extern int SysUnlinkat(int dirfd, const char *pathname, int flag);
 extern int SysRenameat(int oldfd, const char *oldpath, int newdfd, const char *newpath);
 extern int SysFallocate(int fd, int mode, off_t offset, off_t len);
 extern int SysFallocate64(int fd, int mode, off64_t offset, off64_t len);
+extern int SysFadvise64(int fd, int advice, off64_t offset, off64_t len);
 extern ssize_t SysPreadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
 extern ssize_t SysPwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
 extern void SysSync(void);
@@ -321,6 +321,11 @@ int SysFork(void)
     return OsClone(CLONE_SIGHAND, 0, 0);
 }
 
+int SysVfork(void)
+{
+    return OsClone(CLONE_VFORK | CLONE_VM, 0, 0);
+}
+
 unsigned int SysGetPPID(void)
 {
     return OsCurrProcessGet()->parentProcessID;
@@ -87,6 +87,7 @@ SYSCALL_HAND_DEF(__NR_sendfile64, SysSendFile, ssize_t, ARG_NUM_4)
 SYSCALL_HAND_DEF(__NR_preadv, SysPreadv, ssize_t, ARG_NUM_7)
 SYSCALL_HAND_DEF(__NR_pwritev, SysPwritev, ssize_t, ARG_NUM_7)
 SYSCALL_HAND_DEF(__NR_fallocate, SysFallocate64, int, ARG_NUM_7)
+SYSCALL_HAND_DEF(__NR_arm_fadvise64_64, SysFadvise64, int, ARG_NUM_7)
 SYSCALL_HAND_DEF(__NR_getdents64, SysGetdents64, int, ARG_NUM_3)
 
 #ifdef LOSCFG_FS_FAT
@@ -114,6 +115,7 @@ SYSCALL_HAND_DEF(30, SysUtime, int, ARG_NUM_2)
 
 SYSCALL_HAND_DEF(__NR_exit, SysThreadExit, void, ARG_NUM_1)
 SYSCALL_HAND_DEF(__NR_fork, SysFork, int, ARG_NUM_0)
+SYSCALL_HAND_DEF(__NR_vfork, SysVfork, int, ARG_NUM_0)
 SYSCALL_HAND_DEF(13, SysTime, time_t, ARG_NUM_1)
 SYSCALL_HAND_DEF(__NR_getpid, SysGetPID, unsigned int, ARG_NUM_0)
 SYSCALL_HAND_DEF(__NR_pause, SysPause, int, ARG_NUM_0)
@@ -146,6 +148,11 @@ SYSCALL_HAND_DEF(__NR_sched_get_priority_min, SysSchedGetPriorityMin, int, ARG_N
 SYSCALL_HAND_DEF(__NR_sched_rr_get_interval, SysSchedRRGetInterval, int, ARG_NUM_2)
 SYSCALL_HAND_DEF(__NR_nanosleep, SysNanoSleep, int, ARG_NUM_2)
 SYSCALL_HAND_DEF(__NR_mremap, SysMremap, void *, ARG_NUM_5)
+SYSCALL_HAND_DEF(__NR_madvise, SysMadvise, int, ARG_NUM_3)
+SYSCALL_HAND_DEF(__NR_mlock, SysMlock, int, ARG_NUM_2)
+SYSCALL_HAND_DEF(__NR_munlock, SysMunlock, int, ARG_NUM_2)
+SYSCALL_HAND_DEF(__NR_mlockall, SysMlockAll, int, ARG_NUM_1)
+SYSCALL_HAND_DEF(__NR_munlockall, SysMunlockAll, int, ARG_NUM_0)
 SYSCALL_HAND_DEF(__NR_umask, SysUmask, mode_t, ARG_NUM_1)
 
 SYSCALL_HAND_DEF(__NR_rt_sigaction, SysSigAction, int, ARG_NUM_4)
@@ -237,3 +244,4 @@ SYSCALL_HAND_DEF(__NR_pthread_set_detach, SysUserThreadSetDeatch, int, ARG_NUM_1
 SYSCALL_HAND_DEF(__NR_pthread_join, SysThreadJoin, int, ARG_NUM_1)
 SYSCALL_HAND_DEF(__NR_pthread_deatch, SysUserThreadDetach, int, ARG_NUM_1)
 SYSCALL_HAND_DEF(__NR_creat_user_thread, SysCreateUserThread, unsigned int, ARG_NUM_3)
+SYSCALL_HAND_DEF(__NR_vm_events_get, SysVmEventsGet, int, ARG_NUM_2)
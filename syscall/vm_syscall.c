@@ -34,6 +34,8 @@
 #include "errno.h"
 #include "unistd.h"
 #include "los_vm_syscall.h"
+#include "los_vm_event.h"
+#include "user_copy.h"
 #include "fs_file.h"
 
 #ifdef __cplusplus
@@ -104,6 +106,63 @@ int SysMprotect(void *vaddr, size_t len, int prot)
     return LOS_DoMprotect((uintptr_t)vaddr, len, (unsigned long)prot);
 }
 /**************************************************
+给内核的内存使用建议
+addr	页对齐的起始地址
+length	内存段的大小
+advice	MADV_WILLNEED:提前读入文件页 MADV_DONTNEED/MADV_FREE:释放页
+		MADV_SEQUENTIAL/MADV_RANDOM/MADV_NORMAL:调整缺页预读
+成功返回0		失败返回负的错误码
+**************************************************/
+int SysMadvise(void *addr, size_t len, int advice)
+{
+    return LOS_DoMadvise((uintptr_t)addr, len, advice);
+}
+/**************************************************
+锁定内存段,预先缺页并且页不会被回收
+**************************************************/
+int SysMlock(const void *addr, size_t len)
+{
+    return LOS_DoMlock((uintptr_t)addr, len, TRUE);
+}
+
+int SysMunlock(const void *addr, size_t len)
+{
+    return LOS_DoMlock((uintptr_t)addr, len, FALSE);
+}
+/**************************************************
+锁定进程全部内存
+flags	MCL_CURRENT:已有的映射 MCL_FUTURE:以后新建的映射
+**************************************************/
+int SysMlockAll(int flags)
+{
+    return LOS_DoMlockAll(flags);
+}
+
+int SysMunlockAll(void)
+{
+    return LOS_DoMunlockAll();
+}
+/**************************************************
+读内存事件计数的快照,各项顺序见 enum VmEventItem
+events	用户空间数组,count 为其项数,多出的项不填
+返回实际填写的项数
+**************************************************/
+int SysVmEventsGet(unsigned int *events, unsigned int count)
+{
+    UINT32 snapshot[VM_EVENT_NR_ITEMS];
+
+    if ((events == NULL) || (count == 0)) {
+        return -EINVAL;
+    }
+
+    count = MIN2(count, VM_EVENT_NR_ITEMS);
+    OsVmEventSnapshot(snapshot, count);
+    if (LOS_ArchCopyToUser(events, snapshot, count * sizeof(UINT32)) != 0) {
+        return -EFAULT;
+    }
+    return (int)count;
+}
+/**************************************************
 
 **************************************************/
 void *SysBrk(void *addr)